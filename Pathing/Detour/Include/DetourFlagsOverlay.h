@@ -0,0 +1,60 @@
+#ifndef DETOURFLAGSOVERLAY_H
+#define DETOURFLAGSOVERLAY_H
+
+#include <atomic>
+#include <mutex>
+
+#include "DetourNavMesh.h"
+
+/// Polygon flags overriding the flags stored in a shared navigation mesh.
+/// A tile is copied on the first write to one of its polygons, untouched tiles
+/// keep reading the navigation mesh. Used through dtNavMeshQuery::setFlagsOverlay.
+/// @ingroup detour
+class dtPolyFlagsOverlay
+{
+public:
+	dtPolyFlagsOverlay();
+	~dtPolyFlagsOverlay();
+
+	/// Initializes the overlay for a navigation mesh.
+	///  @param[in]	nav		The shared navigation mesh, must outlive the overlay.
+	/// @returns The status flags for the operation.
+	dtStatus init(const dtNavMesh* nav);
+
+	/// Returns the flags of the polygon as seen through the overlay.
+	///  @param[in]	ref		The reference id of the polygon.
+	///  @param[in]	poly	The polygon in the shared navigation mesh.
+	inline unsigned short getFlags(dtPolyRef ref, const dtPoly* poly) const
+	{
+		const unsigned short* flags = m_tiles[m_nav->decodePolyIdTile(ref)].load(std::memory_order_acquire);
+		return flags ? flags[m_nav->decodePolyIdPoly(ref)] : poly->flags;
+	}
+
+	/// Sets the flags of the polygon in the overlay only.
+	///  @param[in]	ref		The reference id of the polygon.
+	///  @param[in]	flags	The new flags.
+	/// @returns The status flags for the operation.
+	dtStatus setPolyFlags(dtPolyRef ref, unsigned short flags);
+
+	/// Returns the flags of the polygon as seen through the overlay.
+	dtStatus getPolyFlags(dtPolyRef ref, unsigned short* resultFlags) const;
+
+	/// Returns the number of tiles copied in the overlay.
+	inline int getCopiedTileCount() const { return m_copiedTiles.load(std::memory_order_relaxed); }
+
+	/// Returns the shared navigation mesh.
+	inline const dtNavMesh* getNavMesh() const { return m_nav; }
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtPolyFlagsOverlay(const dtPolyFlagsOverlay&);
+	dtPolyFlagsOverlay& operator=(const dtPolyFlagsOverlay&);
+
+	const dtNavMesh* m_nav;
+	int m_maxTiles;
+	std::atomic<unsigned short*>* m_tiles;	///< Per tile flags, null until the first write to the tile.
+	std::atomic<int> m_copiedTiles;
+	std::mutex m_writeLock;
+};
+
+#endif // DETOURFLAGSOVERLAY_H
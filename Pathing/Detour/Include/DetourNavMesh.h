@@ -655,15 +655,23 @@ private:
 	bool getPolyHeight(const dtMeshTile* tile, const dtPoly* poly, const float* pos, float* height) const;
 	/// Returns closest point on polygon.
 	void closestPointOnPoly(dtPolyRef ref, const float* pos, float* closest, bool* posOverPoly) const;
+
+	/// Returns the position lookup slot of a tile location, or -1 if the location is outside the dense tile grid.
+	int getTileLutIndex(const int x, const int y) const;
+	/// Reallocates the position lookup as a dense grid or as a hash, and moves the tiles over.
+	dtStatus resizeTileLut(const bool dense, const int minX, const int minY, const int width, const int height);
 	
 	dtNavMeshParams m_params;			///< Current initialization params. TODO: do not store this info twice.
 	float m_orig[3];					///< Origin of the tile (0,0)
 	float m_tileWidth, m_tileHeight;	///< Dimensions of each tile.
 	int m_maxTiles;						///< Max number of tiles.
-	int m_tileLutSize;					///< Tile hash lookup size (must be pot).
+	int m_tileLutSize;					///< Tile lookup size (must be pot for the hash).
 	int m_tileLutMask;					///< Tile hash lookup mask.
+	bool m_tileLutDense;				///< True if the lookup is a dense grid indexed by tile location.
+	int m_tileLutMinX, m_tileLutMinY;	///< Location of the first cell of the dense grid.
+	int m_tileLutWidth, m_tileLutHeight;	///< Dimensions of the dense grid, in tiles.
 
-	dtMeshTile** m_posLookup;			///< Tile hash lookup.
+	dtMeshTile** m_posLookup;			///< Tile lookup, a dense grid or a hash.
 	dtMeshTile* m_nextFree;				///< Freelist of tiles.
 	dtMeshTile* m_tiles;				///< List of tiles.
 		
@@ -112,6 +112,15 @@ struct dtNavMeshCreateParams
 /// @return True if the tile data was successfully created.
 bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData, int* outDataSize);
 
+/// Builds the bounding volume tree of a tile from the bounds of its polygons.
+/// @ingroup detour
+///  @param[in]		polyBounds	The quantized bounds of each polygon. (See: #dtMeshHeader::bvQuantFactor)
+///  								[(bmin x, y, z, bmax x, y, z) * @p polyCount]
+///  @param[in]		polyCount	The number of polygons.
+///  @param[out]	nodes		The tree nodes. [Size: 2 * @p polyCount]
+/// @return The number of nodes of the tree.
+int dtCreateBVTree(const unsigned short* polyBounds, const int polyCount, struct dtBVNode* nodes);
+
 /// Swaps the endianess of the tile data's header (#dtMeshHeader).
 ///  @param[in,out]	data		The tile data array.
 ///  @param[in]		dataSize	The size of the data array.
@@ -20,6 +20,9 @@
 #define DETOURNAVMESHQUERY_H
 
 #include "DetourNavMesh.h"
+#include "DetourFlagsOverlay.h"
+#include "DetourPolyGrid.h"
+#include "DetourSearchGraph.h"
 #include "DetourStatus.h"
 
 
@@ -115,10 +118,64 @@ public:
 	/// @param[in]		flags		The new flags.
 	inline void setExcludeFlags(const unsigned short flags) { m_excludeFlags = flags; }	
 
+	/// Returns true if every area costs 1, the traversal cost is then the distance.
+	bool hasUnitAreaCosts() const;
+
 	///@}
 
 };
 
+/// Default filter applied to the flags and areas of a dtSearchGraph.
+/// The searches over the graph are templated on this class or on dtGraphUnitCostFilter.
+/// @ingroup detour
+class dtGraphFilter
+{
+	const dtQueryFilter* m_filter;
+	unsigned short m_includeFlags;
+	unsigned short m_excludeFlags;
+
+public:
+	explicit dtGraphFilter(const dtQueryFilter* filter) :
+		m_filter(filter), m_includeFlags(filter->getIncludeFlags()), m_excludeFlags(filter->getExcludeFlags()) { }
+
+	/// Returns true if a polygon with these flags can be visited.
+	inline bool passFlags(const unsigned short flags) const
+	{
+		return (flags & m_includeFlags) != 0 && (flags & m_excludeFlags) == 0;
+	}
+
+	/// Returns the cost per distance unit inside the polygon.
+	inline float getAreaCost(const dtSearchGraph* graph, dtPolyRef ref) const
+	{
+		return m_filter->getAreaCost(graph->getArea(ref));
+	}
+};
+
+/// dtGraphFilter of a filter whose area costs are all 1 (see dtQueryFilter::hasUnitAreaCosts):
+/// the neighbour test is the flags mask alone and the polygon areas are never read.
+/// @ingroup detour
+class dtGraphUnitCostFilter
+{
+	unsigned short m_includeFlags;
+	unsigned short m_excludeFlags;
+
+public:
+	explicit dtGraphUnitCostFilter(const dtQueryFilter* filter) :
+		m_includeFlags(filter->getIncludeFlags()), m_excludeFlags(filter->getExcludeFlags()) { }
+
+	/// Returns true if a polygon with these flags can be visited.
+	inline bool passFlags(const unsigned short flags) const
+	{
+		return (flags & m_includeFlags) != 0 && (flags & m_excludeFlags) == 0;
+	}
+
+	/// Returns the cost per distance unit inside the polygon.
+	inline float getAreaCost(const dtSearchGraph* /*graph*/, dtPolyRef /*ref*/) const
+	{
+		return 1.0f;
+	}
+};
+
 /// Provides information about raycast hit
 /// filled by dtNavMeshQuery::raycast
 /// @ingroup detour
@@ -159,6 +216,32 @@ public:
 	virtual void process(const dtMeshTile* tile, dtPoly** polys, dtPolyRef* refs, int count) = 0;
 };
 
+/// Provides a custom search heuristic.
+/// Used by dtNavMeshQuery::findPath.
+/// @ingroup detour
+class dtSearchHeuristic
+{
+public:
+	virtual ~dtSearchHeuristic() { }
+
+	/// Returns the estimated cost from @p pos, inside the polygon @p ref, to the end of the search.
+	/// Must not overestimate the actual cost for the search to return the shortest corridor.
+	virtual float getCost(dtPolyRef ref, const float* pos) const = 0;
+};
+
+/// Bounds the work of a search.
+/// Used by dtNavMeshQuery::findPath and dtNavMeshQuery::findRandomPointAroundCircle.
+/// @ingroup detour
+class dtSearchBudget
+{
+public:
+	virtual ~dtSearchBudget() { }
+
+	/// Called before each node expansion.
+	/// @returns False once the search must stop and return its best result so far.
+	virtual bool spend() = 0;
+};
+
 /// Provides the ability to perform pathfinding related queries against
 /// a navigation mesh.
 /// @ingroup detour
@@ -192,6 +275,23 @@ public:
 					  const dtQueryFilter* filter,
 					  dtPolyRef* path, int* pathCount, const int maxPath) const;
 
+	/// Finds a path from the start polygon to the end polygon using a custom heuristic.
+	///  @param[in]		startRef	The refrence id of the start polygon.
+	///  @param[in]		endRef		The reference id of the end polygon.
+	///  @param[in]		startPos	A position within the start polygon. [(x, y, z)]
+	///  @param[in]		endPos		A position within the end polygon. [(x, y, z)]
+	///  @param[in]		filter		The polygon filter to apply to the query.
+	///  @param[out]	path		An ordered list of polygon references representing the path. (Start to end.) 
+	///  							[(polyRef) * @p pathCount]
+	///  @param[out]	pathCount	The number of polygons returned in the @p path array.
+	///  @param[in]		maxPath		The maximum number of polygons the @p path array can hold. [Limit: >= 1]
+	///  @param[in]		searchHeuristic	The estimated cost to the end polygon, the distance to @p endPos if null. [opt]
+	dtStatus findPath(dtPolyRef startRef, dtPolyRef endRef,
+					  const float* startPos, const float* endPos,
+					  const dtQueryFilter* filter,
+					  dtPolyRef* path, int* pathCount, const int maxPath,
+					  const dtSearchHeuristic* searchHeuristic) const;
+
 	/// Finds the straight path from the start to the end position within the polygon corridor.
 	///  @param[in]		startPos			Path start position. [(x, y, z)]
 	///  @param[in]		endPos				Path end position. [(x, y, z)]
@@ -294,6 +394,21 @@ public:
 								  dtPolyRef* resultRef, dtPolyRef* resultParent, float* resultCost,
 								  int* resultCount, const int maxResult) const;
 	
+	/// Finds the travel cost from a start position to several target positions with a single Dijkstra search.
+	///  @param[in]		startRef		The reference id of the polygon where the search starts.
+	///  @param[in]		startPos		A position within @p startRef. [(x, y, z)]
+	///  @param[in]		targetRefs		The reference ids of the target polygons, zero for a target to skip. [(polyRef) * @p targetCount]
+	///  @param[in]		targetPos		A position within each target polygon. [(x, y, z) * @p targetCount]
+	///  @param[in]		targetCount		The number of targets.
+	///  @param[in]		maxCost			The search stops expanding polygons beyond this cost.
+	///  @param[in]		filter			The polygon filter to apply to the query.
+	///  @param[out]	costs			The search cost from @p startPos to each target, FLT_MAX if the target
+	///  								was not reached within @p maxCost. [(cost) * @p targetCount]
+	/// @returns The status flags for the query.
+	dtStatus findTravelCosts(dtPolyRef startRef, const float* startPos,
+							 const dtPolyRef* targetRefs, const float* targetPos, const int targetCount,
+							 const float maxCost, const dtQueryFilter* filter, float* costs) const;
+
 	/// Gets a path from the explored nodes in the previous search.
 	///  @param[in]		endRef		The reference id of the end polygon.
 	///  @param[out]	path		An ordered list of polygon references representing the path. (Start to end.)
@@ -305,7 +420,8 @@ public:
 	///  				if @p path cannot contain the entire path. In this case it is filled to capacity with a partial path.
 	///  				Otherwise returns DT_SUCCESS.
 	///  @remarks		The result of this function depends on the state of the query object. For that reason it should only
-	///  				be used immediately after one of the two Dijkstra searches, findPolysAroundCircle or findPolysAroundShape.
+	///  				be used immediately after one of the Dijkstra searches, findPolysAroundCircle, findPolysAroundShape
+	///  				or findTravelCosts.
 	dtStatus getPathFromDijkstraSearch(dtPolyRef endRef, dtPolyRef* path, int* pathCount, int maxPath) const;
 
 	/// @}
@@ -519,6 +635,68 @@ public:
 	/// @return The navigation mesh the query object is using.
 	const dtNavMesh* getAttachedNavMesh() const { return m_nav; }
 
+	/// Makes the query read the polygon flags through an overlay instead of the navigation mesh.
+	///  @param[in]		overlay		The overlay of the attached navigation mesh, or null. Must outlive the query.
+	void setFlagsOverlay(const dtPolyFlagsOverlay* overlay) { m_flagsOverlay = overlay; }
+
+	/// Gets the flags overlay used by the query, if any.
+	const dtPolyFlagsOverlay* getFlagsOverlay() const { return m_flagsOverlay; }
+
+	/// Makes findNearestPoly look first at the polygons of the grid cell under the center, the full
+	/// search only runs when the center does not stand on one of them. Results are the same.
+	///  @param[in]		grid		The grid of the attached navigation mesh, or null. Must outlive the query.
+	void setPolyGrid(const dtPolyGrid* grid) { m_polyGrid = grid; }
+
+	/// Gets the polygon grid used by the query, if any.
+	const dtPolyGrid* getPolyGrid() const { return m_polyGrid; }
+
+	/// Makes findPath expand the polygons through the edges of the search graph instead of the
+	/// tile links, when no flags overlay is set. Results are the same.
+	///  @param[in]	graph		The graph of the attached navigation mesh, or null. Must outlive the query.
+	void setSearchGraph(const dtSearchGraph* graph) { m_searchGraph = graph; }
+
+	/// Gets the search graph used by the query, if any.
+	const dtSearchGraph* getSearchGraph() const { return m_searchGraph; }
+
+	/// Attaches data of the owner of the query, not used by the query itself.
+	///  @param[in]	userData	The user data, or null.
+	void setUserData(void* userData) { m_userData = userData; }
+
+	/// Gets the user data of the query.
+	void* getUserData() const { return m_userData; }
+
+	/// Makes findPath and findRandomPointAroundCircle stop expanding nodes once the budget is spent.
+	/// findPath then returns the path to the node closest to the end with #DT_PARTIAL_RESULT.
+	///  @param[in]	budget		The budget of the next searches, or null for none.
+	void setSearchBudget(dtSearchBudget* budget) { m_searchBudget = budget; }
+
+	/// Gets the search budget used by the query, if any.
+	dtSearchBudget* getSearchBudget() const { return m_searchBudget; }
+
+	/// Gets the flags of the polygon, as seen by the query filters.
+	///  @param[in]		ref				The reference id of the polygon.
+	///  @param[out]	resultFlags		The polygon flags.
+	/// @returns The status flags for the query.
+	dtStatus getPolyFlags(dtPolyRef ref, unsigned short* resultFlags) const;
+
+	/// Returns the portal points between two adjacent polygons.
+	///  @param[in]		from		The reference id of the polygon the portal is left from.
+	///  @param[in]		to			The reference id of the polygon the portal leads to.
+	///  @param[out]	left		The left portal point. [(x, y, z)]
+	///  @param[out]	right		The right portal point. [(x, y, z)]
+	///  @param[out]	fromType	The type of the @p from polygon. (See: #dtPolyTypes)
+	///  @param[out]	toType		The type of the @p to polygon. (See: #dtPolyTypes)
+	/// @returns The status flags for the query.
+	dtStatus getPortalPoints(dtPolyRef from, dtPolyRef to, float* left, float* right,
+							 unsigned char& fromType, unsigned char& toType) const;
+
+	/// Returns the mid point of the portal between two adjacent polygons.
+	///  @param[in]		from		The reference id of the polygon the portal is left from.
+	///  @param[in]		to			The reference id of the polygon the portal leads to.
+	///  @param[out]	mid			The mid point of the portal. [(x, y, z)]
+	/// @returns The status flags for the query.
+	dtStatus getEdgeMidPoint(dtPolyRef from, dtPolyRef to, float* mid) const;
+
 	/// @}
 	
 private:
@@ -526,19 +704,38 @@ private:
 	dtNavMeshQuery(const dtNavMeshQuery&);
 	dtNavMeshQuery& operator=(const dtNavMeshQuery&);
 	
+	/// Applies the filter to the polygon flags, read through the flags overlay when set.
+	inline bool passFilter(const dtQueryFilter* filter, dtPolyRef ref, const dtMeshTile* tile, const dtPoly* poly) const
+	{
+		if (!m_flagsOverlay)
+			return filter->passFilter(ref, tile, poly);
+#ifndef DT_VIRTUAL_QUERYFILTER
+		// The default filter only reads the flags.
+		const unsigned short flags = m_flagsOverlay->getFlags(ref, poly);
+		return (flags & filter->getIncludeFlags()) != 0 && (flags & filter->getExcludeFlags()) == 0;
+#else
+		// A derived filter may read any field of the polygon.
+		dtPoly overlaid = *poly;
+		overlaid.flags = m_flagsOverlay->getFlags(ref, poly);
+		return filter->passFilter(ref, tile, &overlaid);
+#endif
+	}
+
 	/// Queries polygons within a tile.
 	void queryPolygonsInTile(const dtMeshTile* tile, const float* qmin, const float* qmax,
 							 const dtQueryFilter* filter, dtPolyQuery* query) const;
 
+	/// Queries the polygons of the box whose grid cell contains the center, in queryPolygons order.
+	/// Every polygon of the box containing the center is among them.
+	void queryPolygonsUnderPoint(const float* center, const float* halfExtents,
+								 const dtQueryFilter* filter, dtPolyQuery* query) const;
+
 	/// Returns portal points between two polygons.
-	dtStatus getPortalPoints(dtPolyRef from, dtPolyRef to, float* left, float* right,
-							 unsigned char& fromType, unsigned char& toType) const;
 	dtStatus getPortalPoints(dtPolyRef from, const dtPoly* fromPoly, const dtMeshTile* fromTile,
 							 dtPolyRef to, const dtPoly* toPoly, const dtMeshTile* toTile,
 							 float* left, float* right) const;
 	
 	/// Returns edge mid point between two polygons.
-	dtStatus getEdgeMidPoint(dtPolyRef from, dtPolyRef to, float* mid) const;
 	dtStatus getEdgeMidPoint(dtPolyRef from, const dtPoly* fromPoly, const dtMeshTile* fromTile,
 							 dtPolyRef to, const dtPoly* toPoly, const dtMeshTile* toTile,
 							 float* mid) const;
@@ -553,10 +750,23 @@ private:
 						   float* straightPath, unsigned char* straightPathFlags, dtPolyRef* straightPathRefs,
 						   int* straightPathCount, const int maxStraightPath, const int options) const;
 
+	/// findPath over the search graph, the input has been checked.
+	template <class TFilter>
+	dtStatus findPathGraph(dtPolyRef startRef, dtPolyRef endRef,
+						   const float* startPos, const float* endPos,
+						   const TFilter& filter,
+						   dtPolyRef* path, int* pathCount, const int maxPath,
+						   const dtSearchHeuristic* searchHeuristic) const;
+
 	// Gets the path leading to the specified end node.
 	dtStatus getPathToNode(struct dtNode* endNode, dtPolyRef* path, int* pathCount, int maxPath) const;
 	
 	const dtNavMesh* m_nav;				///< Pointer to navmesh data.
+	const dtPolyFlagsOverlay* m_flagsOverlay;	///< Per instance polygon flags. [opt]
+	const dtPolyGrid* m_polyGrid;		///< Polygon lookup grid. [opt]
+	const dtSearchGraph* m_searchGraph;	///< Flattened polygon links. [opt]
+	void* m_userData;					///< Data of the owner of the query. [opt]
+	dtSearchBudget* m_searchBudget;		///< Node expansion limit. [opt]
 
 	struct dtQueryData
 	{
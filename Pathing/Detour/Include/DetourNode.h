@@ -46,11 +46,22 @@ struct dtNode
 
 static const int DT_MAX_STATES_PER_NODE = 1 << DT_NODE_STATE_BITS;	// number of extra states per node. See dtNode::state
 
+/// Entry of the node pool hash table, only valid when its epoch is the current pool epoch.
+struct dtNodeSlot
+{
+	dtPolyRef id;					///< Polygon ref of the node.
+	unsigned short epoch;			///< Pool epoch the slot was filled in.
+	dtNodeIndex idx;				///< Index of the node in the pool.
+};
+
 class dtNodePool
 {
 public:
+	/// @param[in]	hashSize	Minimum size of the hash table, raised to keep it at most half full.
 	dtNodePool(int maxNodes, int hashSize);
 	~dtNodePool();
+
+	/// Removes every node. The hash table is invalidated by bumping the epoch, not cleared.
 	void clear();
 
 	// Get a dtNode by ref and extra state information. If there is none then - allocate
@@ -81,15 +92,12 @@ public:
 	{
 		return sizeof(*this) +
 			sizeof(dtNode)*m_maxNodes +
-			sizeof(dtNodeIndex)*m_maxNodes +
-			sizeof(dtNodeIndex)*m_hashSize;
+			sizeof(dtNodeSlot)*m_hashSize;
 	}
 	
 	inline int getMaxNodes() const { return m_maxNodes; }
 	
 	inline int getHashSize() const { return m_hashSize; }
-	inline dtNodeIndex getFirst(int bucket) const { return m_first[bucket]; }
-	inline dtNodeIndex getNext(int i) const { return m_next[i]; }
 	inline int getNodeCount() const { return m_nodeCount; }
 	
 private:
@@ -98,11 +106,11 @@ private:
 	dtNodePool& operator=(const dtNodePool&);
 	
 	dtNode* m_nodes;
-	dtNodeIndex* m_first;
-	dtNodeIndex* m_next;
+	dtNodeSlot* m_slots;				///< Open addressing hash table, linear probing.
 	const int m_maxNodes;
 	const int m_hashSize;
 	int m_nodeCount;
+	unsigned short m_epoch;
 };
 
 class dtNodeQueue
@@ -0,0 +1,59 @@
+#ifndef DETOURPOLYGRID_H
+#define DETOURPOLYGRID_H
+
+#include "DetourNavMesh.h"
+
+/// Uniform 2D grid over the xz-plane of every tile, each cell lists the bounding volume
+/// leaves overlapping it, in tree order. A polygon containing a point overlaps the cell
+/// under the point, so point lookups read one cell instead of every polygon of the query box.
+/// The leaves keep their quantized bounds, height included, stacked layers are told apart by
+/// the usual bounds test. Used through dtNavMeshQuery::setPolyGrid.
+/// @ingroup detour
+class dtPolyGrid
+{
+public:
+	dtPolyGrid();
+	~dtPolyGrid();
+
+	/// Builds the grid of every tile with a bounding volume tree.
+	///  @param[in]	nav		The navigation mesh, its tiles must not change while the grid is used.
+	/// @returns The status flags for the operation.
+	dtStatus init(const dtNavMesh* nav);
+
+	/// Gets the bounding volume leaves overlapping the cell under a point.
+	///  @param[in]	tile		The tile to query.
+	///  @param[in]	point		The point, quantized as in the tile bounding volume tree.
+	///  @param[out]	count		The number of leaves.
+	/// @returns The leaf node indices, in tree order, or null if the tile has no grid.
+	const unsigned short* getCellNodes(const dtMeshTile* tile, const unsigned short* point, int* count) const;
+
+	/// Returns the memory used by the grid, in bytes.
+	inline size_t getMemory() const { return m_memory; }
+
+	/// Returns the navigation mesh the grid was built for.
+	inline const dtNavMesh* getNavMesh() const { return m_nav; }
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtPolyGrid(const dtPolyGrid&);
+	dtPolyGrid& operator=(const dtPolyGrid&);
+
+	struct TileGrid
+	{
+		const dtMeshHeader* header;	///< Tile data the grid was built for, null without grid.
+		int width;					///< Cells along x.
+		int height;					///< Cells along z.
+		int cellSize;				///< Cell size in quantized units.
+		unsigned int* cells;		///< Start of each cell in #nodes. [(width * height) + 1]
+		unsigned short* nodes;		///< Leaf node indices, in tree order within each cell.
+	};
+
+	dtStatus initTile(const dtMeshTile* tile, TileGrid& grid);
+
+	const dtNavMesh* m_nav;
+	int m_maxTiles;
+	TileGrid* m_tiles;
+	size_t m_memory;
+};
+
+#endif // DETOURPOLYGRID_H
@@ -0,0 +1,105 @@
+#ifndef DETOURSEARCHGRAPH_H
+#define DETOURSEARCHGRAPH_H
+
+#include "DetourNavMesh.h"
+
+/// An edge of the search graph: a link of the polygon to a neighbour.
+/// @ingroup detour
+struct dtSearchGraphEdge
+{
+	float mid[3];				///< Mid point of the portal to the neighbour, as given by dtNavMeshQuery::getEdgeMidPoint.
+	dtPolyRef ref;				///< Neighbour polygon.
+	unsigned char crossSide;	///< Tile side crossed by the link, 0 inside the tile. (As used by dtNodePool::getNode.)
+};
+
+/// Compressed sparse row copy of the polygon links of every tile, made for the A* inner loop:
+/// the edges of a polygon are contiguous, in link order, with their portal mid point precomputed,
+/// and the flags and area of the polygons are packed in their own arrays. Used through
+/// dtNavMeshQuery::setSearchGraph.
+/// @ingroup detour
+class dtSearchGraph
+{
+public:
+	dtSearchGraph();
+	~dtSearchGraph();
+
+	/// Builds the graph of every tile.
+	///  @param[in]	nav		The navigation mesh, tiles added or removed later must be passed to #updateTilesAt.
+	/// @returns The status flags for the operation.
+	dtStatus init(const dtNavMesh* nav);
+
+	/// Rebuilds the graph of the tiles at and next to a location, whose links changed, and drops the
+	/// graph of the removed tiles. Call it after adding or removing the tiles at the location.
+	///  @param[in]	x		The x-location of the added or removed tile.
+	///  @param[in]	y		The y-location of the added or removed tile.
+	/// @returns The status flags for the operation.
+	dtStatus updateTilesAt(const int x, const int y);
+
+	/// Copies the flags of a polygon, to be called with dtNavMesh::setPolyFlags.
+	///  @param[in]	ref		The reference id of the polygon.
+	///  @param[in]	flags	The new flags of the polygon.
+	void setPolyFlags(dtPolyRef ref, unsigned short flags);
+
+	/// Gets the edges of a polygon.
+	///  @param[in]	ref		The reference id of the polygon, must be valid.
+	///  @param[out]	count	The number of edges.
+	/// @returns The edges, in link order, null if the tile has no graph.
+	inline const dtSearchGraphEdge* getEdges(dtPolyRef ref, int* count) const
+	{
+		const TileGraph& graph = m_tiles[m_nav->decodePolyIdTile(ref)];
+		if (!graph.firstEdge)
+		{
+			*count = 0;
+			return 0;
+		}
+		const unsigned int ip = m_nav->decodePolyIdPoly(ref);
+		*count = (int)(graph.firstEdge[ip + 1] - graph.firstEdge[ip]);
+		return &graph.edges[graph.firstEdge[ip]];
+	}
+
+	/// Returns the flags of a valid polygon, 0 if its tile has no graph.
+	inline unsigned short getFlags(dtPolyRef ref) const
+	{
+		const TileGraph& graph = m_tiles[m_nav->decodePolyIdTile(ref)];
+		return graph.flags ? graph.flags[m_nav->decodePolyIdPoly(ref)] : 0;
+	}
+
+	/// Returns the area of a valid polygon, 0 if its tile has no graph.
+	inline unsigned char getArea(dtPolyRef ref) const
+	{
+		const TileGraph& graph = m_tiles[m_nav->decodePolyIdTile(ref)];
+		return graph.areas ? graph.areas[m_nav->decodePolyIdPoly(ref)] : 0;
+	}
+
+	/// Returns the memory used by the graph, in bytes.
+	inline size_t getMemory() const { return m_memory; }
+
+	/// Returns the navigation mesh the graph was built for.
+	inline const dtNavMesh* getNavMesh() const { return m_nav; }
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtSearchGraph(const dtSearchGraph&);
+	dtSearchGraph& operator=(const dtSearchGraph&);
+
+	struct TileGraph
+	{
+		const dtMeshHeader* header;	///< Tile data the graph was built for, null without graph.
+		unsigned int salt;			///< Salt of the tile the graph was built for.
+		size_t memory;				///< Size of the block below.
+		unsigned int* firstEdge;	///< Start of the edges of each polygon in #edges. [(polyCount) + 1]
+		dtSearchGraphEdge* edges;	///< Edges, grouped by polygon.
+		unsigned short* flags;		///< Flags of each polygon. [(polyCount)]
+		unsigned char* areas;		///< Area of each polygon. [(polyCount)]
+	};
+
+	dtStatus initTile(const dtMeshTile* tile, const class dtNavMeshQuery& query, TileGraph& graph);
+	void freeTile(TileGraph& graph);
+
+	const dtNavMesh* m_nav;
+	int m_maxTiles;
+	TileGraph* m_tiles;
+	size_t m_memory;
+};
+
+#endif // DETOURSEARCHGRAPH_H
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "dol_detour.hpp"
+
+// Agents whose last path crosses a gate poly (GATE_FLAGS: doors and disabled polys, the polys
+// toggled at runtime). When a gate changes flags the agents whose filter no longer
+// passes it are queued, the server drains the queue with GetBlockedAgents and repairs their
+// corridor with AgentRepairPath instead of replotting every NPC near the door.
+class dtAgentTracker
+{
+public:
+	// replaces the gates tracked for the agent, empty to stop tracking it
+	void track(dtNavAgent *agent, std::vector<dtPolyRef> const &gates);
+
+	// stops tracking the agent and drops it from the queue, before it is freed
+	void remove(dtNavAgent *agent);
+
+	// to be called after mesh->setPolyFlags(ref, flags)
+	void polyFlagsChanged(dtPolyRef ref, unsigned short flags);
+
+	// moves up to maxAgents queued agents to agents, returns their number
+	int popBlocked(dtNavAgent **agents, int maxAgents);
+
+private:
+	void untrackLocked(dtNavAgent *agent);
+
+	std::unordered_map<dtPolyRef, std::vector<dtNavAgent *>> m_gateAgents;
+	std::vector<dtNavAgent *> m_blocked;
+	std::mutex m_lock;
+};
@@ -12,6 +12,38 @@
 
 #define MAX_POLY 256
 
+// status detail: the target lies on another island of the mesh for this filter
+static const unsigned int DT_UNREACHABLE = 1 << 8;
+// status detail: a *Budget query stopped on its dtQueryBudget limit, see below
+static const unsigned int DT_BUDGET_EXHAUSTED = 1 << 9;
+
+// game units (x, y, z with z up) to detour units (x, y up, z), see LocalPathingMgr.CoordinateToRecastFloatArray
+static const float GAME_TO_DETOUR = 1.0f / 32.0f;
+static const float DETOUR_TO_GAME = 32.0f;
+// game positions are lifted a bit so the search center is above the ground
+static const float GAME_Z_OFFSET = 8.0f;
+
+inline void dtGameToDetour(float const* game, float* detour)
+{
+	detour[0] = game[0] * GAME_TO_DETOUR;
+	detour[1] = (game[2] + GAME_Z_OFFSET) * GAME_TO_DETOUR;
+	detour[2] = game[1] * GAME_TO_DETOUR;
+}
+
+inline void dtGameExtentsToDetour(float const* game, float* detour)
+{
+	detour[0] = game[0] * GAME_TO_DETOUR;
+	detour[1] = game[2] * GAME_TO_DETOUR;
+	detour[2] = game[1] * GAME_TO_DETOUR;
+}
+
+inline void dtDetourToGame(float const* detour, float* game)
+{
+	game[0] = detour[0] * DETOUR_TO_GAME;
+	game[1] = detour[2] * DETOUR_TO_GAME;
+	game[2] = detour[1] * DETOUR_TO_GAME;
+}
+
 enum dtPolyFlags : unsigned short
 {
 	WALK = 0x01,        // Ability to walk (ground, grass, road)
@@ -25,15 +57,206 @@ enum dtPolyFlags : unsigned short
 	ALL = 0xffff        // All abilities.
 };
 
+// Filters of the movement classes and realms, as {include, exclude} for the queryFilter[] of the
+// exports. They keep the unit area costs, so the searches over a search graph run their flags-only
+// instantiation (dtGraphUnitCostFilter)
+enum dtFilterPreset : unsigned int
+{
+	DT_FILTER_DEFAULT = 0, // every poly but the disabled ones
+	DT_FILTER_WALK,        // land movers, no water
+	DT_FILTER_SWIM,        // water movers
+	DT_FILTER_ALB,         // Albion: no Midgard or Hibernia doors
+	DT_FILTER_MID,         // Midgard: no Albion or Hibernia doors
+	DT_FILTER_HIB,         // Hibernia: no Albion or Midgard doors
+	DT_FILTER_PRESET_COUNT
+};
+
+static constexpr dtPolyFlags dtFilterPresetFlags[DT_FILTER_PRESET_COUNT][2] = {
+	{(dtPolyFlags)(ALL ^ DISABLED), (dtPolyFlags)0},
+	{(dtPolyFlags)(ALL ^ DISABLED), SWIM},
+	{SWIM, DISABLED},
+	{(dtPolyFlags)(ALL ^ DISABLED), (dtPolyFlags)(DOOR_MID | DOOR_HIB)},
+	{(dtPolyFlags)(ALL ^ DISABLED), (dtPolyFlags)(DOOR_ALB | DOOR_HIB)},
+	{(dtPolyFlags)(ALL ^ DISABLED), (dtPolyFlags)(DOOR_ALB | DOOR_MID)},
+};
+
+// PathStraightEx options
+enum dtPathOptions : unsigned int
+{
+	DT_PATH_DEFAULT = 0,
+	DT_PATH_LANDMARKS = 0x01,   // A* guided by the landmark table, when built with BuildLandmarks
+	DT_PATH_RAYCAST = 0x02,     // straight line without A* when the ray to the end stays on one flag class
+	DT_PATH_KEEP_COLLINEAR = 0x04, // skip the removal of the waypoints lying between their neighbours
+	DT_PATH_SHORTCUT = 0x08,    // skip the waypoints between points joined by a clear navmesh ray
+};
+
+// LoadNavMeshEx options
+enum dtLoadOptions : unsigned int
+{
+	DT_LOAD_DEFAULT = 0,                // one allocation per tile
+	DT_LOAD_ARENA = 0x01,               // all the tile data in one block, freed at once by FreeNavMesh
+	DT_LOAD_HUGE_PAGES = 0x02,          // arena backed by transparent huge pages (Linux, implies DT_LOAD_ARENA)
+	DT_LOAD_EXPLICIT_HUGE_PAGES = 0x04, // arena in reserved huge pages, transparent ones if none is free
+	DT_LOAD_POLY_GRID = 0x08,           // build the poly lookup grid, see BuildPolyGrid
+	DT_LOAD_SEARCH_GRAPH = 0x10,        // build the flattened A* graph, see BuildSearchGraph
+};
+
+// limits of the *Budget queries, 0 for none: once either is reached the search stops expanding
+// nodes and the query answers from the polys visited so far, with DT_PARTIAL_RESULT | DT_BUDGET_EXHAUSTED
+struct dtQueryBudget
+{
+	unsigned int maxNodes;        // A* / Dijkstra node expansions
+	unsigned int maxMicroseconds; // wall time of the call, checked every few expansions
+	unsigned int nodes;           // out: nodes expanded
+	unsigned int microseconds;    // out: wall time of the call
+};
+
+// counters of the PathStraight family since the library load or the last reset
+struct dtPathStats
+{
+	unsigned long long queries;     // paths computed from start/end polys
+	unsigned long long unreachable; // rejected by the islands before A*
+	unsigned long long raycastHits; // answered by the raycast fast path
+};
+
 DLLEXPORT bool LoadNavMesh(char const* file, dtNavMesh** const mesh);
+DLLEXPORT bool LoadNavMeshEx(char const* file, dtLoadOptions options, dtNavMesh** const mesh);
 DLLEXPORT bool FreeNavMesh(dtNavMesh* meshPtr);
 
 DLLEXPORT bool CreateNavMeshQuery(dtNavMesh* mesh, dtNavMeshQuery** const query);
 DLLEXPORT bool FreeNavMeshQuery(dtNavMeshQuery* query);
 
 DLLEXPORT dtStatus PathStraight(dtNavMeshQuery* query, float start[], float end[], float polyPickExt[], dtPolyFlags queryFilter[], dtStraightPathOptions pathOptions, int* pointCount, float* pointBuffer, dtPolyFlags* pointFlags);
+DLLEXPORT dtStatus PathStraightEx(dtNavMeshQuery* query, float start[], float end[], float polyPickExt[], dtPolyFlags queryFilter[], dtStraightPathOptions pathOptions, dtPathOptions options, int* pointCount, float* pointBuffer, dtPolyFlags* pointFlags);
 DLLEXPORT dtStatus FindRandomPointAroundCircle(dtNavMeshQuery* query, float center[], float radius, float polyPickExt[], dtPolyFlags queryFilter[], float* outputVector);
 DLLEXPORT dtStatus FindClosestPoint(dtNavMeshQuery* query, float center[], float polyPickExt[], dtPolyFlags queryFilter[], float* outputVector);
+// Roaming: a random point within radius of start, area weighted as FindRandomPointAroundCircle,
+// and the path to it. The corridor comes from the search tree of the random pick, so there is no
+// second search as with FindRandomPointAroundCircle then PathStraight. outputVector is the last
+// point of the path. Not traced
+DLLEXPORT dtStatus FindRandomRoamPath(dtNavMeshQuery* query, float start[], float radius, float polyPickExt[], dtPolyFlags queryFilter[], dtStraightPathOptions pathOptions, float* outputVector, int* pointCount, float* pointBuffer, dtPolyFlags* pointFlags);
+// Travel cost from start to each of the count targets [(x, y, z) * count] with one Dijkstra search,
+// bounded by maxCost (navmesh units, 0 for none). costs[i] is FLT_MAX for a target unreachable within
+// maxCost, best receives the index of the cheapest target or -1. pointCount [opt] receives the path
+// to the best target in pointBuffer [MAX_POLY * 3] and pointFlags [MAX_POLY]. Not traced
+DLLEXPORT dtStatus GetTravelCosts(dtNavMeshQuery* query, float start[], int count, float targets[], float maxCost, float polyPickExt[], dtPolyFlags queryFilter[], dtStraightPathOptions pathOptions, float* costs, int* best, int* pointCount, float* pointBuffer, dtPolyFlags* pointFlags);
+// PathStraightEx / FindRandomPointAroundCircle with a hard cap on the search: a path cut by the budget
+// leads to the visited poly closest to the end, a random point is picked among the visited polys.
+// Not traced, the result depends on the timing
+DLLEXPORT dtStatus PathStraightBudget(dtNavMeshQuery* query, float start[], float end[], float polyPickExt[], dtPolyFlags queryFilter[], dtStraightPathOptions pathOptions, dtPathOptions options, dtQueryBudget* budget, int* pointCount, float* pointBuffer, dtPolyFlags* pointFlags);
+DLLEXPORT dtStatus FindRandomPointAroundCircleBudget(dtNavMeshQuery* query, float center[], float radius, float polyPickExt[], dtPolyFlags queryFilter[], dtQueryBudget* budget, float* outputVector);
 DLLEXPORT dtStatus GetPolyAt(dtNavMeshQuery* query, float* center, float* extents, unsigned short* queryFilter, dtPolyRef* polyRef, float* point);
 DLLEXPORT dtStatus SetPolyFlags(dtNavMesh* navMesh, dtPolyRef ref, unsigned short flags);
+DLLEXPORT bool GetPathStats(dtPathStats* stats, bool reset);
+// seeds the generator of the random point queries on the calling thread, for reproducible runs
+DLLEXPORT void SeedRandom(unsigned int seed);
+// queryFilter[2] of a dtFilterPreset, false for an unknown preset
+DLLEXPORT bool GetFilterPreset(dtFilterPreset preset, dtPolyFlags* queryFilter);
+// builds the landmark table of a loaded navmesh, before any query runs on it
+DLLEXPORT dtStatus BuildLandmarks(dtNavMesh* navMesh, int landmarkCount, int* memory);
+// per tile grid of the polys under each cell: GetPolyAt, FindClosestPoint and the PathStraight ends
+// read a cell or two instead of walking the BV tree. Used by the queries created after the call,
+// built once, memory [opt] receives its size in bytes
+DLLEXPORT dtStatus BuildPolyGrid(dtNavMesh* navMesh, int* memory);
+// copy of the poly links as contiguous edges with their portal mid point: the A* of the PathStraight
+// family reads them instead of the tile links. Used by the queries created after the call, kept in
+// sync by SetPolyFlags, built once, memory [opt] receives its size in bytes
+DLLEXPORT dtStatus BuildSearchGraph(dtNavMesh* navMesh, int* memory);
 DLLEXPORT dtStatus QueryPolygons(dtNavMeshQuery* query, float* center, float* polyPickExtents, unsigned short* queryFilter, dtPolyRef* polys, int* polyCount, int maxPolys);
+DLLEXPORT dtStatus IsReachable(dtNavMeshQuery* query, float start[], float end[], float polyPickExt[], dtPolyFlags queryFilter[], bool* reachable);
+
+// Query trace: records every PathStraight / FindRandomPointAroundCircle / FindClosestPoint / GetPolyAt /
+// SetPolyFlags / QueryPolygons / IsReachable / BuildLandmarks call to a binary file, replayed by detour_replay
+DLLEXPORT bool StartTrace(char const* file);
+DLLEXPORT bool StopTrace();
+
+// Flow field: one reverse Dijkstra from a target shared by every agent converging on it
+struct dtFlowField;
+
+DLLEXPORT dtStatus CreateFlowField(dtNavMeshQuery* query, float target[], float radius, float polyPickExt[], dtPolyFlags queryFilter[], dtFlowField** field);
+DLLEXPORT dtStatus UpdateFlowField(dtNavMeshQuery* query, dtFlowField* field, float target[], float polyPickExt[]);
+DLLEXPORT dtStatus FlowFieldNextWaypoint(dtNavMeshQuery* query, dtFlowField* field, float position[], float polyPickExt[], float* outputVector, float* outputCost);
+DLLEXPORT bool FreeFlowField(dtFlowField* field);
+
+// Batched spatial queries, centers are [(x, y, z) * count] and results are written per center
+DLLEXPORT dtStatus FindDistanceToWallBatch(dtNavMeshQuery* query, int count, float centers[], float maxRadius, float polyPickExt[], dtPolyFlags queryFilter[], float* hitDists, float* hitPositions, float* hitNormals, dtStatus* statuses);
+DLLEXPORT dtStatus FindLocalNeighbourhoodBatch(dtNavMeshQuery* query, int count, float centers[], float radius, float polyPickExt[], dtPolyFlags queryFilter[], int maxPolys, dtPolyRef* polys, int* polyCounts, dtStatus* statuses);
+DLLEXPORT dtStatus FindPolysAroundCircleBatch(dtNavMeshQuery* query, int count, float centers[], float radius, float polyPickExt[], dtPolyFlags queryFilter[], int maxPolys, dtPolyRef* polys, float* costs, int* polyCounts, dtStatus* statuses);
+DLLEXPORT dtStatus MoveAlongSurfaceBatch(dtNavMeshQuery* query, int count, dtPolyRef* polyRefs, float from[], float to[], float polyPickExt[], dtPolyFlags queryFilter[], float* resultPositions, unsigned char* clamped, dtStatus* statuses);
+DLLEXPORT dtStatus SnapToGroundBatch(dtNavMeshQuery* query, int count, float positions[], float extents[], dtPolyFlags queryFilter[], float* heights, dtPolyRef* polyRefs, unsigned char* onMesh, dtStatus* statuses);
+
+// Agent handles: cache the poly of a moving entity so queries skip the nearest-poly search
+struct dtNavAgent;
+
+DLLEXPORT dtStatus CreateAgent(dtNavMeshQuery* query, float position[], float polyPickExt[], dtPolyFlags queryFilter[], dtNavAgent** agent);
+DLLEXPORT dtStatus UpdateAgent(dtNavMeshQuery* query, dtNavAgent* agent, float position[], float* outputVector);
+DLLEXPORT dtStatus GetAgentPosition(dtNavAgent* agent, dtPolyRef* polyRef, float* outputVector);
+DLLEXPORT dtStatus AgentPathStraight(dtNavMeshQuery* query, dtNavAgent* agent, float end[], dtStraightPathOptions pathOptions, int* pointCount, float* pointBuffer, dtPolyFlags* pointFlags);
+DLLEXPORT dtStatus AgentPathToAgent(dtNavMeshQuery* query, dtNavAgent* agent, dtNavAgent* target, dtStraightPathOptions pathOptions, int* pointCount, float* pointBuffer, dtPolyFlags* pointFlags);
+DLLEXPORT dtStatus AgentFindRandomPointAroundCircle(dtNavMeshQuery* query, dtNavAgent* agent, float radius, float* outputVector);
+// Door changes: SetPolyFlags queues the agents whose last path crosses a door or disabled poly their
+// filter no longer passes. GetBlockedAgents drains the queue of a navmesh, AgentRepairPath routes the
+// rest of the agent corridor around the blocked polys, and only replans from scratch when no local
+// detour exists. Agents created with an instance query follow SetInstancePolyFlags and
+// GetInstanceBlockedAgents instead. Agents must be freed before their navmesh or instance.
+DLLEXPORT int GetBlockedAgents(dtNavMesh* navMesh, dtNavAgent** agents, int maxAgents);
+DLLEXPORT dtStatus AgentRepairPath(dtNavMeshQuery* query, dtNavAgent* agent, dtStraightPathOptions pathOptions, int* pointCount, float* pointBuffer, dtPolyFlags* pointFlags);
+DLLEXPORT bool FreeAgent(dtNavAgent* agent);
+
+// Game API: blittable structs in game units (x, y, z with z up), converted to detour space natively.
+// Nothing is allocated and every output goes to caller memory (stackalloc or pinned spans), so the
+// managed side needs no array marshalling. None of these calls calls back into the caller.
+struct dtGameVector
+{
+	float x, y, z;
+};
+
+struct dtGameQueryParams
+{
+	dtGameVector extents;     // half extents of the nearest-poly search, game units
+	unsigned short includeFlags;
+	unsigned short excludeFlags;
+};
+
+struct dtGamePathPoint
+{
+	dtGameVector position;
+	unsigned int flags;       // dtPolyFlags of the poly entered at this point, widened for alignment
+};
+
+DLLEXPORT dtStatus GamePathStraight(dtNavMeshQuery* query, dtGameVector const* start, dtGameVector const* end, dtGameQueryParams const* params, dtStraightPathOptions pathOptions, dtPathOptions options, dtGamePathPoint* points, int maxPoints, int* pointCount);
+DLLEXPORT dtStatus GameFindRandomPointAroundCircle(dtNavMeshQuery* query, dtGameVector const* center, float radius, dtGameQueryParams const* params, dtGameVector* result);
+DLLEXPORT dtStatus GameFindClosestPoint(dtNavMeshQuery* query, dtGameVector const* center, dtGameQueryParams const* params, dtGameVector* result);
+DLLEXPORT dtStatus GameGetPolyAt(dtNavMeshQuery* query, dtGameVector const* center, dtGameQueryParams const* params, dtPolyRef* polyRef, dtGameVector* result);
+DLLEXPORT dtStatus GameIsReachable(dtNavMeshQuery* query, dtGameVector const* start, dtGameVector const* end, dtGameQueryParams const* params, int* reachable);
+
+// Function table of the game API, fetched once and invoked with unmanaged calli
+// (delegate* unmanaged[Cdecl]) instead of one DllImport stub per call. The calls take locks and
+// the path searches run for milliseconds, so they must keep the GC transition.
+static const unsigned int DT_GAME_API_VERSION = 1;
+
+struct dtGameApi
+{
+	unsigned int version; // DT_GAME_API_VERSION
+	unsigned int size;    // sizeof(dtGameApi), new entries are only appended
+	dtStatus (*pathStraight)(dtNavMeshQuery*, dtGameVector const*, dtGameVector const*, dtGameQueryParams const*, dtStraightPathOptions, dtPathOptions, dtGamePathPoint*, int, int*);
+	dtStatus (*findRandomPointAroundCircle)(dtNavMeshQuery*, dtGameVector const*, float, dtGameQueryParams const*, dtGameVector*);
+	dtStatus (*findClosestPoint)(dtNavMeshQuery*, dtGameVector const*, dtGameQueryParams const*, dtGameVector*);
+	dtStatus (*getPolyAt)(dtNavMeshQuery*, dtGameVector const*, dtGameQueryParams const*, dtPolyRef*, dtGameVector*);
+	dtStatus (*isReachable)(dtNavMeshQuery*, dtGameVector const*, dtGameVector const*, dtGameQueryParams const*, int*);
+	dtStatus (*setPolyFlags)(dtNavMesh*, dtPolyRef, unsigned short);
+};
+
+DLLEXPORT dtGameApi const* GetGameApi();
+
+// Navmesh instances: zones reusing the navmesh of a base zone with their own poly flags (doors).
+// SetPolyFlags on the base navmesh reaches the instances in the tiles they never wrote.
+// Free the instance queries before the instance, and every instance before the shared navmesh.
+struct dtNavMeshInstance;
+
+DLLEXPORT dtStatus CreateNavMeshInstance(dtNavMesh* mesh, dtNavMeshInstance** instance);
+DLLEXPORT bool CreateInstanceQuery(dtNavMeshInstance* instance, dtNavMeshQuery** const query);
+DLLEXPORT dtStatus SetInstancePolyFlags(dtNavMeshInstance* instance, dtPolyRef ref, unsigned short flags);
+DLLEXPORT dtStatus GetInstancePolyFlags(dtNavMeshInstance* instance, dtPolyRef ref, unsigned short* flags);
+DLLEXPORT int GetInstanceBlockedAgents(dtNavMeshInstance* instance, dtNavAgent** agents, int maxAgents);
+DLLEXPORT bool FreeNavMeshInstance(dtNavMeshInstance* instance);
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "dol_detour.hpp"
+
+// Helpers shared by the DOL sources, not exported from the library.
+
+class dtIslands;
+
+// uniform random number in [0, 1), one generator per thread
+float frand();
+
+// islands of the query navmesh, nullptr when they cannot answer for this query: the islands
+// follow the shared flags, not the doors changed in an instance overlay
+dtIslands* GetQueryIslands(dtNavMeshQuery const* query);
+
+// PathStraight once both ends are resolved to polys, start must lie inside startRef.
+// corridor [opt] receives the polys found by A*, [MAX_POLY], none for the raycast fast path
+dtStatus PathStraightFromPolys(dtNavMeshQuery* query, dtPolyRef startRef, dtPolyRef endRef, float const* start, float const* end, dtQueryFilter const* filter, dtStraightPathOptions pathOptions, dtPathOptions options, int* pointCount, float* pointBuffer, dtPolyFlags* pointFlags, dtPolyRef* corridor = nullptr, int* corridorCount = nullptr);
+
+// the straight path and post-processing of PathStraightFromPolys along a known corridor
+dtStatus StraightPathFromCorridor(dtNavMeshQuery* query, dtPolyRef const* polys, int npolys, dtPolyRef endRef, float const* start, float const* end, dtQueryFilter const* filter, dtStraightPathOptions pathOptions, dtPathOptions options, int* pointCount, float* pointBuffer, dtPolyFlags* pointFlags);
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "dol_polyindex.hpp"
+
+// flags toggled at runtime, polys carrying them get a component of their own
+static const unsigned short GATE_FLAGS = DOOR | DOOR_ALB | DOOR_MID | DOOR_HIB | DISABLED;
+
+// Connected components of a navmesh, used to reject unreachable targets without running A*.
+//
+// Polys are grouped into components of linked polys sharing the same flags, so each component
+// passes or fails a filter as a whole. Polys that are toggled at runtime (doors, disabled polys)
+// are kept as components of their own: changing their flags only updates the component flags.
+// The reachability for a given filter is a union-find over the (small) component graph,
+// cached per include/exclude pair until the next flags change.
+class dtIslands
+{
+public:
+	dtIslands() : m_version(0) {}
+
+	// labels every poly of the mesh, the mesh must be fully loaded
+	void build(dtNavMesh const *mesh);
+
+	// to be called after mesh->setPolyFlags(ref, flags)
+	void polyFlagsChanged(dtPolyRef ref, unsigned short flags);
+
+	// false only if no path exists between the two polys for this filter,
+	// unknown polys (added after build) are considered reachable
+	bool isReachable(dtPolyRef from, dtPolyRef to, dtQueryFilter const *filter);
+
+private:
+	struct Labels
+	{
+		unsigned int version;
+		std::vector<unsigned int> roots; // per component, the same root when connected
+	};
+
+	void buildLocked();
+	void updateLabels(Labels &labels, unsigned short includeFlags, unsigned short excludeFlags) const;
+
+	dtPolyIndex m_polys;
+	std::vector<unsigned int> m_polyComponent;
+	std::vector<unsigned short> m_componentFlags;
+	std::vector<unsigned char> m_componentSingle; // component made of a single poly
+	std::vector<unsigned long long> m_componentLinks; // (a << 32) | b with a < b
+	unsigned int m_version;
+	std::unordered_map<unsigned int, Labels> m_labels;
+	std::shared_mutex m_lock;
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vector>
+
+#include "dol_polyindex.hpp"
+
+// Landmark table for the ALT heuristic (A*, Landmarks, Triangle inequality).
+//
+// The search measures its costs between portal midpoints: each node sits on the midpoint of one
+// portal of its poly, and each step goes to a portal of a neighbour poly. The landmark graph has
+// one node per portal and links every portal of a poly to every portal of its neighbours, weighted
+// by the shortest distance between their midpoints, so no step of the search is shorter than the
+// graph edge it follows. For K landmark portals we store the graph distance from the landmark to
+// every portal, and |d(L, target) - d(L, portal)| is a lower bound of the travel cost between the
+// portal and the target. Unlike the straight line distance, it follows the walls of dungeons and
+// mountain passes. Distances are measured on the unfiltered mesh, which bounds every filter with
+// area costs of at least 1, and quantized on 16 bits: the heuristic subtracts one quantization step.
+class dtLandmarks
+{
+public:
+	static const int MAX_LANDMARKS = 32;
+	static const unsigned short UNREACHED = 0xffff;
+
+	dtLandmarks() : m_count(0), m_quantum(0) {}
+
+	// picks the landmarks by farthest point selection and floods the portal graph from each of them
+	bool build(dtNavMesh const *mesh, int count);
+
+	inline int getCount() const { return m_count; }
+	inline float getQuantum() const { return m_quantum; }
+	inline dtPolyIndex const &getPolys() const { return m_polys; }
+	// portals of the poly, indexes into the portal tables
+	inline int const *getPolyPortals(int polyIndex, int *count) const
+	{
+		*count = m_polyFirstPortal[polyIndex + 1] - m_polyFirstPortal[polyIndex];
+		return m_polyPortals.data() + m_polyFirstPortal[polyIndex];
+	}
+	// distances of the portal to the landmarks, getCount() values
+	inline unsigned short const *getDistances(int portal) const { return &m_distances[(size_t)portal * m_count]; }
+	// the two midpoints of the portal, one per crossing direction
+	inline float const *getMidPoints(int portal) const { return &m_midPoints[(size_t)portal * 6]; }
+	// smallest then largest distance to each landmark over the portals of the poly, 2 * getCount() values
+	inline unsigned short const *getPolyRanges(int polyIndex) const { return &m_polyRanges[(size_t)polyIndex * m_count * 2]; }
+	// size of the table in bytes
+	size_t getMemory() const;
+
+private:
+	dtPolyIndex m_polys;
+	int m_count;
+	float m_quantum; // distance of one step of the quantized distances
+	std::vector<int> m_polyFirstPortal;
+	std::vector<int> m_polyPortals;
+	std::vector<float> m_midPoints;
+	std::vector<unsigned short> m_distances; // portal major: m_count distances per portal
+	std::vector<unsigned short> m_polyRanges; // poly major: m_count minimums then m_count maximums
+};
+
+class dtLandmarkHeuristic : public dtSearchHeuristic
+{
+public:
+	dtLandmarkHeuristic(dtLandmarks const *landmarks, dtPolyRef endRef, float const *endPos);
+	float getCost(dtPolyRef ref, const float *pos) const override;
+
+private:
+	dtLandmarks const *m_landmarks;
+	float m_endPos[3];
+	bool m_valid;
+	float m_endCosts[dtLandmarks::MAX_LANDMARKS]; // landmark to end position, FLT_MAX when unreached
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "dol_agents.hpp"
+#include "dol_islands.hpp"
+#include "dol_landmarks.hpp"
+#include "DetourFlagsOverlay.h"
+#include "DetourPolyGrid.h"
+#include "DetourSearchGraph.h"
+
+// One block holding the data of every tile of a navmesh (see LoadNavMeshEx).
+// Tiles are added without DT_TILE_FREE_DATA, the whole block is released with the navmesh.
+class dtNavMeshArena
+{
+public:
+	// hugePages: 1 for transparent huge pages (madvise), 2 for explicit huge pages (falls back to 1)
+	static dtNavMeshArena *create(size_t size, int hugePages);
+	~dtNavMeshArena();
+
+	// 16 bytes aligned slice, nullptr when the arena is full
+	void *allocate(size_t size);
+	inline size_t getSize() const { return m_size; }
+	inline bool isHugePages() const { return m_hugePages; }
+
+private:
+	dtNavMeshArena() : m_data(nullptr), m_size(0), m_used(0), m_mapped(false), m_hugePages(false) {}
+	unsigned char *m_data;
+	size_t m_size;
+	size_t m_used;
+	bool m_mapped;
+	bool m_hugePages;
+};
+
+// Instanced zone (dungeon instance, housing) sharing the navmesh of its base zone.
+// Only the flags of the polys changed in the instance are stored, per tile on the first write.
+// The tiles the instance never wrote follow SetPolyFlags on the base zone.
+struct dtNavMeshInstance
+{
+	dtNavMesh *mesh;
+	dtPolyFlagsOverlay overlay;
+	dtAgentTracker agents; // agents created with an instance query, notified by SetInstancePolyFlags
+};
+
+// DOL data attached to a loaded navmesh, created by LoadNavMesh and freed by FreeNavMesh
+struct dtNavMeshInfo
+{
+	dtIslands islands;
+	dtAgentTracker agents;                  // agents whose path crosses a gate poly
+	std::unique_ptr<dtLandmarks> landmarks; // optional, see BuildLandmarks
+	std::unique_ptr<dtPolyGrid> polyGrid;   // optional, see BuildPolyGrid
+	std::unique_ptr<dtSearchGraph> searchGraph; // optional, see BuildSearchGraph
+	std::unique_ptr<dtNavMeshArena> arena;  // tile data when loaded in an arena
+	std::vector<dtNavMeshInstance *> instances; // see CreateNavMeshInstance
+	std::mutex instancesLock;               // guards instances
+	std::string file;                       // as given to LoadNavMesh
+	std::atomic<unsigned int> traceGeneration{0}; // trace in which traceId was assigned
+	std::uint16_t traceId = 0;
+};
+
+dtNavMeshInfo *RegisterNavMesh(dtNavMesh const *mesh);
+// the returned info must outlive the navmesh when it owns the tile data
+std::unique_ptr<dtNavMeshInfo> UnregisterNavMesh(dtNavMesh const *mesh);
+// nullptr for meshes not loaded through LoadNavMesh
+dtNavMeshInfo *GetNavMeshInfo(dtNavMesh const *mesh);
+// info of the navmesh of a query created by CreateNavMeshQuery, without the registry lookup
+inline dtNavMeshInfo *GetQueryInfo(dtNavMeshQuery const *query) { return static_cast<dtNavMeshInfo *>(query->getUserData()); }
+// instance of a query created by CreateInstanceQuery, nullptr for the other queries
+dtNavMeshInstance *GetQueryInstance(dtNavMeshQuery const *query);
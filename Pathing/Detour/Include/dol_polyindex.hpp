@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+
+#include "dol_detour.hpp"
+
+// Dense numbering of the polys of a navmesh (tile base + poly index), used to key per-poly tables.
+// Tiles added or replaced after build are not indexed, their polys get -1.
+class dtPolyIndex
+{
+public:
+	dtPolyIndex() : m_mesh(nullptr), m_polyCount(0) {}
+
+	void build(dtNavMesh const *mesh)
+	{
+		m_mesh = mesh;
+		auto maxTiles = mesh->getMaxTiles();
+		m_tileBase.assign(maxTiles, -1);
+		m_tileSalt.assign(maxTiles, 0);
+		m_tilePolyCount.assign(maxTiles, 0);
+		m_polyCount = 0;
+		for (int i = 0; i < maxTiles; ++i)
+		{
+			auto tile = mesh->getTile(i);
+			if (!tile->header)
+				continue;
+			m_tileBase[i] = m_polyCount;
+			m_tileSalt[i] = tile->salt;
+			m_tilePolyCount[i] = tile->header->polyCount;
+			m_polyCount += tile->header->polyCount;
+		}
+	}
+
+	inline int getPolyIndex(dtPolyRef ref) const
+	{
+		if (!ref || !m_mesh)
+			return -1;
+		unsigned int salt, it, ip;
+		m_mesh->decodePolyId(ref, salt, it, ip);
+		if (it >= m_tileBase.size() || m_tileBase[it] < 0 || m_tileSalt[it] != salt || (int)ip >= m_tilePolyCount[it])
+			return -1;
+		return m_tileBase[it] + (int)ip;
+	}
+
+	// first index of the polys of the tile, -1 if the tile was empty at build time
+	inline int getTileBase(int tileIndex) const { return m_tileBase[tileIndex]; }
+	inline int getPolyCount() const { return m_polyCount; }
+	inline dtNavMesh const *getMesh() const { return m_mesh; }
+
+private:
+	dtNavMesh const *m_mesh;
+	int m_polyCount;
+	std::vector<int> m_tileBase;
+	std::vector<unsigned int> m_tileSalt;
+	std::vector<int> m_tilePolyCount;
+};
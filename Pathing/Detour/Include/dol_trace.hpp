@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+
+#include "dol_detour.hpp"
+
+// Query trace: every traced export appends one record to a per-thread buffer, full buffers are
+// written to the trace file by a background thread. Read back by Tools/replay.cpp.
+//
+// File: dtTraceFileHeader then records. Record: dtTraceRecordHeader then `size` payload bytes,
+// the payload is the inputs then the outputs of the call, in parameter order.
+// Threads flush their buffers when full, so the file is not in call order across threads:
+// readers sort the records by sequence.
+
+static const std::uint32_t DT_TRACE_MAGIC = 0x52544444; // "DDTR"
+static const std::uint32_t DT_TRACE_VERSION = 2;
+
+enum dtTraceCall : std::uint8_t
+{
+	DT_TRACE_MESH = 0,              // mesh id -> .nav file, written before the first record of the mesh
+	DT_TRACE_PATH_STRAIGHT,
+	DT_TRACE_PATH_STRAIGHT_EX,
+	DT_TRACE_FIND_RANDOM_POINT,
+	DT_TRACE_FIND_CLOSEST_POINT,
+	DT_TRACE_GET_POLY_AT,
+	DT_TRACE_SET_POLY_FLAGS,
+	DT_TRACE_QUERY_POLYGONS,
+	DT_TRACE_IS_REACHABLE,
+	DT_TRACE_BUILD_LANDMARKS,
+	DT_TRACE_CALL_COUNT
+};
+
+#pragma pack(push, 1)
+struct dtTraceFileHeader
+{
+	std::uint32_t magic;
+	std::uint32_t version;
+	std::uint32_t polyRefSize; // sizeof(dtPolyRef) of the recording library
+};
+
+struct dtTraceRecordHeader
+{
+	std::uint8_t call;         // dtTraceCall
+	std::uint8_t thread;       // recording thread, modulo 256
+	std::uint16_t mesh;        // mesh id, see DT_TRACE_MESH
+	std::uint32_t size;        // payload bytes
+	std::uint32_t status;      // returned dtStatus, or bool
+	std::uint32_t latency;     // nanoseconds
+	std::uint64_t sequence;    // order of the calls across threads, taken when the call returns
+};
+#pragma pack(pop)
+
+// true while StartTrace is active, checked by every traced export
+extern std::atomic<bool> traceEnabled;
+
+inline bool dtTraceEnabled()
+{
+	return traceEnabled.load(std::memory_order_relaxed);
+}
+
+// id of the mesh in the trace, writes its DT_TRACE_MESH record on first use
+std::uint16_t dtTraceMeshId(dtNavMesh const *mesh);
+
+// One record, built on the stack and appended to the thread buffer by commit()
+class dtTraceRecord
+{
+public:
+	dtTraceRecord(dtTraceCall call, dtNavMesh const *mesh, std::chrono::steady_clock::time_point begin)
+		: m_size(0), m_overflow(false)
+	{
+		m_header.call = call;
+		m_header.thread = 0;
+		m_header.mesh = dtTraceMeshId(mesh);
+		m_header.size = 0;
+		m_header.status = 0;
+		m_header.latency = (std::uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+		m_header.sequence = 0;
+	}
+
+	template <typename T>
+	void put(T const *values, int count)
+	{
+		auto size = sizeof(T) * (count > 0 ? count : 0);
+		if (m_size + size > sizeof(m_payload))
+		{
+			m_overflow = true;
+			return;
+		}
+		std::memcpy(&m_payload[m_size], values, size);
+		m_size += size;
+	}
+
+	template <typename T>
+	void put(T const &value)
+	{
+		put(&value, 1);
+	}
+
+	// appends the record to the trace, records larger than the payload buffer are dropped
+	void commit(std::uint32_t status);
+
+private:
+	dtTraceRecordHeader m_header;
+	unsigned char m_payload[8192];
+	std::size_t m_size;
+	bool m_overflow;
+};
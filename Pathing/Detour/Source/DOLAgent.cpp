@@ -0,0 +1,347 @@
+#include <algorithm>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+#include "dol_internal.hpp"
+#include "dol_navmesh.hpp"
+
+// max polys crossed by a single agent update before falling back to findNearestPoly
+static const int MAX_AGENT_VISITED = 16;
+// entities following straight paths graze the mesh border, a move ending this close
+// (4 game units) to the requested position is still considered on the surface
+static const float AGENT_SURFACE_TOLERANCE = 4.0f / 32.0f;
+
+// Persistent handle for one moving entity (NPC or player). It remembers the poly the entity
+// stands on, so queries issued through the handle skip the nearest-poly search and updates
+// only walk the few polys crossed since the last tick.
+// A handle belongs to the navmesh or instance of the query that created it and must not be used
+// by two threads at the same time.
+struct dtNavAgent
+{
+	dtQueryFilter filter;
+	float polyPickExt[3];
+	dtPolyRef ref;
+	float pos[3];
+	// of the navmesh, or of the instance for agents created with an instance query
+	dtAgentTracker *tracker;
+	// last path, repaired by AgentRepairPath
+	std::vector<dtPolyRef> corridor;
+	dtPolyRef endRef = 0;
+	float end[3];
+	// guarded by the tracker of the mesh
+	std::vector<dtPolyRef> gates;
+	bool blocked = false;
+};
+
+static bool PassFilter(dtQueryFilter const &filter, unsigned short flags)
+{
+	return (flags & filter.getIncludeFlags()) != 0 && (flags & filter.getExcludeFlags()) == 0;
+}
+
+void dtAgentTracker::track(dtNavAgent *agent, std::vector<dtPolyRef> const &gates)
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	untrackLocked(agent);
+	agent->gates = gates;
+	for (auto ref : gates)
+		m_gateAgents[ref].push_back(agent);
+}
+
+void dtAgentTracker::remove(dtNavAgent *agent)
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	untrackLocked(agent);
+}
+
+void dtAgentTracker::untrackLocked(dtNavAgent *agent)
+{
+	for (auto ref : agent->gates)
+	{
+		auto it = m_gateAgents.find(ref);
+		if (it == m_gateAgents.end())
+			continue;
+		auto &agents = it->second;
+		auto position = std::find(agents.begin(), agents.end(), agent);
+		if (position != agents.end())
+		{
+			*position = agents.back();
+			agents.pop_back();
+		}
+		if (agents.empty())
+			m_gateAgents.erase(it);
+	}
+	agent->gates.clear();
+	// a new path no longer crosses the closed gate
+	if (agent->blocked)
+	{
+		m_blocked.erase(std::find(m_blocked.begin(), m_blocked.end(), agent));
+		agent->blocked = false;
+	}
+}
+
+void dtAgentTracker::polyFlagsChanged(dtPolyRef ref, unsigned short flags)
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	auto it = m_gateAgents.find(ref);
+	if (it == m_gateAgents.end())
+		return;
+	for (auto agent : it->second)
+	{
+		if (agent->blocked || PassFilter(agent->filter, flags))
+			continue;
+		agent->blocked = true;
+		m_blocked.push_back(agent);
+	}
+}
+
+int dtAgentTracker::popBlocked(dtNavAgent **agents, int maxAgents)
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	int count = std::min(maxAgents, (int)m_blocked.size());
+	for (int i = 0; i < count; ++i)
+	{
+		agents[i] = m_blocked[i];
+		agents[i]->blocked = false;
+	}
+	m_blocked.erase(m_blocked.begin(), m_blocked.begin() + count);
+	return count;
+}
+
+// remembers the corridor of the last path and tracks the gates it crosses
+static void RecordPath(dtNavMeshQuery *query, dtNavAgent *agent, dtPolyRef const *corridor, int corridorCount, dtPolyRef endRef, float const *end)
+{
+	agent->corridor.assign(corridor, corridor + corridorCount);
+	agent->endRef = endRef;
+	dtVcopy(agent->end, end);
+	if (!agent->tracker)
+		return;
+	std::vector<dtPolyRef> gates;
+	for (int i = 0; i < corridorCount; ++i)
+	{
+		unsigned short flags = 0;
+		query->getPolyFlags(corridor[i], &flags);
+		if (flags & GATE_FLAGS)
+			gates.push_back(corridor[i]);
+	}
+	agent->tracker->track(agent, gates);
+}
+
+static dtStatus LocateAgent(dtNavMeshQuery *query, dtNavAgent *agent, float const *position)
+{
+	dtPolyRef ref;
+	float nearest[3];
+	auto status = query->findNearestPoly(position, agent->polyPickExt, &agent->filter, &ref, nearest);
+	if (dtStatusFailed(status))
+		return status;
+	if (!ref)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	agent->ref = ref;
+	dtVcopy(agent->pos, nearest);
+	return status;
+}
+
+DLLEXPORT dtStatus CreateAgent(dtNavMeshQuery *query, float position[], float polyPickExt[], dtPolyFlags queryFilter[], dtNavAgent **agent)
+{
+	*agent = nullptr;
+	auto result = new (std::nothrow) dtNavAgent();
+	if (!result)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	result->filter.setIncludeFlags(queryFilter[0]);
+	result->filter.setExcludeFlags(queryFilter[1]);
+	dtVcopy(result->polyPickExt, polyPickExt);
+	auto instance = GetQueryInstance(query);
+	auto info = instance ? nullptr : GetQueryInfo(query);
+	result->tracker = instance ? &instance->agents : info ? &info->agents : nullptr;
+
+	auto status = LocateAgent(query, result, position);
+	if (dtStatusFailed(status))
+	{
+		delete result;
+		return status;
+	}
+	*agent = result;
+	return status;
+}
+
+// Moves the agent to its new position. Short moves on the mesh are followed with moveAlongSurface
+// from the cached poly; teleports, jumps and invalidated polys (door closed, tile reloaded)
+// fall back to findNearestPoly. outputVector [opt] receives the position snapped on the mesh.
+DLLEXPORT dtStatus UpdateAgent(dtNavMeshQuery *query, dtNavAgent *agent, float position[], float *outputVector)
+{
+	dtStatus status = DT_FAILURE;
+	if (query->isValidPolyRef(agent->ref, &agent->filter))
+	{
+		int visitedCount = 0;
+		dtPolyRef visited[MAX_AGENT_VISITED];
+		float result[3];
+		status = query->moveAlongSurface(agent->ref, agent->pos, position, &agent->filter, result, visited, &visitedCount, MAX_AGENT_VISITED);
+		// the move is accepted only if it reached the requested position, otherwise the
+		// entity went somewhere the surface does not lead to (it jumped, fell or teleported)
+		if (dtStatusSucceed(status) && visitedCount > 0 && dtVdist2DSqr(result, position) <= dtSqr(AGENT_SURFACE_TOLERANCE))
+		{
+			// the result may sit on the poly border, where getPolyHeight fails
+			auto ref = visited[visitedCount - 1];
+			float closest[3];
+			if (dtStatusSucceed(query->closestPointOnPoly(ref, result, closest, nullptr)) && dtMathFabsf(closest[1] - position[1]) <= agent->polyPickExt[1])
+			{
+				agent->ref = ref;
+				dtVcopy(agent->pos, closest);
+			}
+			else
+				status = DT_FAILURE;
+		}
+		else
+			status = DT_FAILURE;
+	}
+	if (dtStatusFailed(status))
+		status = LocateAgent(query, agent, position);
+	if (dtStatusSucceed(status) && outputVector)
+		dtVcopy(outputVector, agent->pos);
+	return status;
+}
+
+DLLEXPORT dtStatus GetAgentPosition(dtNavAgent *agent, dtPolyRef *polyRef, float *outputVector)
+{
+	if (polyRef)
+		*polyRef = agent->ref;
+	if (outputVector)
+		dtVcopy(outputVector, agent->pos);
+	return DT_SUCCESS;
+}
+
+DLLEXPORT dtStatus AgentPathStraight(dtNavMeshQuery *query, dtNavAgent *agent, float end[], dtStraightPathOptions pathOptions, int *pointCount, float *pointBuffer, dtPolyFlags *pointFlags)
+{
+	*pointCount = 0;
+	dtPolyRef endRef;
+	auto status = query->findNearestPoly(end, agent->polyPickExt, &agent->filter, &endRef, nullptr);
+	if (dtStatusSucceed(status))
+	{
+		dtPolyRef corridor[MAX_POLY];
+		int corridorCount;
+		status = PathStraightFromPolys(query, agent->ref, endRef, agent->pos, end, &agent->filter, pathOptions, DT_PATH_DEFAULT, pointCount, pointBuffer, pointFlags, corridor, &corridorCount);
+		RecordPath(query, agent, corridor, corridorCount, endRef, end);
+	}
+	return status;
+}
+
+// chase: both ends are already known, no nearest-poly search at all
+DLLEXPORT dtStatus AgentPathToAgent(dtNavMeshQuery *query, dtNavAgent *agent, dtNavAgent *target, dtStraightPathOptions pathOptions, int *pointCount, float *pointBuffer, dtPolyFlags *pointFlags)
+{
+	dtPolyRef corridor[MAX_POLY];
+	int corridorCount;
+	auto status = PathStraightFromPolys(query, agent->ref, target->ref, agent->pos, target->pos, &agent->filter, pathOptions, DT_PATH_DEFAULT, pointCount, pointBuffer, pointFlags, corridor, &corridorCount);
+	RecordPath(query, agent, corridor, corridorCount, target->ref, target->pos);
+	return status;
+}
+
+DLLEXPORT int GetBlockedAgents(dtNavMesh *navMesh, dtNavAgent **agents, int maxAgents)
+{
+	auto info = GetNavMeshInfo(navMesh);
+	return info ? info->agents.popBlocked(agents, maxAgents) : 0;
+}
+
+// appends the polys to the corridor, cutting the loops where a poly is entered twice
+static void AppendCorridor(std::vector<dtPolyRef> &corridor, std::unordered_map<dtPolyRef, int> &positions, dtPolyRef const *polys, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		auto it = positions.find(polys[i]);
+		if (it != positions.end())
+		{
+			for (int j = it->second + 1; j < (int)corridor.size(); ++j)
+				positions.erase(corridor[j]);
+			corridor.resize(it->second + 1);
+			continue;
+		}
+		positions.emplace(polys[i], (int)corridor.size());
+		corridor.push_back(polys[i]);
+	}
+}
+
+// Keeps the corridor of the last path from the agent poly, and replaces the polys its filter no
+// longer passes with a local A* from the poly before them to the first passable poly after them.
+// Falls back to a full path when the agent left its corridor or no local detour is found.
+DLLEXPORT dtStatus AgentRepairPath(dtNavMeshQuery *query, dtNavAgent *agent, dtStraightPathOptions pathOptions, int *pointCount, float *pointBuffer, dtPolyFlags *pointFlags)
+{
+	*pointCount = 0;
+	auto const &corridor = agent->corridor;
+	if (corridor.empty())
+		return DT_FAILURE | DT_INVALID_PARAM;
+	int count = (int)corridor.size();
+	float end[3];
+	dtVcopy(end, agent->end);
+	auto replan = [&]()
+	{
+		dtPolyRef polys[MAX_POLY];
+		int npolys;
+		auto status = PathStraightFromPolys(query, agent->ref, agent->endRef, agent->pos, end, &agent->filter, pathOptions, DT_PATH_DEFAULT, pointCount, pointBuffer, pointFlags, polys, &npolys);
+		RecordPath(query, agent, polys, npolys, agent->endRef, end);
+		return status;
+	};
+
+	int first = (int)(std::find(corridor.begin(), corridor.end(), agent->ref) - corridor.begin());
+	if (first == count)
+		return replan();
+	int blocked = first;
+	while (blocked < count && query->isValidPolyRef(corridor[blocked], &agent->filter))
+		++blocked;
+	int rejoin = blocked;
+	while (rejoin < count && !query->isValidPolyRef(corridor[rejoin], &agent->filter))
+		++rejoin;
+	if (blocked == first || (blocked < count && rejoin == count))
+		return replan();
+
+	std::vector<dtPolyRef> repaired;
+	std::unordered_map<dtPolyRef, int> positions;
+	if (blocked == count)
+		AppendCorridor(repaired, positions, &corridor[first], count - first);
+	else
+	{
+		// detour from where the corridor enters the last passable poly to where it leaves the rejoined one
+		auto from = corridor[blocked - 1];
+		auto to = corridor[rejoin];
+		float fromPos[3], toPos[3];
+		if (blocked - 1 == first)
+			dtVcopy(fromPos, agent->pos);
+		else
+			query->getEdgeMidPoint(corridor[blocked - 2], from, fromPos);
+		if (rejoin + 1 < count)
+			query->getEdgeMidPoint(to, corridor[rejoin + 1], toPos);
+		else
+			dtVcopy(toPos, end);
+		auto islands = GetQueryIslands(query);
+		if (islands && !islands->isReachable(from, to, &agent->filter))
+			return replan();
+		dtPolyRef detour[MAX_POLY];
+		int detourCount = 0;
+		auto status = query->findPath(from, to, fromPos, toPos, &agent->filter, detour, &detourCount, MAX_POLY);
+		if (dtStatusFailed(status) || detourCount == 0 || detour[detourCount - 1] != to)
+			return replan();
+		AppendCorridor(repaired, positions, &corridor[first], blocked - 1 - first);
+		AppendCorridor(repaired, positions, detour, detourCount);
+		AppendCorridor(repaired, positions, corridor.data() + rejoin + 1, count - rejoin - 1);
+		// another closed gate further on
+		if ((int)repaired.size() > MAX_POLY || std::any_of(repaired.begin(), repaired.end(), [&](dtPolyRef ref)
+															   { return !query->isValidPolyRef(ref, &agent->filter); }))
+			return replan();
+	}
+
+	auto status = StraightPathFromCorridor(query, repaired.data(), (int)repaired.size(), agent->endRef, agent->pos, end, &agent->filter, pathOptions, DT_PATH_DEFAULT, pointCount, pointBuffer, pointFlags);
+	RecordPath(query, agent, repaired.data(), (int)repaired.size(), agent->endRef, end);
+	return status;
+}
+
+DLLEXPORT dtStatus AgentFindRandomPointAroundCircle(dtNavMeshQuery *query, dtNavAgent *agent, float radius, float *outputVector)
+{
+	dtPolyRef outRef;
+	return query->findRandomPointAroundCircle(agent->ref, agent->pos, radius, &agent->filter, frand, &outRef, outputVector);
+}
+
+DLLEXPORT bool FreeAgent(dtNavAgent *agent)
+{
+	if (agent && agent->tracker)
+		agent->tracker->remove(agent);
+	delete agent;
+	return true;
+}
@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "dol_detour.hpp"
+
+// Batched spatial queries: one call answers N centers so the AI can sample
+// its surroundings without paying one P/Invoke and one filter setup per point.
+// Every center gets its own status, the returned status only reports invalid input.
+
+DLLEXPORT dtStatus FindDistanceToWallBatch(dtNavMeshQuery *query, int count, float centers[], float maxRadius, float polyPickExt[], dtPolyFlags queryFilter[], float *hitDists, float *hitPositions, float *hitNormals, dtStatus *statuses)
+{
+	if (count < 0 || !centers || !hitDists || !statuses)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	dtQueryFilter filter;
+	filter.setIncludeFlags(queryFilter[0]);
+	filter.setExcludeFlags(queryFilter[1]);
+	for (int i = 0; i < count; ++i)
+	{
+		float const *center = &centers[i * 3];
+		float hitPos[3];
+		float hitNormal[3];
+		dtPolyRef ref;
+		auto status = query->findNearestPoly(center, polyPickExt, &filter, &ref, nullptr);
+		if (dtStatusSucceed(status) && !ref)
+			status = DT_FAILURE | DT_INVALID_PARAM;
+		if (dtStatusSucceed(status))
+			status = query->findDistanceToWall(ref, center, maxRadius, &filter, &hitDists[i], hitPos, hitNormal);
+		if (hitPositions && dtStatusSucceed(status))
+			dtVcopy(&hitPositions[i * 3], hitPos);
+		if (hitNormals && dtStatusSucceed(status))
+			dtVcopy(&hitNormals[i * 3], hitNormal);
+		statuses[i] = status;
+	}
+	return DT_SUCCESS;
+}
+
+DLLEXPORT dtStatus FindLocalNeighbourhoodBatch(dtNavMeshQuery *query, int count, float centers[], float radius, float polyPickExt[], dtPolyFlags queryFilter[], int maxPolys, dtPolyRef *polys, int *polyCounts, dtStatus *statuses)
+{
+	if (count < 0 || !centers || maxPolys <= 0 || !polys || !polyCounts || !statuses)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	dtQueryFilter filter;
+	filter.setIncludeFlags(queryFilter[0]);
+	filter.setExcludeFlags(queryFilter[1]);
+	for (int i = 0; i < count; ++i)
+	{
+		float const *center = &centers[i * 3];
+		polyCounts[i] = 0;
+		dtPolyRef ref;
+		auto status = query->findNearestPoly(center, polyPickExt, &filter, &ref, nullptr);
+		if (dtStatusSucceed(status) && !ref)
+			status = DT_FAILURE | DT_INVALID_PARAM;
+		if (dtStatusSucceed(status))
+			status = query->findLocalNeighbourhood(ref, center, radius, &filter, &polys[i * maxPolys], nullptr, &polyCounts[i], maxPolys);
+		statuses[i] = status;
+	}
+	return DT_SUCCESS;
+}
+
+DLLEXPORT dtStatus FindPolysAroundCircleBatch(dtNavMeshQuery *query, int count, float centers[], float radius, float polyPickExt[], dtPolyFlags queryFilter[], int maxPolys, dtPolyRef *polys, float *costs, int *polyCounts, dtStatus *statuses)
+{
+	if (count < 0 || !centers || maxPolys <= 0 || !polys || !polyCounts || !statuses)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	dtQueryFilter filter;
+	filter.setIncludeFlags(queryFilter[0]);
+	filter.setExcludeFlags(queryFilter[1]);
+	for (int i = 0; i < count; ++i)
+	{
+		float const *center = &centers[i * 3];
+		polyCounts[i] = 0;
+		dtPolyRef ref;
+		auto status = query->findNearestPoly(center, polyPickExt, &filter, &ref, nullptr);
+		if (dtStatusSucceed(status) && !ref)
+			status = DT_FAILURE | DT_INVALID_PARAM;
+		if (dtStatusSucceed(status))
+			status = query->findPolysAroundCircle(ref, center, radius, &filter, &polys[i * maxPolys], nullptr, costs ? &costs[i * maxPolys] : nullptr, &polyCounts[i], maxPolys);
+		statuses[i] = status;
+	}
+	return DT_SUCCESS;
+}
+
+// Movement validation: moves every entity from its last position toward the requested one,
+// constrained to the navmesh. polyRefs holds the last known poly of each entity (0 if unknown)
+// and is updated with the poly the entity ends in. clamped is set when the entity could not
+// reach its requested position (wall, unreachable poly or a move too long for one tick).
+DLLEXPORT dtStatus MoveAlongSurfaceBatch(dtNavMeshQuery *query, int count, dtPolyRef *polyRefs, float from[], float to[], float polyPickExt[], dtPolyFlags queryFilter[], float *resultPositions, unsigned char *clamped, dtStatus *statuses)
+{
+	if (count < 0 || !polyRefs || !from || !to || !resultPositions || !clamped || !statuses)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	static const int MAX_VISITED = 16;
+	dtQueryFilter filter;
+	filter.setIncludeFlags(queryFilter[0]);
+	filter.setExcludeFlags(queryFilter[1]);
+	for (int i = 0; i < count; ++i)
+	{
+		float const *start = &from[i * 3];
+		float const *end = &to[i * 3];
+		float *result = &resultPositions[i * 3];
+		dtVcopy(result, start);
+		clamped[i] = 1;
+
+		dtStatus status = DT_SUCCESS;
+		auto ref = polyRefs[i];
+		if (!query->isValidPolyRef(ref, &filter))
+		{
+			status = query->findNearestPoly(start, polyPickExt, &filter, &ref, nullptr);
+			if (dtStatusSucceed(status) && !ref)
+				status = DT_FAILURE | DT_INVALID_PARAM;
+		}
+
+		int visitedCount = 0;
+		dtPolyRef visited[MAX_VISITED];
+		if (dtStatusSucceed(status))
+			status = query->moveAlongSurface(ref, start, end, &filter, result, visited, &visitedCount, MAX_VISITED);
+		if (dtStatusSucceed(status) && visitedCount > 0)
+		{
+			ref = visited[visitedCount - 1];
+			clamped[i] = dtVdist2DSqr(result, end) > 1e-4f ? 1 : 0;
+			// a clamped move ends on the poly border, where getPolyHeight fails:
+			// closestPointOnPoly falls back to the detail edges there
+			float closest[3];
+			if (dtStatusSucceed(query->closestPointOnPoly(ref, result, closest, nullptr)))
+				dtVcopy(result, closest);
+		}
+		polyRefs[i] = dtStatusSucceed(status) ? ref : 0;
+		statuses[i] = status;
+	}
+	return DT_SUCCESS;
+}
+
+// below this size a batch is not worth the thread start up
+static const int SNAP_BATCH_PER_THREAD = 2048;
+
+static void SnapToGround(dtNavMeshQuery const *query, int begin, int end, float const *positions, float const *extents, dtQueryFilter const *filter, float *heights, dtPolyRef *polyRefs, unsigned char *onMesh, dtStatus *statuses)
+{
+	for (int i = begin; i < end; ++i)
+	{
+		float const *position = &positions[i * 3];
+		float center[3];
+		dtGameToDetour(position, center);
+		heights[i] = position[2];
+		polyRefs[i] = 0;
+		onMesh[i] = 0;
+
+		dtPolyRef ref;
+		float nearest[3];
+		bool isOverPoly = false;
+		auto status = query->findNearestPoly(center, extents, filter, &ref, nearest, &isOverPoly);
+		if (dtStatusSucceed(status) && !ref)
+			status = DT_FAILURE | DT_INVALID_PARAM;
+		if (dtStatusSucceed(status))
+		{
+			float height;
+			if (!isOverPoly || dtStatusFailed(query->getPolyHeight(ref, nearest, &height)))
+				height = nearest[1];
+			heights[i] = height * DETOUR_TO_GAME;
+			polyRefs[i] = ref;
+			onMesh[i] = isOverPoly ? 1 : 0;
+		}
+		statuses[i] = status;
+	}
+}
+
+// Ground height for N positions given in game units (x, y, z), for NPC Z correction and
+// spawn point validation. The returned heights are game Z, onMesh is set when the point
+// lies over the returned poly. Large batches are split over all cores: findNearestPoly and
+// getPolyHeight do not touch the query node pools, so the workers can share the query.
+DLLEXPORT dtStatus SnapToGroundBatch(dtNavMeshQuery *query, int count, float positions[], float extents[], dtPolyFlags queryFilter[], float *heights, dtPolyRef *polyRefs, unsigned char *onMesh, dtStatus *statuses)
+{
+	if (count < 0 || !positions || !extents || !heights || !polyRefs || !onMesh || !statuses)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	dtQueryFilter filter;
+	filter.setIncludeFlags(queryFilter[0]);
+	filter.setExcludeFlags(queryFilter[1]);
+	float halfExtents[3];
+	dtGameExtentsToDetour(extents, halfExtents);
+
+	int threadCount = std::min<int>(std::max(1u, std::thread::hardware_concurrency()), count / SNAP_BATCH_PER_THREAD);
+	if (threadCount <= 1)
+	{
+		SnapToGround(query, 0, count, positions, halfExtents, &filter, heights, polyRefs, onMesh, statuses);
+		return DT_SUCCESS;
+	}
+
+	std::vector<std::thread> workers;
+	workers.reserve(threadCount - 1);
+	int chunk = (count + threadCount - 1) / threadCount;
+	for (int begin = chunk; begin < count; begin += chunk)
+		workers.emplace_back(SnapToGround, query, begin, std::min(begin + chunk, count), positions, halfExtents, &filter, heights, polyRefs, onMesh, statuses);
+	SnapToGround(query, 0, chunk, positions, halfExtents, &filter, heights, polyRefs, onMesh, statuses);
+	for (auto &worker : workers)
+		worker.join();
+	return DT_SUCCESS;
+}
@@ -0,0 +1,94 @@
+#include <chrono>
+
+#include "dol_internal.hpp"
+
+// the clock is read once per this many expansions, a node costs well below a microsecond
+static const unsigned int BUDGET_CLOCK_INTERVAL = 8;
+
+// dtQueryBudget limits as seen by the search, attached to the query for the duration of one call
+class dtCallBudget : public dtSearchBudget
+{
+public:
+	dtCallBudget(dtNavMeshQuery *query, dtQueryBudget *budget)
+		: m_query(query), m_budget(budget), m_begin(std::chrono::steady_clock::now()), m_exhausted(false)
+	{
+		m_budget->nodes = 0;
+		m_budget->microseconds = 0;
+		m_deadline = m_begin + std::chrono::microseconds(budget->maxMicroseconds);
+		m_query->setSearchBudget(this);
+	}
+
+	~dtCallBudget()
+	{
+		m_query->setSearchBudget(nullptr);
+		m_budget->microseconds = (unsigned int)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_begin).count();
+	}
+
+	bool spend() override
+	{
+		if (m_budget->maxNodes && m_budget->nodes >= m_budget->maxNodes)
+			return stop();
+		if (m_budget->maxMicroseconds && m_budget->nodes % BUDGET_CLOCK_INTERVAL == 0 && std::chrono::steady_clock::now() >= m_deadline)
+			return stop();
+		++m_budget->nodes;
+		return true;
+	}
+
+	// adds the budget details to the status of a query the budget stopped
+	dtStatus finish(dtStatus status) const
+	{
+		if (m_exhausted && dtStatusSucceed(status))
+			status |= DT_PARTIAL_RESULT | DT_BUDGET_EXHAUSTED;
+		return status;
+	}
+
+private:
+	bool stop()
+	{
+		m_exhausted = true;
+		return false;
+	}
+
+	dtNavMeshQuery *m_query;
+	dtQueryBudget *m_budget;
+	std::chrono::steady_clock::time_point m_begin;
+	std::chrono::steady_clock::time_point m_deadline;
+	bool m_exhausted;
+};
+
+DLLEXPORT dtStatus PathStraightBudget(dtNavMeshQuery *query, float start[], float end[], float polyPickExt[], dtPolyFlags queryFilter[], dtStraightPathOptions pathOptions, dtPathOptions options, dtQueryBudget *budget, int *pointCount, float *pointBuffer, dtPolyFlags *pointFlags)
+{
+	*pointCount = 0;
+	if (!budget)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	dtCallBudget callBudget(query, budget);
+
+	dtStatus status;
+	dtPolyRef startRef;
+	dtPolyRef endRef;
+	dtQueryFilter filter;
+	filter.setIncludeFlags(queryFilter[0]);
+	filter.setExcludeFlags(queryFilter[1]);
+	if (dtStatusSucceed(status = query->findNearestPoly(start, polyPickExt, &filter, &startRef, nullptr)) && dtStatusSucceed(status = query->findNearestPoly(end, polyPickExt, &filter, &endRef, nullptr)))
+		status = PathStraightFromPolys(query, startRef, endRef, start, end, &filter, pathOptions, options, pointCount, pointBuffer, pointFlags);
+	return callBudget.finish(status);
+}
+
+DLLEXPORT dtStatus FindRandomPointAroundCircleBudget(dtNavMeshQuery *query, float center[], float radius, float polyPickExt[], dtPolyFlags queryFilter[], dtQueryBudget *budget, float *outputVector)
+{
+	if (!budget)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	dtCallBudget callBudget(query, budget);
+
+	dtQueryFilter filter;
+	filter.setIncludeFlags(queryFilter[0]);
+	filter.setExcludeFlags(queryFilter[1]);
+	dtPolyRef centerRef;
+	auto status = query->findNearestPoly(center, polyPickExt, &filter, &centerRef, nullptr);
+	if (dtStatusSucceed(status))
+	{
+		dtPolyRef outRef;
+		status = query->findRandomPointAroundCircle(centerRef, center, radius, &filter, frand, &outRef, outputVector);
+	}
+	return callBudget.finish(status);
+}
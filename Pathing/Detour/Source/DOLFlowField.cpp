@@ -0,0 +1,212 @@
+#include <cfloat>
+#include <mutex>
+#include <new>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "DetourNode.h"
+#include "dol_detour.hpp"
+
+// max polys in the corridor between the field root and the moving target
+static const int MAX_TAIL = 32;
+
+// Flow field towards a single target, shared by every agent converging on it.
+// The field is one reverse Dijkstra search from the target poly: each poly of the
+// bounded area knows its next hop toward the root and the remaining cost.
+// When the target moves inside the field we only plan a short corridor (the "tail")
+// from the root to the new target instead of flooding the whole area again.
+struct dtFlowField
+{
+	struct Cell
+	{
+		dtPolyRef next;		// next poly toward the root (0 for the root itself)
+		float waypoint[3];	// mid point of the portal between this poly and next
+		float cost;			// cost from waypoint to the root
+	};
+
+	dtQueryFilter filter;
+	float radius;
+	float rebuildCost;
+
+	dtPolyRef rootRef;
+	float rootPos[3];
+	std::unordered_map<dtPolyRef, Cell> cells;
+
+	dtPolyRef targetRef;
+	float targetPos[3];
+	int tailCount;
+	dtPolyRef tail[MAX_TAIL];			// tail[0] is the root, tail[tailCount - 1] the target poly
+	float tailWaypoints[MAX_TAIL * 3];	// portal between tail[i] and tail[i + 1]
+	float tailCosts[MAX_TAIL];			// cost from tailWaypoints[i] to the target
+	float tailCost;						// cost from the root to the target
+
+	std::shared_mutex lock;
+};
+
+static dtStatus BuildFlowField(dtNavMeshQuery *query, dtFlowField *field, dtPolyRef targetRef, float const *target)
+{
+	auto maxNodes = query->getNodePool()->getMaxNodes();
+	thread_local std::vector<dtPolyRef> refs;
+	thread_local std::vector<dtPolyRef> parents;
+	thread_local std::vector<float> costs;
+	refs.resize(maxNodes);
+	parents.resize(maxNodes);
+	costs.resize(maxNodes);
+
+	int count = 0;
+	auto status = query->findPolysAroundCircle(targetRef, target, field->radius, &field->filter, refs.data(), parents.data(), costs.data(), &count, maxNodes);
+	if (dtStatusFailed(status))
+		return status;
+
+	field->cells.clear();
+	field->cells.reserve(count);
+	for (int i = 0; i < count; ++i)
+	{
+		dtFlowField::Cell cell;
+		cell.next = parents[i];
+		cell.cost = costs[i];
+		// the node position is the portal of the first visit, the parent can change afterwards
+		if (!parents[i] || dtStatusFailed(query->getEdgeMidPoint(refs[i], parents[i], cell.waypoint)))
+			dtVcopy(cell.waypoint, target);
+		field->cells[refs[i]] = cell;
+	}
+
+	field->rootRef = targetRef;
+	dtVcopy(field->rootPos, target);
+	field->targetRef = targetRef;
+	dtVcopy(field->targetPos, target);
+	field->tail[0] = targetRef;
+	field->tailCount = 1;
+	field->tailCost = 0;
+	return status;
+}
+
+// plans the corridor from the root to the new target, false if the field must be rebuilt
+static bool UpdateFlowFieldTail(dtNavMeshQuery *query, dtFlowField *field, dtPolyRef targetRef, float const *target)
+{
+	int count = 0;
+	dtPolyRef path[MAX_TAIL];
+	auto status = query->findPath(field->rootRef, targetRef, field->rootPos, target, &field->filter, path, &count, MAX_TAIL);
+	if (dtStatusFailed(status) || dtStatusDetail(status, DT_PARTIAL_RESULT | DT_BUFFER_TOO_SMALL) || count == 0 || path[count - 1] != targetRef)
+		return false;
+
+	float waypoints[MAX_TAIL * 3];
+	for (int i = 0; i < count - 1; ++i)
+		if (dtStatusFailed(query->getEdgeMidPoint(path[i], path[i + 1], &waypoints[i * 3])))
+			return false;
+
+	// costs are accumulated backward from the target
+	float costs[MAX_TAIL];
+	float const *next = target;
+	float cost = 0;
+	for (int i = count - 2; i >= 0; --i)
+	{
+		cost += dtVdist(&waypoints[i * 3], next);
+		costs[i] = cost;
+		next = &waypoints[i * 3];
+	}
+	cost += dtVdist(field->rootPos, next);
+	if (cost > field->rebuildCost)
+		return false;
+
+	std::copy(path, path + count, field->tail);
+	std::copy(waypoints, waypoints + (count - 1) * 3, field->tailWaypoints);
+	std::copy(costs, costs + count - 1, field->tailCosts);
+	field->tailCount = count;
+	field->tailCost = cost;
+	field->targetRef = targetRef;
+	dtVcopy(field->targetPos, target);
+	return true;
+}
+
+DLLEXPORT dtStatus CreateFlowField(dtNavMeshQuery *query, float target[], float radius, float polyPickExt[], dtPolyFlags queryFilter[], dtFlowField **field)
+{
+	*field = nullptr;
+	auto result = new (std::nothrow) dtFlowField();
+	if (!result)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	result->filter.setIncludeFlags(queryFilter[0]);
+	result->filter.setExcludeFlags(queryFilter[1]);
+	result->radius = radius;
+	result->rebuildCost = radius * 0.25f;
+
+	dtPolyRef targetRef;
+	auto status = query->findNearestPoly(target, polyPickExt, &result->filter, &targetRef, nullptr);
+	if (dtStatusSucceed(status) && !targetRef)
+		status = DT_FAILURE | DT_INVALID_PARAM;
+	if (dtStatusSucceed(status))
+		status = BuildFlowField(query, result, targetRef, target);
+	if (dtStatusFailed(status))
+	{
+		delete result;
+		return status;
+	}
+	*field = result;
+	return status;
+}
+
+DLLEXPORT dtStatus UpdateFlowField(dtNavMeshQuery *query, dtFlowField *field, float target[], float polyPickExt[])
+{
+	dtPolyRef targetRef;
+	auto status = query->findNearestPoly(target, polyPickExt, &field->filter, &targetRef, nullptr);
+	if (dtStatusFailed(status))
+		return status;
+	if (!targetRef)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	std::unique_lock<std::shared_mutex> lock(field->lock);
+	if (targetRef == field->rootRef)
+	{
+		field->tail[0] = targetRef;
+		field->tailCount = 1;
+		field->tailCost = dtVdist(field->rootPos, target);
+		field->targetRef = targetRef;
+		dtVcopy(field->targetPos, target);
+		return DT_SUCCESS;
+	}
+	if (field->cells.count(targetRef) && UpdateFlowFieldTail(query, field, targetRef, target))
+		return DT_SUCCESS;
+	return BuildFlowField(query, field, targetRef, target);
+}
+
+DLLEXPORT dtStatus FlowFieldNextWaypoint(dtNavMeshQuery *query, dtFlowField *field, float position[], float polyPickExt[], float *outputVector, float *outputCost)
+{
+	dtPolyRef ref;
+	auto status = query->findNearestPoly(position, polyPickExt, &field->filter, &ref, nullptr);
+	if (dtStatusFailed(status))
+		return status;
+	if (!ref)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	std::shared_lock<std::shared_mutex> lock(field->lock);
+	for (int i = 0; i < field->tailCount; ++i)
+	{
+		if (field->tail[i] != ref)
+			continue;
+		if (i == field->tailCount - 1)
+		{
+			dtVcopy(outputVector, field->targetPos);
+			*outputCost = dtVdist(position, field->targetPos);
+		}
+		else
+		{
+			dtVcopy(outputVector, &field->tailWaypoints[i * 3]);
+			*outputCost = dtVdist(position, outputVector) + field->tailCosts[i];
+		}
+		return DT_SUCCESS;
+	}
+
+	auto cell = field->cells.find(ref);
+	if (cell == field->cells.end())
+		return DT_FAILURE; // outside of the field, the caller has to fall back to PathStraight
+	dtVcopy(outputVector, cell->second.waypoint);
+	*outputCost = dtVdist(position, outputVector) + cell->second.cost + field->tailCost;
+	return DT_SUCCESS;
+}
+
+DLLEXPORT bool FreeFlowField(dtFlowField *field)
+{
+	delete field;
+	return true;
+}
@@ -0,0 +1,114 @@
+#include "dol_detour.hpp"
+
+// Game API: thin wrappers converting game units to detour space around the float[] exports.
+// Every temporary lives on the native stack.
+
+struct GameQuery
+{
+	float extents[3];
+	dtPolyFlags filter[2];
+};
+
+static void ToGameQuery(dtGameQueryParams const *params, GameQuery *query)
+{
+	dtGameExtentsToDetour(&params->extents.x, query->extents);
+	query->filter[0] = (dtPolyFlags)params->includeFlags;
+	query->filter[1] = (dtPolyFlags)params->excludeFlags;
+}
+
+DLLEXPORT dtStatus GamePathStraight(dtNavMeshQuery *query, dtGameVector const *start, dtGameVector const *end, dtGameQueryParams const *params, dtStraightPathOptions pathOptions, dtPathOptions options, dtGamePathPoint *points, int maxPoints, int *pointCount)
+{
+	*pointCount = 0;
+	if (!points || maxPoints <= 0)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	GameQuery gameQuery;
+	ToGameQuery(params, &gameQuery);
+	float from[3], to[3];
+	dtGameToDetour(&start->x, from);
+	dtGameToDetour(&end->x, to);
+
+	int count = 0;
+	float pointBuffer[MAX_POLY * 3];
+	dtPolyFlags pointFlags[MAX_POLY];
+	auto status = PathStraightEx(query, from, to, gameQuery.extents, gameQuery.filter, pathOptions, options, &count, pointBuffer, pointFlags);
+	if (dtStatusFailed(status))
+		return status;
+	if (count > maxPoints)
+	{
+		count = maxPoints;
+		status |= DT_BUFFER_TOO_SMALL;
+	}
+	for (int i = 0; i < count; ++i)
+	{
+		dtDetourToGame(&pointBuffer[i * 3], &points[i].position.x);
+		points[i].flags = pointFlags[i];
+	}
+	*pointCount = count;
+	return status;
+}
+
+DLLEXPORT dtStatus GameFindRandomPointAroundCircle(dtNavMeshQuery *query, dtGameVector const *center, float radius, dtGameQueryParams const *params, dtGameVector *result)
+{
+	GameQuery gameQuery;
+	ToGameQuery(params, &gameQuery);
+	float position[3], output[3];
+	dtGameToDetour(&center->x, position);
+	auto status = FindRandomPointAroundCircle(query, position, radius * GAME_TO_DETOUR, gameQuery.extents, gameQuery.filter, output);
+	if (dtStatusSucceed(status))
+		dtDetourToGame(output, &result->x);
+	return status;
+}
+
+DLLEXPORT dtStatus GameFindClosestPoint(dtNavMeshQuery *query, dtGameVector const *center, dtGameQueryParams const *params, dtGameVector *result)
+{
+	GameQuery gameQuery;
+	ToGameQuery(params, &gameQuery);
+	float position[3], output[3];
+	dtGameToDetour(&center->x, position);
+	auto status = FindClosestPoint(query, position, gameQuery.extents, gameQuery.filter, output);
+	if (dtStatusSucceed(status))
+		dtDetourToGame(output, &result->x);
+	return status;
+}
+
+DLLEXPORT dtStatus GameGetPolyAt(dtNavMeshQuery *query, dtGameVector const *center, dtGameQueryParams const *params, dtPolyRef *polyRef, dtGameVector *result)
+{
+	GameQuery gameQuery;
+	ToGameQuery(params, &gameQuery);
+	float position[3], output[3];
+	dtGameToDetour(&center->x, position);
+	auto status = GetPolyAt(query, position, gameQuery.extents, (unsigned short *)gameQuery.filter, polyRef, output);
+	if (dtStatusSucceed(status) && result)
+		dtDetourToGame(output, &result->x);
+	return status;
+}
+
+DLLEXPORT dtStatus GameIsReachable(dtNavMeshQuery *query, dtGameVector const *start, dtGameVector const *end, dtGameQueryParams const *params, int *reachable)
+{
+	GameQuery gameQuery;
+	ToGameQuery(params, &gameQuery);
+	float from[3], to[3];
+	dtGameToDetour(&start->x, from);
+	dtGameToDetour(&end->x, to);
+	bool result = false;
+	auto status = IsReachable(query, from, to, gameQuery.extents, gameQuery.filter, &result);
+	*reachable = result ? 1 : 0;
+	return status;
+}
+
+static const dtGameApi gameApi = {
+	DT_GAME_API_VERSION,
+	sizeof(dtGameApi),
+	GamePathStraight,
+	GameFindRandomPointAroundCircle,
+	GameFindClosestPoint,
+	GameGetPolyAt,
+	GameIsReachable,
+	SetPolyFlags,
+};
+
+DLLEXPORT dtGameApi const *GetGameApi()
+{
+	return &gameApi;
+}
@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <new>
+
+#include "dol_detour.hpp"
+#include "dol_navmesh.hpp"
+
+DLLEXPORT dtStatus CreateNavMeshInstance(dtNavMesh *mesh, dtNavMeshInstance **instance)
+{
+	*instance = nullptr;
+	auto result = new (std::nothrow) dtNavMeshInstance();
+	if (!result)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	result->mesh = mesh;
+	auto status = result->overlay.init(mesh);
+	if (dtStatusFailed(status))
+	{
+		delete result;
+		return status;
+	}
+	if (auto info = GetNavMeshInfo(mesh))
+	{
+		std::lock_guard<std::mutex> lock(info->instancesLock);
+		info->instances.push_back(result);
+	}
+	*instance = result;
+	return status;
+}
+
+// the query runs on the shared navmesh and sees the instance flags, free it with FreeNavMeshQuery
+DLLEXPORT bool CreateInstanceQuery(dtNavMeshInstance *instance, dtNavMeshQuery **const query)
+{
+	if (!CreateNavMeshQuery(instance->mesh, query))
+		return false;
+	(*query)->setFlagsOverlay(&instance->overlay);
+	return true;
+}
+
+dtNavMeshInstance *GetQueryInstance(dtNavMeshQuery const *query)
+{
+	auto overlay = query->getFlagsOverlay();
+	auto info = overlay ? GetQueryInfo(query) : nullptr;
+	if (!info)
+		return nullptr;
+	std::lock_guard<std::mutex> lock(info->instancesLock);
+	for (auto instance : info->instances)
+		if (&instance->overlay == overlay)
+			return instance;
+	return nullptr;
+}
+
+DLLEXPORT dtStatus SetInstancePolyFlags(dtNavMeshInstance *instance, dtPolyRef ref, unsigned short flags)
+{
+	auto status = instance->overlay.setPolyFlags(ref, flags);
+	if (dtStatusSucceed(status))
+		instance->agents.polyFlagsChanged(ref, flags);
+	return status;
+}
+
+// GetBlockedAgents for the agents created with a query of the instance
+DLLEXPORT int GetInstanceBlockedAgents(dtNavMeshInstance *instance, dtNavAgent **agents, int maxAgents)
+{
+	return instance->agents.popBlocked(agents, maxAgents);
+}
+
+DLLEXPORT dtStatus GetInstancePolyFlags(dtNavMeshInstance *instance, dtPolyRef ref, unsigned short *flags)
+{
+	return instance->overlay.getPolyFlags(ref, flags);
+}
+
+DLLEXPORT bool FreeNavMeshInstance(dtNavMeshInstance *instance)
+{
+	if (auto info = GetNavMeshInfo(instance->mesh))
+	{
+		std::lock_guard<std::mutex> lock(info->instancesLock);
+		auto &instances = info->instances;
+		instances.erase(std::remove(instances.begin(), instances.end(), instance), instances.end());
+	}
+	delete instance;
+	return true;
+}
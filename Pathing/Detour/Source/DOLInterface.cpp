@@ -1,11 +1,17 @@
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
 #include <cstdio>
 #include <cstring>
 #include <exception>
 #include <functional>
 #include <iostream>
+#include <memory>
 #include <random>
 
-#include "dol_detour.hpp"
+#include "dol_internal.hpp"
+#include "dol_navmesh.hpp"
+#include "dol_trace.hpp"
 
 /*
 	[DllImport("dol_detour", CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
@@ -55,13 +61,31 @@ struct dtNavMeshTileHeader
 	std::int32_t size;
 };
 
-DLLEXPORT bool LoadNavMesh(char const *file, dtNavMesh **const mesh)
+// sum of the tile data sizes (16 bytes aligned) following the set header, the file is rewound
+static size_t GetTileDataSize(std::FILE *fp, int numTiles)
+{
+	auto begin = std::ftell(fp);
+	size_t total = 0;
+	for (int tileIdx = 0; tileIdx < numTiles; ++tileIdx)
+	{
+		dtNavMeshTileHeader tileHeader;
+		if (fread(&tileHeader, sizeof(tileHeader), 1, fp) != 1 || tileHeader.ref == 0 || tileHeader.size <= 0)
+			break;
+		total += (tileHeader.size + 15) & ~15;
+		std::fseek(fp, tileHeader.size, SEEK_CUR);
+	}
+	std::fseek(fp, begin, SEEK_SET);
+	return total;
+}
+
+DLLEXPORT bool LoadNavMeshEx(char const *file, dtLoadOptions options, dtNavMesh **const mesh)
 {
 	// load the file
 	auto fp = std::fopen(file, "rb");
 	if (!fp)
 		return false;
 
+	std::unique_ptr<dtNavMeshArena> arena;
 	// scope for fp closing
 	{
 		auto _fpRAII = RAII([=]
@@ -73,6 +97,15 @@ DLLEXPORT bool LoadNavMesh(char const *file, dtNavMesh **const mesh)
 		if (header.magic != 0x4d534554 || header.version != 1)
 			return false;
 
+		// every tile is sized up front so the whole mesh lands in a single block
+		if (options & (DT_LOAD_ARENA | DT_LOAD_HUGE_PAGES | DT_LOAD_EXPLICIT_HUGE_PAGES))
+		{
+			auto hugePages = (options & DT_LOAD_EXPLICIT_HUGE_PAGES) ? 2 : (options & DT_LOAD_HUGE_PAGES) ? 1 : 0;
+			arena.reset(dtNavMeshArena::create(std::max<size_t>(GetTileDataSize(fp, header.numTiles), 16), hugePages));
+			if (!arena)
+				return false;
+		}
+
 		// init mesh and query
 		*mesh = dtAllocNavMesh();
 		auto status = (*mesh)->init(&header.params);
@@ -89,23 +122,46 @@ DLLEXPORT bool LoadNavMesh(char const *file, dtNavMesh **const mesh)
 			{
 				dtNavMeshTileHeader tileHeader;
 				fread(&tileHeader, sizeof(tileHeader), 1, fp);
-				void *data;
-				if (tileHeader.ref == 0 || tileHeader.size == 0 || (data = dtAlloc(tileHeader.size, DT_ALLOC_PERM)) == 0)
+				if (tileHeader.ref == 0 || tileHeader.size == 0)
+					break;
+				void *data = arena ? arena->allocate(tileHeader.size) : dtAlloc(tileHeader.size, DT_ALLOC_PERM);
+				if (!data)
 					break;
-				memset(data, 0, tileHeader.size);
+				// the arena is zeroed already
+				if (!arena)
+					memset(data, 0, tileHeader.size);
 				fread(data, tileHeader.size, 1, fp);
-				(*mesh)->addTile((unsigned char *)data, tileHeader.size, 1, tileHeader.ref, nullptr);
+				// arena slices are not owned by the tile, the arena is freed with the mesh info
+				(*mesh)->addTile((unsigned char *)data, tileHeader.size, arena ? 0 : DT_TILE_FREE_DATA, tileHeader.ref, nullptr);
 				tileIdx += 1;
 			}
 		}
 	}
+	auto info = RegisterNavMesh(*mesh);
+	info->islands.build(*mesh);
+	info->file = file;
+	info->arena = std::move(arena);
+	// without the grid the queries walk the BV trees, the mesh is still usable
+	if (options & DT_LOAD_POLY_GRID)
+		BuildPolyGrid(*mesh, nullptr);
+	if (options & DT_LOAD_SEARCH_GRAPH)
+		BuildSearchGraph(*mesh, nullptr);
 	return true;
 }
 
+DLLEXPORT bool LoadNavMesh(char const *file, dtNavMesh **const mesh)
+{
+	return LoadNavMeshEx(file, DT_LOAD_DEFAULT, mesh);
+}
+
 DLLEXPORT bool FreeNavMesh(dtNavMesh *meshPtr)
 {
 	if (meshPtr)
+	{
+		// the info may own the tile data: free the mesh first
+		auto info = UnregisterNavMesh(meshPtr);
 		dtFreeNavMesh(meshPtr);
+	}
 	return true;
 }
 
@@ -120,6 +176,13 @@ DLLEXPORT bool CreateNavMeshQuery(dtNavMesh *mesh, dtNavMeshQuery **const query)
 		*query = nullptr;
 		return false;
 	}
+	auto info = GetNavMeshInfo(mesh);
+	if (info)
+	{
+		(*query)->setPolyGrid(info->polyGrid.get());
+		(*query)->setSearchGraph(info->searchGraph.get());
+		(*query)->setUserData(info);
+	}
 	return true;
 }
 DLLEXPORT bool FreeNavMeshQuery(dtNavMeshQuery *queryPtr)
@@ -142,32 +205,214 @@ static inline bool IsMidPointOnPath(float const* A, float const* B, float const*
 	return len <= 1;
 }
 
-void PathOptimize(dtNavMeshQuery *query, int *pointCount, float *pointBuffer, dtPolyRef *refs)
+// max points skipped by one raycast shortcut, keeps the stage linear in the path length
+static const int MAX_SHORTCUT_LOOKAHEAD = 8;
+
+// Removes in place the points lying on the line between their neighbours, in a single pass.
+// A point is only merged into the previous kept point if both have the same flags.
+static void CompactPath(int *pointCount, float *pointBuffer, dtPolyRef *refs, dtPolyFlags *pointFlags)
 {
-	for (int i = 0; i < *pointCount - 2; ++i)
+	if (*pointCount <= 2)
+		return;
+	int kept = 1; // pointBuffer[kept - 1] is the last kept point
+	for (int i = 1; i < *pointCount - 1; ++i)
 	{
-		unsigned short flags[2];
-		query->getAttachedNavMesh()->getPolyFlags(refs[i + 0], flags + 0);
-		query->getAttachedNavMesh()->getPolyFlags(refs[i + 1], flags + 1);
-		if (flags[0] != flags[1]) // we can't merge 2 different points
+		float const *A = &pointBuffer[(kept - 1) * 3];
+		float const *B = &pointBuffer[i * 3];
+		float const *C = &pointBuffer[(i + 1) * 3];
+		if (pointFlags[kept - 1] == pointFlags[i] && IsMidPointOnPath(A, B, C))
 			continue;
+		if (kept != i)
+		{
+			dtVcopy(&pointBuffer[kept * 3], B);
+			refs[kept] = refs[i];
+			pointFlags[kept] = pointFlags[i];
+		}
+		++kept;
+	}
+	auto last = *pointCount - 1;
+	dtVcopy(&pointBuffer[kept * 3], &pointBuffer[last * 3]);
+	refs[kept] = refs[last];
+	pointFlags[kept] = pointFlags[last];
+	*pointCount = kept + 1;
+}
 
-		// we take 3 points: first --- mid --- last and check if mid is on the line, in this case, we remove mid
-		float const *A = &(pointBuffer[(i + 0) * 3]);
-		float const *B = &(pointBuffer[(i + 1) * 3]); // mid, point to remove
-		float const *C = &(pointBuffer[(i + 2) * 3]);
+static bool IsShortcutClear(dtNavMeshQuery *query, dtQueryFilter const *filter, dtPolyRef startRef, float const *start, float const *end, unsigned short flags)
+{
+	dtPolyRef polys[MAX_POLY];
+	dtRaycastHit hit;
+	hit.path = polys;
+	hit.pathCount = 0;
+	hit.maxPath = MAX_POLY;
+	auto status = query->raycast(startRef, start, end, filter, 0, &hit);
+	if (dtStatusFailed(status) || dtStatusDetail(status, DT_BUFFER_TOO_SMALL) || hit.t != FLT_MAX)
+		return false;
+	for (int i = 0; i < hit.pathCount; ++i)
+	{
+		unsigned short polyFlags;
+		query->getPolyFlags(polys[i], &polyFlags);
+		if (polyFlags != flags)
+			return false;
+	}
+	return true;
+}
 
-		if (IsMidPointOnPath(A, B, C))
+// Skips the waypoints between two points when the navmesh ray between them is clear and stays
+// on the flags of the first point, so doors and water crossings keep their waypoints.
+static void ShortcutPath(dtNavMeshQuery *query, dtQueryFilter const *filter, int *pointCount, float *pointBuffer, dtPolyRef *refs, dtPolyFlags *pointFlags)
+{
+	int kept = 0;
+	int i = 0;
+	while (i < *pointCount - 1)
+	{
+		// the shortcut extends while every skipped point has the same flags and the ray is clear
+		int next = i + 1;
+		for (int j = i + 2; j < *pointCount && j <= i + MAX_SHORTCUT_LOOKAHEAD; ++j)
 		{
-			std::copy(pointBuffer + (i + 2) * 3, pointBuffer + (*pointCount) * 3, pointBuffer + (i + 1) * 3);
-			std::copy(refs + i + 2, refs + *pointCount, refs + i + 1);
-			*pointCount -= 1;
-			--i; // we redo this loop
+			if (pointFlags[j - 1] != pointFlags[i] || !refs[i] || !IsShortcutClear(query, filter, refs[i], &pointBuffer[i * 3], &pointBuffer[j * 3], pointFlags[i]))
+				break;
+			next = j;
 		}
+		if (kept != i)
+		{
+			dtVcopy(&pointBuffer[kept * 3], &pointBuffer[i * 3]);
+			refs[kept] = refs[i];
+			pointFlags[kept] = pointFlags[i];
+		}
+		++kept;
+		i = next;
 	}
+	dtVcopy(&pointBuffer[kept * 3], &pointBuffer[(*pointCount - 1) * 3]);
+	refs[kept] = refs[*pointCount - 1];
+	pointFlags[kept] = pointFlags[*pointCount - 1];
+	*pointCount = kept + 1;
 }
 
-DLLEXPORT dtStatus PathStraight(dtNavMeshQuery *query, float start[], float end[], float polyPickExt[], dtPolyFlags queryFilter[], dtStraightPathOptions pathOptions, int *pointCount, float *pointBuffer, dtPolyFlags *pointFlags)
+static std::atomic<unsigned long long> statQueries;
+static std::atomic<unsigned long long> statUnreachable;
+static std::atomic<unsigned long long> statRaycastHits;
+
+// the straight line from start to end is walkable and crosses polys of a single flag class:
+// the two points path is what findPath + findStraightPath + CompactPath would return
+static bool RaycastPath(dtNavMeshQuery *query, dtPolyRef startRef, dtPolyRef endRef, float const *start, float const *end, dtQueryFilter const *filter, int *pointCount, float *pointBuffer, dtPolyFlags *pointFlags)
+{
+	dtPolyRef polys[MAX_POLY];
+	dtRaycastHit hit;
+	hit.path = polys;
+	hit.pathCount = 0;
+	hit.maxPath = MAX_POLY;
+	auto status = query->raycast(startRef, start, end, filter, 0, &hit);
+	if (dtStatusFailed(status) || hit.t != FLT_MAX || hit.pathCount == 0 || polys[hit.pathCount - 1] != endRef)
+		return false;
+
+	auto mesh = query->getAttachedNavMesh();
+	unsigned short startFlags;
+	unsigned char startArea;
+	query->getPolyFlags(startRef, &startFlags);
+	mesh->getPolyArea(startRef, &startArea);
+	for (int i = 1; i < hit.pathCount; ++i)
+	{
+		unsigned short flags;
+		unsigned char area;
+		query->getPolyFlags(polys[i], &flags);
+		mesh->getPolyArea(polys[i], &area);
+		if (flags != startFlags || area != startArea)
+			return false;
+	}
+
+	dtVcopy(&pointBuffer[0], start);
+	dtVcopy(&pointBuffer[3], end);
+	pointFlags[0] = (dtPolyFlags)startFlags;
+	pointFlags[1] = (dtPolyFlags)startFlags;
+	*pointCount = 2;
+	return true;
+}
+
+dtIslands *GetQueryIslands(dtNavMeshQuery const *query)
+{
+	auto overlay = query->getFlagsOverlay();
+	if (overlay && overlay->getCopiedTileCount() > 0)
+		return nullptr;
+	auto info = GetQueryInfo(query);
+	return info ? &info->islands : nullptr;
+}
+
+dtStatus StraightPathFromCorridor(dtNavMeshQuery *query, dtPolyRef const *polys, int npolys, dtPolyRef endRef, float const *start, float const *end, dtQueryFilter const *filter, dtStraightPathOptions pathOptions, dtPathOptions options, int *pointCount, float *pointBuffer, dtPolyFlags *pointFlags)
+{
+	dtStatus status = DT_SUCCESS;
+	*pointCount = 0;
+	float epos[3];
+	epos[0] = end[0];
+	epos[1] = end[1];
+	epos[2] = end[2];
+	if ((polys[npolys + -1] == endRef) || dtStatusSucceed(status = query->closestPointOnPoly(polys[npolys + -1], end, epos, nullptr)))
+	{
+		dtPolyRef straightPathRefs[MAX_POLY];
+		unsigned char straightPathFlags[MAX_POLY];
+		if (dtStatusSucceed(status = query->findStraightPath(start, epos, polys, npolys, pointBuffer, straightPathFlags, straightPathRefs, pointCount, MAX_POLY, pathOptions)) && (0 < *pointCount))
+		{
+			// flags are read once per point, the post-processing stages work on them
+			for (int i = 0; i < *pointCount; ++i)
+			{
+				unsigned short flags = 0;
+				query->getPolyFlags(straightPathRefs[i], &flags);
+				pointFlags[i] = (dtPolyFlags)flags;
+			}
+			if (!(options & DT_PATH_KEEP_COLLINEAR))
+				CompactPath(pointCount, pointBuffer, straightPathRefs, pointFlags);
+			if (options & DT_PATH_SHORTCUT)
+				ShortcutPath(query, filter, pointCount, pointBuffer, straightPathRefs, pointFlags);
+		}
+	}
+	return status;
+}
+
+dtStatus PathStraightFromPolys(dtNavMeshQuery *query, dtPolyRef startRef, dtPolyRef endRef, float const *start, float const *end, dtQueryFilter const *filter, dtStraightPathOptions pathOptions, dtPathOptions options, int *pointCount, float *pointBuffer, dtPolyFlags *pointFlags, dtPolyRef *corridor, int *corridorCount)
+{
+	dtStatus status;
+	*pointCount = 0;
+	if (corridorCount)
+		*corridorCount = 0;
+
+	statQueries.fetch_add(1, std::memory_order_relaxed);
+
+	// no need to flood the node pool toward another island
+	auto islands = GetQueryIslands(query);
+	if (islands && !islands->isReachable(startRef, endRef, filter))
+	{
+		statUnreachable.fetch_add(1, std::memory_order_relaxed);
+		return DT_FAILURE | DT_UNREACHABLE;
+	}
+
+	if ((options & DT_PATH_RAYCAST) && startRef && endRef && RaycastPath(query, startRef, endRef, start, end, filter, pointCount, pointBuffer, pointFlags))
+	{
+		statRaycastHits.fetch_add(1, std::memory_order_relaxed);
+		return DT_SUCCESS;
+	}
+
+	int npolys = 0;
+	dtPolyRef polys[MAX_POLY];
+	auto info = GetQueryInfo(query);
+	if (info && info->landmarks && (options & DT_PATH_LANDMARKS))
+	{
+		dtLandmarkHeuristic heuristic(info->landmarks.get(), endRef, end);
+		status = query->findPath(startRef, endRef, start, end, filter, polys, &npolys, MAX_POLY, &heuristic);
+	}
+	else
+		status = query->findPath(startRef, endRef, start, end, filter, polys, &npolys, MAX_POLY);
+	if (dtStatusSucceed(status))
+	{
+		if (corridor)
+		{
+			std::copy(polys, polys + npolys, corridor);
+			*corridorCount = npolys;
+		}
+		status = StraightPathFromCorridor(query, polys, npolys, endRef, start, end, filter, pathOptions, options, pointCount, pointBuffer, pointFlags);
+	}
+	return status;
+}
+
+static dtStatus PathStraightExImpl(dtNavMeshQuery *query, float start[], float end[], float polyPickExt[], dtPolyFlags queryFilter[], dtStraightPathOptions pathOptions, dtPathOptions options, int *pointCount, float *pointBuffer, dtPolyFlags *pointFlags)
 {
 	dtStatus status;
 	*pointCount = 0;
@@ -178,39 +423,15 @@ DLLEXPORT dtStatus PathStraight(dtNavMeshQuery *query, float start[], float end[
 	filter.setIncludeFlags(queryFilter[0]);
 	filter.setExcludeFlags(queryFilter[1]);
 	if (dtStatusSucceed(status = query->findNearestPoly(start, polyPickExt, &filter, &startRef, nullptr)) && dtStatusSucceed(status = query->findNearestPoly(end, polyPickExt, &filter, &endRef, nullptr)))
-	{
-		int npolys = 0;
-		dtPolyRef polys[MAX_POLY];
-		if (dtStatusSucceed(status = query->findPath(startRef, endRef, start, end, &filter, polys, &npolys, MAX_POLY)))
-		{
-			float epos[3];
-			epos[0] = end[0];
-			epos[1] = end[1];
-			epos[2] = end[2];
-			if ((polys[npolys + -1] == endRef) || dtStatusSucceed(status = query->closestPointOnPoly(polys[npolys + -1], end, epos, nullptr)))
-			{
-				dtPolyRef straightPathPolys[MAX_POLY];
-				unsigned char straightPathFlags[MAX_POLY];
-				auto straightPathRefs = &straightPathPolys[0];
-				if (dtStatusSucceed(status = query->findStraightPath(start, epos, polys, npolys, pointBuffer, straightPathFlags, straightPathRefs, pointCount, MAX_POLY, pathOptions)) && (0 < *pointCount))
-				{
-					PathOptimize(query, pointCount, pointBuffer, straightPathRefs);
-					int pointIdx = 0;
-					while (*pointCount != pointIdx && pointIdx <= *pointCount)
-					{
-						auto ref = *straightPathRefs;
-						pointIdx = pointIdx + 1;
-						straightPathRefs = straightPathRefs + 1;
-						query->getAttachedNavMesh()->getPolyFlags(ref, (unsigned short *)pointFlags);
-						pointFlags = pointFlags + 1;
-					}
-				}
-			}
-		}
-	}
+		status = PathStraightFromPolys(query, startRef, endRef, start, end, &filter, pathOptions, options, pointCount, pointBuffer, pointFlags);
 	return status;
 }
 
+static dtStatus PathStraightImpl(dtNavMeshQuery *query, float start[], float end[], float polyPickExt[], dtPolyFlags queryFilter[], dtStraightPathOptions pathOptions, int *pointCount, float *pointBuffer, dtPolyFlags *pointFlags)
+{
+	return PathStraightExImpl(query, start, end, polyPickExt, queryFilter, pathOptions, DT_PATH_DEFAULT, pointCount, pointBuffer, pointFlags);
+}
+
 thread_local std::mt19937 rngMt = std::mt19937(std::random_device{}());
 thread_local std::uniform_real_distribution<float> rng(0.0f, 1.0f);
 
@@ -219,7 +440,12 @@ float frand()
 	return rng(rngMt);
 }
 
-DLLEXPORT dtStatus FindRandomPointAroundCircle(dtNavMeshQuery *query, float center[], float radius, float polyPickExt[], dtPolyFlags queryFilter[], float *outputVector)
+DLLEXPORT void SeedRandom(unsigned int seed)
+{
+	rngMt.seed(seed);
+}
+
+static dtStatus FindRandomPointAroundCircleImpl(dtNavMeshQuery *query, float center[], float radius, float polyPickExt[], dtPolyFlags queryFilter[], float *outputVector)
 {
 	dtQueryFilter filter;
 	filter.setIncludeFlags(queryFilter[0]);
@@ -234,7 +460,34 @@ DLLEXPORT dtStatus FindRandomPointAroundCircle(dtNavMeshQuery *query, float cent
 	return status;
 }
 
-DLLEXPORT dtStatus FindClosestPoint(dtNavMeshQuery *query, float center[], float polyPickExt[], dtPolyFlags queryFilter[], float *outputVector)
+DLLEXPORT dtStatus FindRandomRoamPath(dtNavMeshQuery *query, float start[], float radius, float polyPickExt[], dtPolyFlags queryFilter[], dtStraightPathOptions pathOptions, float *outputVector, int *pointCount, float *pointBuffer, dtPolyFlags *pointFlags)
+{
+	*pointCount = 0;
+	dtQueryFilter filter;
+	filter.setIncludeFlags(queryFilter[0]);
+	filter.setExcludeFlags(queryFilter[1]);
+	dtPolyRef startRef;
+	auto status = query->findNearestPoly(start, polyPickExt, &filter, &startRef, nullptr);
+	if (dtStatusFailed(status))
+		return status;
+	dtPolyRef endRef;
+	status = query->findRandomPointAroundCircle(startRef, start, radius, &filter, frand, &endRef, outputVector);
+	if (dtStatusFailed(status))
+		return status;
+
+	// the search tree of the random pick leads back to the start poly
+	int npolys = 0;
+	dtPolyRef polys[MAX_POLY];
+	status = query->getPathFromDijkstraSearch(endRef, polys, &npolys, MAX_POLY);
+	if (dtStatusSucceed(status))
+		status = StraightPathFromCorridor(query, polys, npolys, endRef, start, outputVector, &filter, pathOptions, DT_PATH_DEFAULT, pointCount, pointBuffer, pointFlags);
+	// the straight path clamps its end to the poly, the destination is where the path really ends
+	if (dtStatusSucceed(status) && *pointCount > 0)
+		dtVcopy(outputVector, &pointBuffer[(*pointCount - 1) * 3]);
+	return status;
+}
+
+static dtStatus FindClosestPointImpl(dtNavMeshQuery *query, float center[], float polyPickExt[], dtPolyFlags queryFilter[], float *outputVector)
 {
 	dtQueryFilter filter;
 	filter.setIncludeFlags(queryFilter[0]);
@@ -246,23 +499,281 @@ DLLEXPORT dtStatus FindClosestPoint(dtNavMeshQuery *query, float center[], float
 	return status;
 }
 
-DLLEXPORT dtStatus GetPolyAt(dtNavMeshQuery *query, float *center, float *extents, unsigned short *queryFilter, dtPolyRef *polyRef, float *point)
+static dtStatus GetPolyAtImpl(dtNavMeshQuery *query, float *center, float *extents, unsigned short *queryFilter, dtPolyRef *polyRef, float *point)
 {
+	*polyRef = 0;
 	dtQueryFilter filter;
 	filter.setIncludeFlags(queryFilter[0]);
 	filter.setExcludeFlags(queryFilter[1]);
 	return query->findNearestPoly(center, extents, &filter, polyRef, point);
 }
 
-DLLEXPORT dtStatus SetPolyFlags(dtNavMesh *navMesh, dtPolyRef ref, unsigned short flags)
+static dtStatus SetPolyFlagsImpl(dtNavMesh *navMesh, dtPolyRef ref, unsigned short flags)
 {
-	return navMesh->setPolyFlags(ref, flags);
+	auto status = navMesh->setPolyFlags(ref, flags);
+	auto info = GetNavMeshInfo(navMesh);
+	if (dtStatusSucceed(status) && info)
+	{
+		info->islands.polyFlagsChanged(ref, flags);
+		info->agents.polyFlagsChanged(ref, flags);
+		if (info->searchGraph)
+			info->searchGraph->setPolyFlags(ref, flags);
+	}
+	return status;
 }
 
-DLLEXPORT dtStatus QueryPolygons(dtNavMeshQuery *query, float *center, float *polyPickExtents, unsigned short *queryFilter, dtPolyRef *polys, int *polyCount, int maxPolys)
+DLLEXPORT bool GetFilterPreset(dtFilterPreset preset, dtPolyFlags *queryFilter)
+{
+	if (preset >= DT_FILTER_PRESET_COUNT || !queryFilter)
+		return false;
+	queryFilter[0] = dtFilterPresetFlags[preset][0];
+	queryFilter[1] = dtFilterPresetFlags[preset][1];
+	return true;
+}
+
+DLLEXPORT bool GetPathStats(dtPathStats *stats, bool reset)
+{
+	if (reset)
+	{
+		stats->queries = statQueries.exchange(0);
+		stats->unreachable = statUnreachable.exchange(0);
+		stats->raycastHits = statRaycastHits.exchange(0);
+	}
+	else
+	{
+		stats->queries = statQueries.load();
+		stats->unreachable = statUnreachable.load();
+		stats->raycastHits = statRaycastHits.load();
+	}
+	return true;
+}
+
+static dtStatus BuildLandmarksImpl(dtNavMesh *navMesh, int landmarkCount, int *memory)
+{
+	auto info = GetNavMeshInfo(navMesh);
+	if (!info || landmarkCount <= 0 || landmarkCount > dtLandmarks::MAX_LANDMARKS)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	std::unique_ptr<dtLandmarks> landmarks(new dtLandmarks());
+	if (!landmarks->build(navMesh, landmarkCount))
+		return DT_FAILURE;
+	if (memory)
+		*memory = (int)landmarks->getMemory();
+	info->landmarks = std::move(landmarks);
+	return DT_SUCCESS;
+}
+
+DLLEXPORT dtStatus BuildPolyGrid(dtNavMesh *navMesh, int *memory)
+{
+	auto info = GetNavMeshInfo(navMesh);
+	if (!info)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	// never replaced: the existing queries point to it
+	if (!info->polyGrid)
+	{
+		std::unique_ptr<dtPolyGrid> grid(new dtPolyGrid());
+		auto status = grid->init(navMesh);
+		if (dtStatusFailed(status))
+			return status;
+		info->polyGrid = std::move(grid);
+	}
+	if (memory)
+		*memory = (int)info->polyGrid->getMemory();
+	return DT_SUCCESS;
+}
+
+DLLEXPORT dtStatus BuildSearchGraph(dtNavMesh *navMesh, int *memory)
+{
+	auto info = GetNavMeshInfo(navMesh);
+	if (!info)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	// never replaced: the existing queries point to it
+	if (!info->searchGraph)
+	{
+		std::unique_ptr<dtSearchGraph> graph(new dtSearchGraph());
+		auto status = graph->init(navMesh);
+		if (dtStatusFailed(status))
+			return status;
+		info->searchGraph = std::move(graph);
+	}
+	if (memory)
+		*memory = (int)info->searchGraph->getMemory();
+	return DT_SUCCESS;
+}
+
+static dtStatus QueryPolygonsImpl(dtNavMeshQuery *query, float *center, float *polyPickExtents, unsigned short *queryFilter, dtPolyRef *polys, int *polyCount, int maxPolys)
 {
 	dtQueryFilter filter;
 	filter.setIncludeFlags(queryFilter[0]);
 	filter.setExcludeFlags(queryFilter[1]);
 	return query->queryPolygons(center, polyPickExtents, &filter, polys, polyCount, maxPolys);
 }
+
+static dtStatus IsReachableImpl(dtNavMeshQuery *query, float start[], float end[], float polyPickExt[], dtPolyFlags queryFilter[], bool *reachable)
+{
+	dtQueryFilter filter;
+	filter.setIncludeFlags(queryFilter[0]);
+	filter.setExcludeFlags(queryFilter[1]);
+	dtPolyRef startRef;
+	dtPolyRef endRef;
+	dtStatus status;
+	*reachable = false;
+	if (dtStatusSucceed(status = query->findNearestPoly(start, polyPickExt, &filter, &startRef, nullptr)) && dtStatusSucceed(status = query->findNearestPoly(end, polyPickExt, &filter, &endRef, nullptr)))
+	{
+		if (!startRef || !endRef)
+			return DT_FAILURE | DT_INVALID_PARAM;
+		auto islands = GetQueryIslands(query);
+		*reachable = !islands || islands->isReachable(startRef, endRef, &filter);
+	}
+	return status;
+}
+
+// Traced exports: the call runs untouched unless StartTrace is active, then its inputs,
+// outputs, status and latency are appended to the trace (see dol_trace.hpp).
+
+DLLEXPORT dtStatus PathStraight(dtNavMeshQuery *query, float start[], float end[], float polyPickExt[], dtPolyFlags queryFilter[], dtStraightPathOptions pathOptions, int *pointCount, float *pointBuffer, dtPolyFlags *pointFlags)
+{
+	if (!dtTraceEnabled())
+		return PathStraightImpl(query, start, end, polyPickExt, queryFilter, pathOptions, pointCount, pointBuffer, pointFlags);
+	auto begin = std::chrono::steady_clock::now();
+	auto status = PathStraightImpl(query, start, end, polyPickExt, queryFilter, pathOptions, pointCount, pointBuffer, pointFlags);
+	dtTraceRecord record(DT_TRACE_PATH_STRAIGHT, query->getAttachedNavMesh(), begin);
+	record.put(start, 3);
+	record.put(end, 3);
+	record.put(polyPickExt, 3);
+	record.put(queryFilter, 2);
+	record.put((std::uint32_t)pathOptions);
+	record.put(*pointCount);
+	record.put(pointBuffer, *pointCount * 3);
+	record.put(pointFlags, *pointCount);
+	record.commit(status);
+	return status;
+}
+
+DLLEXPORT dtStatus PathStraightEx(dtNavMeshQuery *query, float start[], float end[], float polyPickExt[], dtPolyFlags queryFilter[], dtStraightPathOptions pathOptions, dtPathOptions options, int *pointCount, float *pointBuffer, dtPolyFlags *pointFlags)
+{
+	if (!dtTraceEnabled())
+		return PathStraightExImpl(query, start, end, polyPickExt, queryFilter, pathOptions, options, pointCount, pointBuffer, pointFlags);
+	auto begin = std::chrono::steady_clock::now();
+	auto status = PathStraightExImpl(query, start, end, polyPickExt, queryFilter, pathOptions, options, pointCount, pointBuffer, pointFlags);
+	dtTraceRecord record(DT_TRACE_PATH_STRAIGHT_EX, query->getAttachedNavMesh(), begin);
+	record.put(start, 3);
+	record.put(end, 3);
+	record.put(polyPickExt, 3);
+	record.put(queryFilter, 2);
+	record.put((std::uint32_t)pathOptions);
+	record.put((std::uint32_t)options);
+	record.put(*pointCount);
+	record.put(pointBuffer, *pointCount * 3);
+	record.put(pointFlags, *pointCount);
+	record.commit(status);
+	return status;
+}
+
+DLLEXPORT dtStatus FindRandomPointAroundCircle(dtNavMeshQuery *query, float center[], float radius, float polyPickExt[], dtPolyFlags queryFilter[], float *outputVector)
+{
+	if (!dtTraceEnabled())
+		return FindRandomPointAroundCircleImpl(query, center, radius, polyPickExt, queryFilter, outputVector);
+	auto begin = std::chrono::steady_clock::now();
+	// the generator restarts from a recorded seed, the replay draws the same point
+	auto seed = (unsigned int)rngMt();
+	rngMt.seed(seed);
+	auto status = FindRandomPointAroundCircleImpl(query, center, radius, polyPickExt, queryFilter, outputVector);
+	dtTraceRecord record(DT_TRACE_FIND_RANDOM_POINT, query->getAttachedNavMesh(), begin);
+	record.put(center, 3);
+	record.put(radius);
+	record.put(polyPickExt, 3);
+	record.put(queryFilter, 2);
+	record.put(seed);
+	record.put(outputVector, 3);
+	record.commit(status);
+	return status;
+}
+
+DLLEXPORT dtStatus FindClosestPoint(dtNavMeshQuery *query, float center[], float polyPickExt[], dtPolyFlags queryFilter[], float *outputVector)
+{
+	if (!dtTraceEnabled())
+		return FindClosestPointImpl(query, center, polyPickExt, queryFilter, outputVector);
+	auto begin = std::chrono::steady_clock::now();
+	auto status = FindClosestPointImpl(query, center, polyPickExt, queryFilter, outputVector);
+	dtTraceRecord record(DT_TRACE_FIND_CLOSEST_POINT, query->getAttachedNavMesh(), begin);
+	record.put(center, 3);
+	record.put(polyPickExt, 3);
+	record.put(queryFilter, 2);
+	record.put(outputVector, 3);
+	record.commit(status);
+	return status;
+}
+
+DLLEXPORT dtStatus GetPolyAt(dtNavMeshQuery *query, float *center, float *extents, unsigned short *queryFilter, dtPolyRef *polyRef, float *point)
+{
+	if (!dtTraceEnabled())
+		return GetPolyAtImpl(query, center, extents, queryFilter, polyRef, point);
+	auto begin = std::chrono::steady_clock::now();
+	auto status = GetPolyAtImpl(query, center, extents, queryFilter, polyRef, point);
+	dtTraceRecord record(DT_TRACE_GET_POLY_AT, query->getAttachedNavMesh(), begin);
+	record.put(center, 3);
+	record.put(extents, 3);
+	record.put(queryFilter, 2);
+	record.put(*polyRef);
+	record.put(point, 3);
+	record.commit(status);
+	return status;
+}
+
+DLLEXPORT dtStatus SetPolyFlags(dtNavMesh *navMesh, dtPolyRef ref, unsigned short flags)
+{
+	if (!dtTraceEnabled())
+		return SetPolyFlagsImpl(navMesh, ref, flags);
+	auto begin = std::chrono::steady_clock::now();
+	auto status = SetPolyFlagsImpl(navMesh, ref, flags);
+	dtTraceRecord record(DT_TRACE_SET_POLY_FLAGS, navMesh, begin);
+	record.put(ref);
+	record.put(flags);
+	record.commit(status);
+	return status;
+}
+
+DLLEXPORT dtStatus BuildLandmarks(dtNavMesh *navMesh, int landmarkCount, int *memory)
+{
+	if (!dtTraceEnabled())
+		return BuildLandmarksImpl(navMesh, landmarkCount, memory);
+	auto begin = std::chrono::steady_clock::now();
+	auto status = BuildLandmarksImpl(navMesh, landmarkCount, memory);
+	dtTraceRecord record(DT_TRACE_BUILD_LANDMARKS, navMesh, begin);
+	record.put(landmarkCount);
+	record.commit(status);
+	return status;
+}
+
+DLLEXPORT dtStatus QueryPolygons(dtNavMeshQuery *query, float *center, float *polyPickExtents, unsigned short *queryFilter, dtPolyRef *polys, int *polyCount, int maxPolys)
+{
+	if (!dtTraceEnabled())
+		return QueryPolygonsImpl(query, center, polyPickExtents, queryFilter, polys, polyCount, maxPolys);
+	auto begin = std::chrono::steady_clock::now();
+	auto status = QueryPolygonsImpl(query, center, polyPickExtents, queryFilter, polys, polyCount, maxPolys);
+	dtTraceRecord record(DT_TRACE_QUERY_POLYGONS, query->getAttachedNavMesh(), begin);
+	record.put(center, 3);
+	record.put(polyPickExtents, 3);
+	record.put(queryFilter, 2);
+	record.put(maxPolys);
+	record.put(*polyCount);
+	record.put(polys, *polyCount);
+	record.commit(status);
+	return status;
+}
+
+DLLEXPORT dtStatus IsReachable(dtNavMeshQuery *query, float start[], float end[], float polyPickExt[], dtPolyFlags queryFilter[], bool *reachable)
+{
+	if (!dtTraceEnabled())
+		return IsReachableImpl(query, start, end, polyPickExt, queryFilter, reachable);
+	auto begin = std::chrono::steady_clock::now();
+	auto status = IsReachableImpl(query, start, end, polyPickExt, queryFilter, reachable);
+	dtTraceRecord record(DT_TRACE_IS_REACHABLE, query->getAttachedNavMesh(), begin);
+	record.put(start, 3);
+	record.put(end, 3);
+	record.put(polyPickExt, 3);
+	record.put(queryFilter, 2);
+	record.put((std::uint8_t)(*reachable ? 1 : 0));
+	record.commit(status);
+	return status;
+}
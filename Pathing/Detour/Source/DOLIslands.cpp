@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <mutex>
+#include <numeric>
+
+#include "dol_islands.hpp"
+
+static unsigned int FindRoot(std::vector<unsigned int> &parents, unsigned int i)
+{
+	while (parents[i] != i)
+		i = parents[i] = parents[parents[i]];
+	return i;
+}
+
+static void Union(std::vector<unsigned int> &parents, unsigned int a, unsigned int b)
+{
+	a = FindRoot(parents, a);
+	b = FindRoot(parents, b);
+	if (a != b)
+		parents[std::max(a, b)] = std::min(a, b);
+}
+
+static inline bool PassFlags(unsigned short flags, unsigned short includeFlags, unsigned short excludeFlags)
+{
+	return (flags & includeFlags) != 0 && (flags & excludeFlags) == 0;
+}
+
+void dtIslands::build(dtNavMesh const *mesh)
+{
+	std::unique_lock<std::shared_mutex> lock(m_lock);
+	m_polys.build(mesh);
+	buildLocked();
+}
+
+void dtIslands::buildLocked()
+{
+	auto mesh = m_polys.getMesh();
+	auto maxTiles = mesh->getMaxTiles();
+	auto polyCount = m_polys.getPolyCount();
+
+	// polys linked together with the same flags end up in the same component
+	std::vector<unsigned int> parents(polyCount);
+	std::iota(parents.begin(), parents.end(), 0);
+	for (int i = 0; i < maxTiles; ++i)
+	{
+		auto tile = mesh->getTile(i);
+		auto base = m_polys.getTileBase(i);
+		if (!tile->header || base < 0)
+			continue;
+		for (int ip = 0; ip < tile->header->polyCount; ++ip)
+		{
+			auto const &poly = tile->polys[ip];
+			if (poly.flags & GATE_FLAGS)
+				continue;
+			for (auto k = poly.firstLink; k != DT_NULL_LINK; k = tile->links[k].next)
+			{
+				auto ref = tile->links[k].ref;
+				auto neighbour = m_polys.getPolyIndex(ref);
+				dtMeshTile const *neighbourTile;
+				dtPoly const *neighbourPoly;
+				if (neighbour < 0)
+					continue;
+				mesh->getTileAndPolyByRefUnsafe(ref, &neighbourTile, &neighbourPoly);
+				if (neighbourPoly->flags == poly.flags)
+					Union(parents, base + ip, neighbour);
+			}
+		}
+	}
+
+	std::vector<int> componentOfRoot(polyCount, -1);
+	m_polyComponent.resize(polyCount);
+	m_componentFlags.clear();
+	m_componentSingle.clear();
+	for (int i = 0; i < maxTiles; ++i)
+	{
+		auto tile = mesh->getTile(i);
+		auto base = m_polys.getTileBase(i);
+		if (!tile->header || base < 0)
+			continue;
+		for (int ip = 0; ip < tile->header->polyCount; ++ip)
+		{
+			auto root = FindRoot(parents, base + ip);
+			if (componentOfRoot[root] < 0)
+			{
+				componentOfRoot[root] = (int)m_componentFlags.size();
+				m_componentFlags.push_back(tile->polys[ip].flags);
+				m_componentSingle.push_back(1);
+			}
+			else
+				m_componentSingle[componentOfRoot[root]] = 0;
+			m_polyComponent[base + ip] = (unsigned int)componentOfRoot[root];
+		}
+	}
+
+	// links crossing components form the component graph
+	m_componentLinks.clear();
+	for (int i = 0; i < maxTiles; ++i)
+	{
+		auto tile = mesh->getTile(i);
+		auto base = m_polys.getTileBase(i);
+		if (!tile->header || base < 0)
+			continue;
+		for (int ip = 0; ip < tile->header->polyCount; ++ip)
+		{
+			auto a = m_polyComponent[base + ip];
+			for (auto k = tile->polys[ip].firstLink; k != DT_NULL_LINK; k = tile->links[k].next)
+			{
+				auto neighbour = m_polys.getPolyIndex(tile->links[k].ref);
+				if (neighbour < 0)
+					continue;
+				auto b = m_polyComponent[neighbour];
+				if (a != b)
+					m_componentLinks.push_back(((unsigned long long)std::min(a, b) << 32) | std::max(a, b));
+			}
+		}
+	}
+	std::sort(m_componentLinks.begin(), m_componentLinks.end());
+	m_componentLinks.erase(std::unique(m_componentLinks.begin(), m_componentLinks.end()), m_componentLinks.end());
+
+	m_labels.clear();
+	++m_version;
+}
+
+void dtIslands::polyFlagsChanged(dtPolyRef ref, unsigned short flags)
+{
+	std::unique_lock<std::shared_mutex> lock(m_lock);
+	auto index = m_polys.getPolyIndex(ref);
+	if (index < 0)
+		return;
+	auto component = m_polyComponent[index];
+	if (m_componentSingle[component])
+	{
+		// door toggle: the component graph is unchanged, only the cached labels are outdated
+		m_componentFlags[component] = flags;
+		++m_version;
+	}
+	else
+		buildLocked();
+}
+
+void dtIslands::updateLabels(Labels &labels, unsigned short includeFlags, unsigned short excludeFlags) const
+{
+	labels.version = m_version;
+	labels.roots.resize(m_componentFlags.size());
+	std::iota(labels.roots.begin(), labels.roots.end(), 0);
+	for (auto link : m_componentLinks)
+	{
+		auto a = (unsigned int)(link >> 32);
+		auto b = (unsigned int)(link & 0xffffffff);
+		if (PassFlags(m_componentFlags[a], includeFlags, excludeFlags) && PassFlags(m_componentFlags[b], includeFlags, excludeFlags))
+			Union(labels.roots, a, b);
+	}
+	for (unsigned int i = 0; i < labels.roots.size(); ++i)
+		labels.roots[i] = FindRoot(labels.roots, i);
+}
+
+bool dtIslands::isReachable(dtPolyRef from, dtPolyRef to, dtQueryFilter const *filter)
+{
+	auto key = ((unsigned int)filter->getIncludeFlags() << 16) | filter->getExcludeFlags();
+	{
+		std::shared_lock<std::shared_mutex> lock(m_lock);
+		auto fromIndex = m_polys.getPolyIndex(from);
+		auto toIndex = m_polys.getPolyIndex(to);
+		if (fromIndex < 0 || toIndex < 0)
+			return true;
+		auto fromComponent = m_polyComponent[fromIndex];
+		auto toComponent = m_polyComponent[toIndex];
+		if (fromComponent == toComponent)
+			return true;
+		auto labels = m_labels.find(key);
+		if (labels != m_labels.end() && labels->second.version == m_version)
+			return labels->second.roots[fromComponent] == labels->second.roots[toComponent];
+	}
+
+	std::unique_lock<std::shared_mutex> lock(m_lock);
+	auto fromIndex = m_polys.getPolyIndex(from);
+	auto toIndex = m_polys.getPolyIndex(to);
+	if (fromIndex < 0 || toIndex < 0)
+		return true;
+	auto &labels = m_labels[key];
+	if (labels.version != m_version || labels.roots.size() != m_componentFlags.size())
+		updateLabels(labels, filter->getIncludeFlags(), filter->getExcludeFlags());
+	return labels.roots[m_polyComponent[fromIndex]] == labels.roots[m_polyComponent[toIndex]];
+}
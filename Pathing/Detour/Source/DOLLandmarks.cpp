@@ -0,0 +1,260 @@
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+
+#include "dol_landmarks.hpp"
+
+// portal graph of the whole mesh in compressed rows, edges weighted by the shortest midpoint distance
+struct LandmarkGraph
+{
+	std::vector<int> firstEdge;
+	std::vector<int> edgeTarget;
+	std::vector<float> edgeCost;
+};
+
+static void Flood(LandmarkGraph const &graph, int source, std::vector<float> &costs)
+{
+	typedef std::pair<float, int> Entry;
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+	std::fill(costs.begin(), costs.end(), FLT_MAX);
+	costs[source] = 0;
+	open.push(Entry(0.0f, source));
+	while (!open.empty())
+	{
+		auto best = open.top();
+		open.pop();
+		if (best.first > costs[best.second])
+			continue;
+		for (int e = graph.firstEdge[best.second]; e < graph.firstEdge[best.second + 1]; ++e)
+		{
+			auto cost = best.first + graph.edgeCost[e];
+			if (cost < costs[graph.edgeTarget[e]])
+			{
+				costs[graph.edgeTarget[e]] = cost;
+				open.push(Entry(cost, graph.edgeTarget[e]));
+			}
+		}
+	}
+}
+
+// shortest distance between the midpoints of two portals, whichever direction they are crossed
+static float MidPointDistance(float const *a, float const *b)
+{
+	auto distance = FLT_MAX;
+	for (int i = 0; i < 2; ++i)
+		for (int j = 0; j < 2; ++j)
+			distance = dtMin(distance, dtVdist(a + i * 3, b + j * 3));
+	return distance;
+}
+
+bool dtLandmarks::build(dtNavMesh const *mesh, int count)
+{
+	if (count <= 0 || count > MAX_LANDMARKS)
+		return false;
+	m_polys.build(mesh);
+	auto polyCount = m_polys.getPolyCount();
+	if (polyCount == 0)
+		return false;
+	dtNavMeshQuery query;
+	if (dtStatusFailed(query.init(mesh, 1)))
+		return false;
+
+	// one portal per pair of linked polys, its midpoint computed as the search does in both directions
+	std::unordered_map<std::uint64_t, int> portalIds;
+	std::vector<std::pair<int, int>> portalPolys;
+	std::vector<std::vector<int>> polyPortals(polyCount);
+	m_midPoints.clear();
+	for (int i = 0; i < mesh->getMaxTiles(); ++i)
+	{
+		auto tile = mesh->getTile(i);
+		auto base = m_polys.getTileBase(i);
+		if (!tile->header || base < 0)
+			continue;
+		auto baseRef = mesh->getPolyRefBase(tile);
+		for (int ip = 0; ip < tile->header->polyCount; ++ip)
+		{
+			auto from = base + ip;
+			for (auto k = tile->polys[ip].firstLink; k != DT_NULL_LINK; k = tile->links[k].next)
+			{
+				auto to = m_polys.getPolyIndex(tile->links[k].ref);
+				if (to < 0 || to == from)
+					continue;
+				float mid[3];
+				if (dtStatusFailed(query.getEdgeMidPoint(baseRef | (dtPolyRef)ip, tile->links[k].ref, mid)))
+					continue;
+				auto key = ((std::uint64_t)dtMin(from, to) << 32) | (std::uint64_t)dtMax(from, to);
+				auto found = portalIds.find(key);
+				if (found == portalIds.end())
+				{
+					auto portal = (int)portalPolys.size();
+					portalIds.emplace(key, portal);
+					portalPolys.push_back(std::make_pair(from, to));
+					polyPortals[from].push_back(portal);
+					polyPortals[to].push_back(portal);
+					m_midPoints.insert(m_midPoints.end(), {mid[0], mid[1], mid[2], mid[0], mid[1], mid[2]});
+				}
+				else if (portalPolys[found->second].first != from)
+					dtVcopy(&m_midPoints[(size_t)found->second * 6 + 3], mid);
+			}
+		}
+	}
+	auto portalCount = (int)portalPolys.size();
+	if (portalCount == 0)
+		return false;
+	m_polyFirstPortal.assign(polyCount + 1, 0);
+	m_polyPortals.clear();
+	for (int i = 0; i < polyCount; ++i)
+	{
+		m_polyFirstPortal[i] = (int)m_polyPortals.size();
+		m_polyPortals.insert(m_polyPortals.end(), polyPortals[i].begin(), polyPortals[i].end());
+	}
+	m_polyFirstPortal[polyCount] = (int)m_polyPortals.size();
+
+	// a search step goes from a portal of a poly to a portal of a neighbour poly
+	std::vector<std::vector<int>> portalNeighbours(portalCount);
+	for (auto const &polys : portalPolys)
+		for (auto a : polyPortals[polys.first])
+			for (auto b : polyPortals[polys.second])
+				if (a != b)
+				{
+					portalNeighbours[a].push_back(b);
+					portalNeighbours[b].push_back(a);
+				}
+	LandmarkGraph graph;
+	graph.firstEdge.assign(portalCount + 1, 0);
+	for (int a = 0; a < portalCount; ++a)
+	{
+		auto &neighbours = portalNeighbours[a];
+		std::sort(neighbours.begin(), neighbours.end());
+		neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+		graph.firstEdge[a] = (int)graph.edgeTarget.size();
+		for (auto b : neighbours)
+		{
+			graph.edgeTarget.push_back(b);
+			graph.edgeCost.push_back(MidPointDistance(&m_midPoints[(size_t)a * 6], &m_midPoints[(size_t)b * 6]));
+		}
+	}
+	graph.firstEdge[portalCount] = (int)graph.edgeTarget.size();
+
+	// farthest point selection, seeded from the middle of the largest flooded area
+	std::vector<float> costs(portalCount);
+	std::vector<float> nearestLandmark(portalCount, FLT_MAX);
+	std::vector<std::vector<float>> landmarkCosts;
+	int seed = 0;
+	int seedReached = 0;
+	for (int i = 0; i < portalCount && seedReached < portalCount / 2; i += dtMax(1, portalCount / 8))
+	{
+		Flood(graph, i, costs);
+		auto reached = (int)std::count_if(costs.begin(), costs.end(), [](float c) { return c != FLT_MAX; });
+		if (reached > seedReached)
+		{
+			seed = i;
+			seedReached = reached;
+		}
+	}
+	Flood(graph, seed, nearestLandmark);
+	while ((int)landmarkCosts.size() < count)
+	{
+		int farthest = -1;
+		for (int i = 0; i < portalCount; ++i)
+			if (nearestLandmark[i] != FLT_MAX && (farthest < 0 || nearestLandmark[i] > nearestLandmark[farthest]))
+				farthest = i;
+		if (farthest < 0 || (!landmarkCosts.empty() && nearestLandmark[farthest] == 0))
+			break;
+		Flood(graph, farthest, costs);
+		landmarkCosts.push_back(costs);
+		for (int i = 0; i < portalCount; ++i)
+			nearestLandmark[i] = dtMin(nearestLandmark[i], costs[i]);
+	}
+
+	float maxCost = 0;
+	for (auto const &landmark : landmarkCosts)
+		for (auto cost : landmark)
+			if (cost != FLT_MAX)
+				maxCost = dtMax(maxCost, cost);
+	m_count = (int)landmarkCosts.size();
+	m_quantum = dtMax(maxCost / (UNREACHED - 1), FLT_EPSILON);
+	m_distances.resize((size_t)portalCount * m_count);
+	for (int k = 0; k < m_count; ++k)
+		for (int i = 0; i < portalCount; ++i)
+		{
+			auto cost = landmarkCosts[k][i];
+			m_distances[(size_t)i * m_count + k] = cost == FLT_MAX ? UNREACHED : (unsigned short)(cost / m_quantum + 0.5f);
+		}
+
+	// the search node does not tell which portal of its poly it sits on: keep the range over them
+	m_polyRanges.assign((size_t)polyCount * m_count * 2, (unsigned short)UNREACHED);
+	for (int i = 0; i < polyCount; ++i)
+	{
+		auto ranges = &m_polyRanges[(size_t)i * m_count * 2];
+		for (int k = 0; k < m_count; ++k)
+			ranges[m_count + k] = 0;
+		for (int p = m_polyFirstPortal[i]; p < m_polyFirstPortal[i + 1]; ++p)
+		{
+			auto distances = getDistances(m_polyPortals[p]);
+			for (int k = 0; k < m_count; ++k)
+			{
+				if (distances[k] == UNREACHED)
+					continue;
+				ranges[k] = dtMin(ranges[k], distances[k]);
+				ranges[m_count + k] = dtMax(ranges[m_count + k], distances[k]);
+			}
+		}
+	}
+	return m_count > 0;
+}
+
+size_t dtLandmarks::getMemory() const
+{
+	return (m_polyFirstPortal.size() + m_polyPortals.size()) * sizeof(int) + m_midPoints.size() * sizeof(float) +
+		(m_distances.size() + m_polyRanges.size()) * sizeof(unsigned short);
+}
+
+dtLandmarkHeuristic::dtLandmarkHeuristic(dtLandmarks const *landmarks, dtPolyRef endRef, float const *endPos)
+	: m_landmarks(landmarks), m_valid(false)
+{
+	dtVcopy(m_endPos, endPos);
+	auto endIndex = landmarks->getPolys().getPolyIndex(endRef);
+	if (endIndex < 0)
+		return;
+	// the search reaches the end position from the midpoint of one of the portals of the end poly
+	std::fill(m_endCosts, m_endCosts + landmarks->getCount(), FLT_MAX);
+	int portalCount;
+	auto portals = landmarks->getPolyPortals(endIndex, &portalCount);
+	for (int i = 0; i < portalCount; ++i)
+	{
+		auto distances = landmarks->getDistances(portals[i]);
+		auto midPoints = landmarks->getMidPoints(portals[i]);
+		auto lastStep = dtMin(dtVdist(midPoints, endPos), dtVdist(midPoints + 3, endPos));
+		for (int k = 0; k < landmarks->getCount(); ++k)
+			if (distances[k] != dtLandmarks::UNREACHED)
+				m_endCosts[k] = dtMin(m_endCosts[k], distances[k] * landmarks->getQuantum() + lastStep);
+	}
+	m_valid = true;
+}
+
+float dtLandmarkHeuristic::getCost(dtPolyRef ref, const float *pos) const
+{
+	auto distance = dtVdist(pos, m_endPos);
+	if (!m_valid)
+		return distance;
+	auto index = m_landmarks->getPolys().getPolyIndex(ref);
+	if (index < 0)
+		return distance;
+
+	auto count = m_landmarks->getCount();
+	auto ranges = m_landmarks->getPolyRanges(index);
+	auto quantum = m_landmarks->getQuantum();
+	float bound = 0;
+	for (int k = 0; k < count; ++k)
+	{
+		if (ranges[k] == dtLandmarks::UNREACHED || m_endCosts[k] == FLT_MAX)
+			continue;
+		bound = dtMax(bound, dtMax(m_endCosts[k] - ranges[count + k] * quantum, ranges[k] * quantum - m_endCosts[k]));
+	}
+	// each quantized distance is off by half a step at most
+	return dtMax(distance, bound - quantum);
+}
@@ -0,0 +1,112 @@
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+#ifdef __linux__
+#	include <sys/mman.h>
+#endif
+
+#include "dol_navmesh.hpp"
+
+static const size_t ARENA_ALIGN = 16;
+static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+dtNavMeshArena *dtNavMeshArena::create(size_t size, int hugePages)
+{
+	std::unique_ptr<dtNavMeshArena> arena(new dtNavMeshArena());
+#ifdef __linux__
+	if (hugePages)
+	{
+		// whole huge pages, so the tail of the arena is not backed by small pages
+		size = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+		void *data = MAP_FAILED;
+#	ifdef MAP_HUGETLB
+		if (hugePages == 2)
+			data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#	endif
+		if (data != MAP_FAILED)
+			arena->m_hugePages = true;
+		else
+		{
+			// transparent huge pages need a huge page aligned range: over allocate then trim
+			auto raw = mmap(nullptr, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (raw == MAP_FAILED)
+				return nullptr;
+			auto address = (size_t)raw;
+			auto aligned = (address + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+			if (aligned > address)
+				munmap(raw, aligned - address);
+			if (aligned + size < address + size + HUGE_PAGE_SIZE)
+				munmap((void *)(aligned + size), address + size + HUGE_PAGE_SIZE - aligned - size);
+			data = (void *)aligned;
+#	ifdef MADV_HUGEPAGE
+			arena->m_hugePages = madvise(data, size, MADV_HUGEPAGE) == 0;
+#	endif
+		}
+		arena->m_data = (unsigned char *)data;
+		arena->m_size = size;
+		arena->m_mapped = true;
+		return arena.release();
+	}
+#else
+	(void)hugePages;
+#endif
+	arena->m_data = (unsigned char *)std::calloc(1, size);
+	if (!arena->m_data)
+		return nullptr;
+	arena->m_size = size;
+	return arena.release();
+}
+
+dtNavMeshArena::~dtNavMeshArena()
+{
+#ifdef __linux__
+	if (m_mapped)
+	{
+		munmap(m_data, m_size);
+		return;
+	}
+#endif
+	std::free(m_data);
+}
+
+void *dtNavMeshArena::allocate(size_t size)
+{
+	auto offset = (m_used + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+	if (offset + size > m_size)
+		return nullptr;
+	m_used = offset + size;
+	return m_data + offset;
+}
+
+static std::shared_mutex registryLock;
+static std::unordered_map<dtNavMesh const *, std::unique_ptr<dtNavMeshInfo>> registry;
+
+dtNavMeshInfo *RegisterNavMesh(dtNavMesh const *mesh)
+{
+	std::unique_lock<std::shared_mutex> lock(registryLock);
+	auto &info = registry[mesh];
+	info.reset(new dtNavMeshInfo());
+	return info.get();
+}
+
+std::unique_ptr<dtNavMeshInfo> UnregisterNavMesh(dtNavMesh const *mesh)
+{
+	std::unique_lock<std::shared_mutex> lock(registryLock);
+	auto it = registry.find(mesh);
+	if (it == registry.end())
+		return nullptr;
+	auto info = std::move(it->second);
+	registry.erase(it);
+	return info;
+}
+
+dtNavMeshInfo *GetNavMeshInfo(dtNavMesh const *mesh)
+{
+	std::shared_lock<std::shared_mutex> lock(registryLock);
+	auto it = registry.find(mesh);
+	return it != registry.end() ? it->second.get() : nullptr;
+}
@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "dol_navmesh.hpp"
+#include "dol_trace.hpp"
+
+// thread buffers are handed to the writer once they reach this size
+static const std::size_t TRACE_FLUSH_SIZE = 64 * 1024;
+
+std::atomic<bool> traceEnabled;
+
+// guards everything below and the mesh trace ids
+static std::mutex traceLock;
+static std::FILE *traceFile;
+static std::thread traceWriter;
+static std::condition_variable traceWake;
+static std::deque<std::vector<unsigned char>> traceQueue;
+static bool traceStopping;
+static std::atomic<unsigned int> traceGeneration;
+static std::atomic<std::uint64_t> traceSequence;
+static std::uint16_t traceNextMeshId;
+
+// Records of one thread. The lock is only contended while StartTrace/StopTrace drain the buffers.
+struct TraceBuffer;
+static std::vector<TraceBuffer *> traceBuffers;
+static std::atomic<unsigned int> traceNextThread;
+
+struct TraceBuffer
+{
+	std::mutex lock;
+	std::vector<unsigned char> data;
+	std::uint8_t thread;
+
+	TraceBuffer() : thread((std::uint8_t)traceNextThread.fetch_add(1))
+	{
+		std::lock_guard<std::mutex> guard(traceLock);
+		traceBuffers.push_back(this);
+	}
+
+	~TraceBuffer()
+	{
+		std::lock_guard<std::mutex> guard(traceLock);
+		if (traceFile && !traceStopping && !data.empty())
+		{
+			traceQueue.push_back(std::move(data));
+			traceWake.notify_one();
+		}
+		traceBuffers.erase(std::find(traceBuffers.begin(), traceBuffers.end(), this));
+	}
+};
+
+static thread_local TraceBuffer traceBuffer;
+
+static void Append(std::vector<unsigned char> &data, dtTraceRecordHeader const &header, void const *payload)
+{
+	auto bytes = (unsigned char const *)&header;
+	data.insert(data.end(), bytes, bytes + sizeof(header));
+	data.insert(data.end(), (unsigned char const *)payload, (unsigned char const *)payload + header.size);
+}
+
+static void WriteTrace()
+{
+	std::unique_lock<std::mutex> lock(traceLock);
+	for (;;)
+	{
+		traceWake.wait(lock, []
+					   { return traceStopping || !traceQueue.empty(); });
+		while (!traceQueue.empty())
+		{
+			auto data = std::move(traceQueue.front());
+			traceQueue.pop_front();
+			lock.unlock();
+			std::fwrite(data.data(), 1, data.size(), traceFile);
+			lock.lock();
+		}
+		if (traceStopping)
+			return;
+	}
+}
+
+std::uint16_t dtTraceMeshId(dtNavMesh const *mesh)
+{
+	auto info = GetNavMeshInfo(mesh);
+	if (!info)
+		return 0;
+	auto generation = traceGeneration.load();
+	if (info->traceGeneration.load(std::memory_order_acquire) == generation)
+		return info->traceId;
+
+	std::lock_guard<std::mutex> guard(traceLock);
+	if (info->traceGeneration.load(std::memory_order_relaxed) != generation && traceFile)
+	{
+		info->traceId = traceNextMeshId++;
+		// queued before any record using the id can be flushed
+		dtTraceRecordHeader header = {DT_TRACE_MESH, 0, info->traceId, (std::uint32_t)info->file.size(), 0, 0, traceSequence.fetch_add(1)};
+		std::vector<unsigned char> data;
+		Append(data, header, info->file.data());
+		traceQueue.push_back(std::move(data));
+		traceWake.notify_one();
+		info->traceGeneration.store(generation, std::memory_order_release);
+	}
+	return info->traceId;
+}
+
+void dtTraceRecord::commit(std::uint32_t status)
+{
+	if (m_overflow || !dtTraceEnabled())
+		return;
+	m_header.size = (std::uint32_t)m_size;
+	m_header.status = status;
+	m_header.thread = traceBuffer.thread;
+	m_header.sequence = traceSequence.fetch_add(1);
+
+	std::vector<unsigned char> full;
+	{
+		std::lock_guard<std::mutex> guard(traceBuffer.lock);
+		Append(traceBuffer.data, m_header, m_payload);
+		if (traceBuffer.data.size() < TRACE_FLUSH_SIZE)
+			return;
+		full.swap(traceBuffer.data);
+		traceBuffer.data.reserve(TRACE_FLUSH_SIZE + sizeof(m_header) + sizeof(m_payload));
+	}
+	std::lock_guard<std::mutex> guard(traceLock);
+	// StopTrace may have drained the queue already, the buffer would land in the next trace
+	if (traceFile && !traceStopping)
+	{
+		traceQueue.push_back(std::move(full));
+		traceWake.notify_one();
+	}
+}
+
+DLLEXPORT bool StartTrace(char const *file)
+{
+	std::lock_guard<std::mutex> guard(traceLock);
+	if (traceFile)
+		return false;
+	traceFile = std::fopen(file, "wb");
+	if (!traceFile)
+		return false;
+	dtTraceFileHeader header = {DT_TRACE_MAGIC, DT_TRACE_VERSION, (std::uint32_t)sizeof(dtPolyRef)};
+	std::fwrite(&header, sizeof(header), 1, traceFile);
+
+	// leftovers of calls that finished after the previous StopTrace
+	for (auto buffer : traceBuffers)
+	{
+		std::lock_guard<std::mutex> bufferGuard(buffer->lock);
+		buffer->data.clear();
+	}
+	traceQueue.clear();
+	traceSequence.store(0);
+	++traceGeneration;
+	traceNextMeshId = 1;
+	traceStopping = false;
+	traceWriter = std::thread(WriteTrace);
+	traceEnabled.store(true);
+	return true;
+}
+
+DLLEXPORT bool StopTrace()
+{
+	{
+		std::lock_guard<std::mutex> guard(traceLock);
+		if (!traceFile)
+			return false;
+		traceEnabled.store(false);
+		for (auto buffer : traceBuffers)
+		{
+			std::lock_guard<std::mutex> bufferGuard(buffer->lock);
+			if (!buffer->data.empty())
+				traceQueue.push_back(std::move(buffer->data));
+			buffer->data.clear();
+		}
+		traceStopping = true;
+		traceWake.notify_one();
+	}
+	traceWriter.join();
+	std::lock_guard<std::mutex> guard(traceLock);
+	std::fclose(traceFile);
+	traceFile = nullptr;
+	return true;
+}
@@ -0,0 +1,54 @@
+#include <cfloat>
+#include <vector>
+
+#include "DetourNavMeshQuery.h"
+#include "dol_internal.hpp"
+#include "dol_islands.hpp"
+
+// Target selection: the travel cost from one NPC to each candidate (aggro, assist, nearest
+// guard / healer / merchant) with a single Dijkstra search instead of one PathStraight per candidate.
+DLLEXPORT dtStatus GetTravelCosts(dtNavMeshQuery *query, float start[], int count, float targets[], float maxCost, float polyPickExt[], dtPolyFlags queryFilter[], dtStraightPathOptions pathOptions, float *costs, int *best, int *pointCount, float *pointBuffer, dtPolyFlags *pointFlags)
+{
+	*best = -1;
+	if (pointCount)
+		*pointCount = 0;
+	if (count < 0 || (count && (!targets || !costs)))
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	dtQueryFilter filter;
+	filter.setIncludeFlags(queryFilter[0]);
+	filter.setExcludeFlags(queryFilter[1]);
+	dtPolyRef startRef;
+	auto status = query->findNearestPoly(start, polyPickExt, &filter, &startRef, nullptr);
+	if (dtStatusFailed(status))
+		return status;
+
+	// targets off the mesh or on another island are not waited for, the search would flood up to maxCost
+	auto islands = GetQueryIslands(query);
+	std::vector<dtPolyRef> targetRefs(count);
+	std::vector<float> targetPos(count * 3);
+	for (int i = 0; i < count; ++i)
+	{
+		if (dtStatusFailed(query->findNearestPoly(&targets[i * 3], polyPickExt, &filter, &targetRefs[i], &targetPos[i * 3])))
+			targetRefs[i] = 0;
+		else if (targetRefs[i] && islands && !islands->isReachable(startRef, targetRefs[i], &filter))
+			targetRefs[i] = 0;
+	}
+
+	status = query->findTravelCosts(startRef, start, targetRefs.data(), targetPos.data(), count, maxCost > 0 ? maxCost : FLT_MAX, &filter, costs);
+	if (dtStatusFailed(status))
+		return status;
+	for (int i = 0; i < count; ++i)
+		if (costs[i] != FLT_MAX && (*best < 0 || costs[i] < costs[*best]))
+			*best = i;
+	if (*best < 0 || !pointCount || !pointBuffer || !pointFlags)
+		return status;
+
+	// the search tree still holds the corridor to the best target
+	int npolys = 0;
+	dtPolyRef polys[MAX_POLY];
+	auto pathStatus = query->getPathFromDijkstraSearch(targetRefs[*best], polys, &npolys, MAX_POLY);
+	if (dtStatusSucceed(pathStatus))
+		pathStatus = StraightPathFromCorridor(query, polys, npolys, targetRefs[*best], start, &targetPos[*best * 3], &filter, pathOptions, DT_PATH_DEFAULT, pointCount, pointBuffer, pointFlags);
+	return dtStatusFailed(pathStatus) ? pathStatus : status;
+}
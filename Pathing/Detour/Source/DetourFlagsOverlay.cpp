@@ -0,0 +1,71 @@
+#include <new>
+
+#include "DetourFlagsOverlay.h"
+#include "DetourAlloc.h"
+
+dtPolyFlagsOverlay::dtPolyFlagsOverlay() :
+	m_nav(0),
+	m_maxTiles(0),
+	m_tiles(0),
+	m_copiedTiles(0)
+{
+}
+
+dtPolyFlagsOverlay::~dtPolyFlagsOverlay()
+{
+	for (int i = 0; i < m_maxTiles; ++i)
+		dtFree(m_tiles[i].load());
+	delete[] m_tiles;
+}
+
+dtStatus dtPolyFlagsOverlay::init(const dtNavMesh* nav)
+{
+	if (!nav || m_nav)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	m_maxTiles = nav->getMaxTiles();
+	m_tiles = new (std::nothrow) std::atomic<unsigned short*>[m_maxTiles];
+	if (!m_tiles)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	for (int i = 0; i < m_maxTiles; ++i)
+		m_tiles[i].store(0, std::memory_order_relaxed);
+	m_nav = nav;
+	return DT_SUCCESS;
+}
+
+dtStatus dtPolyFlagsOverlay::setPolyFlags(dtPolyRef ref, unsigned short flags)
+{
+	const dtMeshTile* tile = 0;
+	const dtPoly* poly = 0;
+	if (!m_nav || dtStatusFailed(m_nav->getTileAndPolyByRef(ref, &tile, &poly)))
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	const unsigned int it = m_nav->decodePolyIdTile(ref);
+	const unsigned int ip = m_nav->decodePolyIdPoly(ref);
+	std::lock_guard<std::mutex> lock(m_writeLock);
+	unsigned short* tileFlags = m_tiles[it].load(std::memory_order_relaxed);
+	if (!tileFlags)
+	{
+		// Copy on write: the tile starts with the current flags of the shared mesh.
+		tileFlags = (unsigned short*)dtAlloc(sizeof(unsigned short) * tile->header->polyCount, DT_ALLOC_PERM);
+		if (!tileFlags)
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+		for (int i = 0; i < tile->header->polyCount; ++i)
+			tileFlags[i] = tile->polys[i].flags;
+		tileFlags[ip] = flags;
+		m_tiles[it].store(tileFlags, std::memory_order_release);
+		m_copiedTiles.fetch_add(1, std::memory_order_relaxed);
+		return DT_SUCCESS;
+	}
+	tileFlags[ip] = flags;
+	return DT_SUCCESS;
+}
+
+dtStatus dtPolyFlagsOverlay::getPolyFlags(dtPolyRef ref, unsigned short* resultFlags) const
+{
+	const dtMeshTile* tile = 0;
+	const dtPoly* poly = 0;
+	if (!m_nav || dtStatusFailed(m_nav->getTileAndPolyByRef(ref, &tile, &poly)))
+		return DT_FAILURE | DT_INVALID_PARAM;
+	*resultFlags = getFlags(ref, poly);
+	return DT_SUCCESS;
+}
@@ -119,6 +119,10 @@ inline int computeTileHash(int x, int y, const int mask)
 	return (int)(n & mask);
 }
 
+// The tile lookup is a dense grid over the tile locations while it has at most this many cells per
+// tile, and falls back to the hash for sparse meshes.
+static const int DT_TILE_GRID_MAX_CELLS_PER_TILE = 4;
+
 inline unsigned int allocLink(dtMeshTile* tile)
 {
 	if (tile->linksFreeList == DT_NULL_LINK)
@@ -191,6 +195,11 @@ dtNavMesh::dtNavMesh() :
 	m_maxTiles(0),
 	m_tileLutSize(0),
 	m_tileLutMask(0),
+	m_tileLutDense(true),
+	m_tileLutMinX(0),
+	m_tileLutMinY(0),
+	m_tileLutWidth(0),
+	m_tileLutHeight(0),
 	m_posLookup(0),
 	m_nextFree(0),
 	m_tiles(0)
@@ -230,18 +239,18 @@ dtStatus dtNavMesh::init(const dtNavMeshParams* params)
 	
 	// Init tiles
 	m_maxTiles = params->maxTiles;
-	m_tileLutSize = dtNextPow2(params->maxTiles/4);
-	if (!m_tileLutSize) m_tileLutSize = 1;
-	m_tileLutMask = m_tileLutSize-1;
 	
 	m_tiles = (dtMeshTile*)dtAlloc(sizeof(dtMeshTile)*m_maxTiles, DT_ALLOC_PERM);
 	if (!m_tiles)
 		return DT_FAILURE | DT_OUT_OF_MEMORY;
-	m_posLookup = (dtMeshTile**)dtAlloc(sizeof(dtMeshTile*)*m_tileLutSize, DT_ALLOC_PERM);
-	if (!m_posLookup)
-		return DT_FAILURE | DT_OUT_OF_MEMORY;
 	memset(m_tiles, 0, sizeof(dtMeshTile)*m_maxTiles);
-	memset(m_posLookup, 0, sizeof(dtMeshTile*)*m_tileLutSize);
+	
+	// The dense tile grid starts empty and grows to the locations of the tiles as they are added.
+	m_tileLutDense = true;
+	m_tileLutWidth = 0;
+	m_tileLutHeight = 0;
+	m_tileLutSize = 0;
+	m_tileLutMask = 0;
 	m_nextFree = 0;
 	for (int i = m_maxTiles-1; i >= 0; --i)
 	{
@@ -925,6 +934,28 @@ dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags,
 	// Make sure the location is free.
 	if (getTileAt(header->x, header->y, header->layer))
 		return DT_FAILURE | DT_ALREADY_OCCUPIED;
+	
+	// Grow the dense tile grid to the location, or fall back to the hash if the grid would be mostly empty.
+	if (m_tileLutDense && getTileLutIndex(header->x, header->y) < 0)
+	{
+		int minX = header->x, minY = header->y;
+		int maxX = header->x, maxY = header->y;
+		if (m_tileLutWidth > 0)
+		{
+			minX = dtMin(minX, m_tileLutMinX);
+			minY = dtMin(minY, m_tileLutMinY);
+			maxX = dtMax(maxX, m_tileLutMinX + m_tileLutWidth - 1);
+			maxY = dtMax(maxY, m_tileLutMinY + m_tileLutHeight - 1);
+		}
+		const long long cells = (long long)(maxX - minX + 1) * (maxY - minY + 1);
+		dtStatus status;
+		if (cells <= (long long)m_maxTiles * DT_TILE_GRID_MAX_CELLS_PER_TILE)
+			status = resizeTileLut(true, minX, minY, maxX - minX + 1, maxY - minY + 1);
+		else
+			status = resizeTileLut(false, 0, 0, 0, 0);
+		if (dtStatusFailed(status))
+			return status;
+	}
 		
 	// Allocate a tile.
 	dtMeshTile* tile = 0;
@@ -970,7 +1001,7 @@ dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags,
 		return DT_FAILURE | DT_OUT_OF_MEMORY;
 	
 	// Insert tile into the position lut.
-	int h = computeTileHash(header->x, header->y, m_tileLutMask);
+	int h = getTileLutIndex(header->x, header->y);
 	tile->next = m_posLookup[h];
 	m_posLookup[h] = tile;
 	
@@ -1054,10 +1085,77 @@ dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags,
 	return DT_SUCCESS;
 }
 
+int dtNavMesh::getTileLutIndex(const int x, const int y) const
+{
+	if (!m_tileLutDense)
+		return computeTileHash(x, y, m_tileLutMask);
+	const int gx = x - m_tileLutMinX;
+	const int gy = y - m_tileLutMinY;
+	if ((unsigned int)gx >= (unsigned int)m_tileLutWidth || (unsigned int)gy >= (unsigned int)m_tileLutHeight)
+		return -1;
+	return gx + gy * m_tileLutWidth;
+}
+
+/// @par
+///
+/// The dense grid must contain the locations of all tiles already added. The tiles at a
+/// location keep their order.
+dtStatus dtNavMesh::resizeTileLut(const bool dense, const int minX, const int minY, const int width, const int height)
+{
+	int size = width * height;
+	if (!dense)
+	{
+		size = dtNextPow2(m_maxTiles/4);
+		if (!size) size = 1;
+	}
+	dtMeshTile** lookup = (dtMeshTile**)dtAlloc(sizeof(dtMeshTile*)*size, DT_ALLOC_PERM);
+	if (!lookup)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(lookup, 0, sizeof(dtMeshTile*)*size);
+	
+	dtMeshTile** oldLookup = m_posLookup;
+	const int oldSize = m_tileLutSize;
+	m_posLookup = lookup;
+	m_tileLutSize = size;
+	m_tileLutMask = dense ? 0 : size-1;
+	m_tileLutDense = dense;
+	m_tileLutMinX = minX;
+	m_tileLutMinY = minY;
+	m_tileLutWidth = width;
+	m_tileLutHeight = height;
+	
+	for (int i = 0; i < oldSize; ++i)
+	{
+		// Reverse the chain, pushing the tiles to the front of their new chain restores the order.
+		dtMeshTile* reversed = 0;
+		dtMeshTile* tile = oldLookup[i];
+		while (tile)
+		{
+			dtMeshTile* next = tile->next;
+			tile->next = reversed;
+			reversed = tile;
+			tile = next;
+		}
+		while (reversed)
+		{
+			dtMeshTile* next = reversed->next;
+			const int h = getTileLutIndex(reversed->header->x, reversed->header->y);
+			reversed->next = m_posLookup[h];
+			m_posLookup[h] = reversed;
+			reversed = next;
+		}
+	}
+	dtFree(oldLookup);
+	
+	return DT_SUCCESS;
+}
+
 const dtMeshTile* dtNavMesh::getTileAt(const int x, const int y, const int layer) const
 {
-	// Find tile based on hash.
-	int h = computeTileHash(x,y,m_tileLutMask);
+	// Find tile based on the position lut.
+	int h = getTileLutIndex(x,y);
+	if (h < 0)
+		return 0;
 	dtMeshTile* tile = m_posLookup[h];
 	while (tile)
 	{
@@ -1095,8 +1193,10 @@ int dtNavMesh::getTilesAt(const int x, const int y, dtMeshTile** tiles, const in
 {
 	int n = 0;
 	
-	// Find tile based on hash.
-	int h = computeTileHash(x,y,m_tileLutMask);
+	// Find tile based on the position lut.
+	int h = getTileLutIndex(x,y);
+	if (h < 0)
+		return 0;
 	dtMeshTile* tile = m_posLookup[h];
 	while (tile)
 	{
@@ -1121,8 +1221,10 @@ int dtNavMesh::getTilesAt(const int x, const int y, dtMeshTile const** tiles, co
 {
 	int n = 0;
 	
-	// Find tile based on hash.
-	int h = computeTileHash(x,y,m_tileLutMask);
+	// Find tile based on the position lut.
+	int h = getTileLutIndex(x,y);
+	if (h < 0)
+		return 0;
 	dtMeshTile* tile = m_posLookup[h];
 	while (tile)
 	{
@@ -1142,8 +1244,10 @@ int dtNavMesh::getTilesAt(const int x, const int y, dtMeshTile const** tiles, co
 
 dtTileRef dtNavMesh::getTileRefAt(const int x, const int y, const int layer) const
 {
-	// Find tile based on hash.
-	int h = computeTileHash(x,y,m_tileLutMask);
+	// Find tile based on the position lut.
+	int h = getTileLutIndex(x,y);
+	if (h < 0)
+		return 0;
 	dtMeshTile* tile = m_posLookup[h];
 	while (tile)
 	{
@@ -1249,10 +1353,10 @@ dtStatus dtNavMesh::removeTile(dtTileRef ref, unsigned char** data, int* dataSiz
 	if (tile->salt != tileSalt)
 		return DT_FAILURE | DT_INVALID_PARAM;
 	
-	// Remove tile from hash lookup.
-	int h = computeTileHash(tile->header->x,tile->header->y,m_tileLutMask);
+	// Remove tile from the position lut.
+	int h = getTileLutIndex(tile->header->x,tile->header->y);
 	dtMeshTile* prev = 0;
-	dtMeshTile* cur = m_posLookup[h];
+	dtMeshTile* cur = h >= 0 ? m_posLookup[h] : 0;
 	while (cur)
 	{
 		if (cur == tile)
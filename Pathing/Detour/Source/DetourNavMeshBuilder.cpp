@@ -240,6 +240,37 @@ static int createBVTree(dtNavMeshCreateParams* params, dtBVNode* nodes, int /*nn
 	return curNode;
 }
 
+/// @par
+///
+/// Used to rebuild the tree of existing tile data, for example after the polygons were reordered.
+/// The tree is the one dtCreateNavMeshData builds from the same bounds.
+int dtCreateBVTree(const unsigned short* polyBounds, const int polyCount, dtBVNode* nodes)
+{
+	if (polyCount <= 0)
+		return 0;
+	BVItem* items = (BVItem*)dtAlloc(sizeof(BVItem)*polyCount, DT_ALLOC_TEMP);
+	if (!items)
+		return 0;
+	for (int i = 0; i < polyCount; i++)
+	{
+		BVItem& it = items[i];
+		it.i = i;
+		it.bmin[0] = polyBounds[i*6+0];
+		it.bmin[1] = polyBounds[i*6+1];
+		it.bmin[2] = polyBounds[i*6+2];
+		it.bmax[0] = polyBounds[i*6+3];
+		it.bmax[1] = polyBounds[i*6+4];
+		it.bmax[2] = polyBounds[i*6+5];
+	}
+	
+	int curNode = 0;
+	subdivide(items, polyCount, 0, polyCount, curNode, nodes);
+	
+	dtFree(items);
+	
+	return curNode;
+}
+
 static unsigned char classifyOffMeshPoint(const float* pt, const float* bmin, const float* bmax)
 {
 	static const unsigned char XP = 1<<0;
@@ -100,6 +100,16 @@ inline float dtQueryFilter::getCost(const float* pa, const float* pb,
 }
 #endif	
 	
+bool dtQueryFilter::hasUnitAreaCosts() const
+{
+	for (int i = 0; i < DT_MAX_AREAS; ++i)
+	{
+		if (m_areaCost[i] != 1.0f)
+			return false;
+	}
+	return true;
+}
+
 static const float H_SCALE = 0.999f; // Search heuristic scale.
 
 
@@ -137,6 +147,11 @@ void dtFreeNavMeshQuery(dtNavMeshQuery* navmesh)
 
 dtNavMeshQuery::dtNavMeshQuery() :
 	m_nav(0),
+	m_flagsOverlay(0),
+	m_polyGrid(0),
+	m_searchGraph(0),
+	m_userData(0),
+	m_searchBudget(0),
 	m_tinyNodePool(0),
 	m_nodePool(0),
 	m_openList(0)
@@ -258,7 +273,7 @@ dtStatus dtNavMeshQuery::findRandomPoint(const dtQueryFilter* filter, float (*fr
 			continue;
 		// Must pass filter
 		const dtPolyRef ref = base | (dtPolyRef)i;
-		if (!filter->passFilter(ref, tile, p))
+		if (!passFilter(filter, ref, tile, p))
 			continue;
 
 		// Calc area of the polygon.
@@ -333,7 +348,7 @@ dtStatus dtNavMeshQuery::findRandomPointAroundCircle(dtPolyRef startRef, const f
 	const dtMeshTile* startTile = 0;
 	const dtPoly* startPoly = 0;
 	m_nav->getTileAndPolyByRefUnsafe(startRef, &startTile, &startPoly);
-	if (!filter->passFilter(startRef, startTile, startPoly))
+	if (!passFilter(filter, startRef, startTile, startPoly))
 		return DT_FAILURE | DT_INVALID_PARAM;
 	
 	m_nodePool->clear();
@@ -359,6 +374,13 @@ dtStatus dtNavMeshQuery::findRandomPointAroundCircle(dtPolyRef startRef, const f
 
 	while (!m_openList->empty())
 	{
+		// Out of budget, pick among the polygons visited so far.
+		if (m_searchBudget && !m_searchBudget->spend())
+		{
+			status |= DT_PARTIAL_RESULT;
+			break;
+		}
+		
 		dtNode* bestNode = m_openList->pop();
 		bestNode->flags &= ~DT_NODE_OPEN;
 		bestNode->flags |= DT_NODE_CLOSED;
@@ -417,7 +439,7 @@ dtStatus dtNavMeshQuery::findRandomPointAroundCircle(dtPolyRef startRef, const f
 			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);
 			
 			// Do not advance if the polygon is excluded by the filter.
-			if (!filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
+			if (!passFilter(filter, neighbourRef, neighbourTile, neighbourPoly))
 				continue;
 			
 			// Find edge and calc distance to the edge.
@@ -488,16 +510,26 @@ dtStatus dtNavMeshQuery::findRandomPointAroundCircle(dtPolyRef startRef, const f
 	float pt[3];
 	dtRandomPointInConvexPoly(verts, randomPoly->vertCount, areas, s, t, pt);
 	
+	// A point picked on an edge can miss the detail triangles by rounding,
+	// take the height of the closest point on the polygon instead.
 	float h = 0.0f;
-	dtStatus stat = getPolyHeight(randomPolyRef, pt, &h);
-	if (dtStatusFailed(status))
-		return stat;
-	pt[1] = h;
-	
+	if (dtStatusSucceed(getPolyHeight(randomPolyRef, pt, &h)))
+	{
+		pt[1] = h;
+	}
+	else
+	{
+		float closest[3];
+		dtStatus stat = closestPointOnPoly(randomPolyRef, pt, closest, 0);
+		if (dtStatusFailed(stat))
+			return stat;
+		dtVcopy(pt, closest);
+	}
+
 	dtVcopy(randomPt, pt);
 	*randomRef = randomPolyRef;
 	
-	return DT_SUCCESS;
+	return DT_SUCCESS | (status & DT_STATUS_DETAIL_MASK);
 }
 
 
@@ -640,13 +672,15 @@ public:
 
 	dtPolyRef nearestRef() const { return m_nearestRef; }
 	const float* nearestPoint() const { return m_nearestPoint; }
+	float nearestDistanceSqr() const { return m_nearestDistanceSqr; }
 	bool isOverPoly() const { return m_overPoly; }
 
 	void process(const dtMeshTile* tile, dtPoly** polys, dtPolyRef* refs, int count)
 	{
 		dtIgnoreUnused(polys);
 
-		for (int i = 0; i < count; ++i)
+		// Nothing replaces a polygon at distance zero.
+		for (int i = 0; i < count && m_nearestDistanceSqr > 0; ++i)
 		{
 			dtPolyRef ref = refs[i];
 			float closestPtPoly[3];
@@ -708,9 +742,22 @@ dtStatus dtNavMeshQuery::findNearestPoly(const float* center, const float* halfE
 	
 	dtFindNearestPolyQuery query(this, center);
 
-	dtStatus status = queryPolygons(center, halfExtents, filter, &query);
-	if (dtStatusFailed(status))
-		return status;
+	// A polygon at distance zero contains the center, it overlaps the grid cell under the center.
+	// The cells hold every such polygon in the order of the full search, so the first one found
+	// there is the answer of the full search.
+	if (m_polyGrid && center && dtVisfinite(center) && halfExtents && dtVisfinite(halfExtents) && filter)
+	{
+		queryPolygonsUnderPoint(center, halfExtents, filter, &query);
+		if (!query.nearestRef() || query.nearestDistanceSqr() > 0)
+			query = dtFindNearestPolyQuery(this, center);
+	}
+
+	if (!query.nearestRef())
+	{
+		dtStatus status = queryPolygons(center, halfExtents, filter, &query);
+		if (dtStatusFailed(status))
+			return status;
+	}
 
 	*nearestRef = query.nearestRef();
 	// Only override nearestPt if we actually found a poly so the nearest point
@@ -725,6 +772,41 @@ dtStatus dtNavMeshQuery::findNearestPoly(const float* center, const float* halfE
 	return DT_SUCCESS;
 }
 
+// Quantizes a box as the bounding volume tree of the tile, clamped to the tile bounds.
+static void quantizeBox(const dtMeshHeader* header, const float* qmin, const float* qmax,
+						unsigned short* bmin, unsigned short* bmax)
+{
+	const float* tbmin = header->bmin;
+	const float* tbmax = header->bmax;
+	const float qfac = header->bvQuantFactor;
+	// dtClamp query box to world box.
+	float minx = dtClamp(qmin[0], tbmin[0], tbmax[0]) - tbmin[0];
+	float miny = dtClamp(qmin[1], tbmin[1], tbmax[1]) - tbmin[1];
+	float minz = dtClamp(qmin[2], tbmin[2], tbmax[2]) - tbmin[2];
+	float maxx = dtClamp(qmax[0], tbmin[0], tbmax[0]) - tbmin[0];
+	float maxy = dtClamp(qmax[1], tbmin[1], tbmax[1]) - tbmin[1];
+	float maxz = dtClamp(qmax[2], tbmin[2], tbmax[2]) - tbmin[2];
+	// Quantize
+	bmin[0] = (unsigned short)(qfac * minx) & 0xfffe;
+	bmin[1] = (unsigned short)(qfac * miny) & 0xfffe;
+	bmin[2] = (unsigned short)(qfac * minz) & 0xfffe;
+	bmax[0] = (unsigned short)(qfac * maxx + 1) | 1;
+	bmax[1] = (unsigned short)(qfac * maxy + 1) | 1;
+	bmax[2] = (unsigned short)(qfac * maxz + 1) | 1;
+}
+
+// Quantizes a point as the bounds of the bounding volume leaves, clamped to the tile bounds.
+// Unlike a query box, the point is not rounded down to an even value: a polygon containing the
+// point has its leaf bounds around the truncated point, so the point falls in one of its cells.
+static void quantizePoint(const dtMeshHeader* header, const float* pos, unsigned short* point)
+{
+	const float* tbmin = header->bmin;
+	const float* tbmax = header->bmax;
+	const float qfac = header->bvQuantFactor;
+	for (int i = 0; i < 3; ++i)
+		point[i] = (unsigned short)(qfac * (dtClamp(pos[i], tbmin[i], tbmax[i]) - tbmin[i]));
+}
+
 void dtNavMeshQuery::queryPolygonsInTile(const dtMeshTile* tile, const float* qmin, const float* qmax,
 										 const dtQueryFilter* filter, dtPolyQuery* query) const
 {
@@ -738,26 +820,9 @@ void dtNavMeshQuery::queryPolygonsInTile(const dtMeshTile* tile, const float* qm
 	{
 		const dtBVNode* node = &tile->bvTree[0];
 		const dtBVNode* end = &tile->bvTree[tile->header->bvNodeCount];
-		const float* tbmin = tile->header->bmin;
-		const float* tbmax = tile->header->bmax;
-		const float qfac = tile->header->bvQuantFactor;
-
 		// Calculate quantized box
 		unsigned short bmin[3], bmax[3];
-		// dtClamp query box to world box.
-		float minx = dtClamp(qmin[0], tbmin[0], tbmax[0]) - tbmin[0];
-		float miny = dtClamp(qmin[1], tbmin[1], tbmax[1]) - tbmin[1];
-		float minz = dtClamp(qmin[2], tbmin[2], tbmax[2]) - tbmin[2];
-		float maxx = dtClamp(qmax[0], tbmin[0], tbmax[0]) - tbmin[0];
-		float maxy = dtClamp(qmax[1], tbmin[1], tbmax[1]) - tbmin[1];
-		float maxz = dtClamp(qmax[2], tbmin[2], tbmax[2]) - tbmin[2];
-		// Quantize
-		bmin[0] = (unsigned short)(qfac * minx) & 0xfffe;
-		bmin[1] = (unsigned short)(qfac * miny) & 0xfffe;
-		bmin[2] = (unsigned short)(qfac * minz) & 0xfffe;
-		bmax[0] = (unsigned short)(qfac * maxx + 1) | 1;
-		bmax[1] = (unsigned short)(qfac * maxy + 1) | 1;
-		bmax[2] = (unsigned short)(qfac * maxz + 1) | 1;
+		quantizeBox(tile->header, qmin, qmax, bmin, bmax);
 
 		// Traverse tree
 		const dtPolyRef base = m_nav->getPolyRefBase(tile);
@@ -769,7 +834,7 @@ void dtNavMeshQuery::queryPolygonsInTile(const dtMeshTile* tile, const float* qm
 			if (isLeafNode && overlap)
 			{
 				dtPolyRef ref = base | (dtPolyRef)node->i;
-				if (filter->passFilter(ref, tile, &tile->polys[node->i]))
+				if (passFilter(filter, ref, tile, &tile->polys[node->i]))
 				{
 					polyRefs[n] = ref;
 					polys[n] = &tile->polys[node->i];
@@ -807,7 +872,7 @@ void dtNavMeshQuery::queryPolygonsInTile(const dtMeshTile* tile, const float* qm
 				continue;
 			// Must pass filter
 			const dtPolyRef ref = base | (dtPolyRef)i;
-			if (!filter->passFilter(ref, tile, p))
+			if (!passFilter(filter, ref, tile, p))
 				continue;
 			// Calc polygon bounds.
 			const float* v = &tile->verts[p->verts[0]*3];
@@ -842,6 +907,73 @@ void dtNavMeshQuery::queryPolygonsInTile(const dtMeshTile* tile, const float* qm
 		query->process(tile, polys, polyRefs, n);
 }
 
+void dtNavMeshQuery::queryPolygonsUnderPoint(const float* center, const float* halfExtents,
+											 const dtQueryFilter* filter, dtPolyQuery* query) const
+{
+	dtAssert(m_nav);
+	dtAssert(m_polyGrid);
+	static const int batchSize = 32;
+	dtPolyRef polyRefs[batchSize];
+	dtPoly* polys[batchSize];
+
+	float bmin[3], bmax[3];
+	dtVsub(bmin, center, halfExtents);
+	dtVadd(bmax, center, halfExtents);
+
+	// Tiles under the center, with the ones sharing a border with it, in the order of queryPolygons.
+	static const float borderEps = 1e-3f;
+	const float pmin[3] = { center[0] - borderEps, center[1], center[2] - borderEps };
+	const float pmax[3] = { center[0] + borderEps, center[1], center[2] + borderEps };
+	int minx, miny, maxx, maxy;
+	m_nav->calcTileLoc(pmin, &minx, &miny);
+	m_nav->calcTileLoc(pmax, &maxx, &maxy);
+
+	static const int MAX_NEIS = 32;
+	const dtMeshTile* neis[MAX_NEIS];
+	for (int y = miny; y <= maxy; ++y)
+	{
+		for (int x = minx; x <= maxx; ++x)
+		{
+			const int nneis = m_nav->getTilesAt(x, y, neis, MAX_NEIS);
+			for (int j = 0; j < nneis; ++j)
+			{
+				const dtMeshTile* tile = neis[j];
+				unsigned short qmin[3], qmax[3], point[3];
+				quantizeBox(tile->header, bmin, bmax, qmin, qmax);
+				quantizePoint(tile->header, center, point);
+				int nodeCount = 0;
+				const unsigned short* nodes = tile->bvTree ? m_polyGrid->getCellNodes(tile, point, &nodeCount) : 0;
+				if (!nodes)
+				{
+					queryPolygonsInTile(tile, bmin, bmax, filter, query);
+					continue;
+				}
+
+				const dtPolyRef base = m_nav->getPolyRefBase(tile);
+				int n = 0;
+				for (int i = 0; i < nodeCount; ++i)
+				{
+					const dtBVNode* node = &tile->bvTree[nodes[i]];
+					if (!dtOverlapQuantBounds(qmin, qmax, node->bmin, node->bmax))
+						continue;
+					const dtPolyRef ref = base | (dtPolyRef)node->i;
+					if (!passFilter(filter, ref, tile, &tile->polys[node->i]))
+						continue;
+					polyRefs[n] = ref;
+					polys[n] = &tile->polys[node->i];
+					if (++n == batchSize)
+					{
+						query->process(tile, polys, polyRefs, n);
+						n = 0;
+					}
+				}
+				if (n > 0)
+					query->process(tile, polys, polyRefs, n);
+			}
+		}
+	}
+}
+
 class dtCollectPolysQuery : public dtPolyQuery
 {
 	dtPolyRef* m_polys;
@@ -963,6 +1095,15 @@ dtStatus dtNavMeshQuery::findPath(dtPolyRef startRef, dtPolyRef endRef,
 								  const float* startPos, const float* endPos,
 								  const dtQueryFilter* filter,
 								  dtPolyRef* path, int* pathCount, const int maxPath) const
+{
+	return findPath(startRef, endRef, startPos, endPos, filter, path, pathCount, maxPath, 0);
+}
+
+dtStatus dtNavMeshQuery::findPath(dtPolyRef startRef, dtPolyRef endRef,
+								  const float* startPos, const float* endPos,
+								  const dtQueryFilter* filter,
+								  dtPolyRef* path, int* pathCount, const int maxPath,
+								  const dtSearchHeuristic* searchHeuristic) const
 {
 	dtAssert(m_nav);
 	dtAssert(m_nodePool);
@@ -988,6 +1129,16 @@ dtStatus dtNavMeshQuery::findPath(dtPolyRef startRef, dtPolyRef endRef,
 		*pathCount = 1;
 		return DT_SUCCESS;
 	}
+
+#ifndef DT_VIRTUAL_QUERYFILTER
+	// The graph holds the flags of the navigation mesh, and the costs of the default filter.
+	if (m_searchGraph && !m_flagsOverlay)
+	{
+		if (filter->hasUnitAreaCosts())
+			return findPathGraph(startRef, endRef, startPos, endPos, dtGraphUnitCostFilter(filter), path, pathCount, maxPath, searchHeuristic);
+		return findPathGraph(startRef, endRef, startPos, endPos, dtGraphFilter(filter), path, pathCount, maxPath, searchHeuristic);
+	}
+#endif
 	
 	m_nodePool->clear();
 	m_openList->clear();
@@ -996,7 +1147,7 @@ dtStatus dtNavMeshQuery::findPath(dtPolyRef startRef, dtPolyRef endRef,
 	dtVcopy(startNode->pos, startPos);
 	startNode->pidx = 0;
 	startNode->cost = 0;
-	startNode->total = dtVdist(startPos, endPos) * H_SCALE;
+	startNode->total = (searchHeuristic ? searchHeuristic->getCost(startRef, startPos) : dtVdist(startPos, endPos)) * H_SCALE;
 	startNode->id = startRef;
 	startNode->flags = DT_NODE_OPEN;
 	m_openList->push(startNode);
@@ -1020,6 +1171,10 @@ dtStatus dtNavMeshQuery::findPath(dtPolyRef startRef, dtPolyRef endRef,
 			break;
 		}
 		
+		// Out of budget, return the path to the best node so far.
+		if (m_searchBudget && !m_searchBudget->spend())
+			break;
+		
 		// Get current poly and tile.
 		// The API input has been cheked already, skip checking internal data.
 		const dtPolyRef bestRef = bestNode->id;
@@ -1050,7 +1205,7 @@ dtStatus dtNavMeshQuery::findPath(dtPolyRef startRef, dtPolyRef endRef,
 			const dtPoly* neighbourPoly = 0;
 			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);			
 			
-			if (!filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
+			if (!passFilter(filter, neighbourRef, neighbourTile, neighbourPoly))
 				continue;
 
 			// deal explicitly with crossing tile boundaries
@@ -1102,7 +1257,153 @@ dtStatus dtNavMeshQuery::findPath(dtPolyRef startRef, dtPolyRef endRef,
 													  bestRef, bestTile, bestPoly,
 													  neighbourRef, neighbourTile, neighbourPoly);
 				cost = bestNode->cost + curCost;
-				heuristic = dtVdist(neighbourNode->pos, endPos)*H_SCALE;
+				heuristic = (searchHeuristic ? searchHeuristic->getCost(neighbourRef, neighbourNode->pos) : dtVdist(neighbourNode->pos, endPos))*H_SCALE;
+			}
+
+			const float total = cost + heuristic;
+			
+			// The node is already in open list and the new result is worse, skip.
+			if ((neighbourNode->flags & DT_NODE_OPEN) && total >= neighbourNode->total)
+				continue;
+			// The node is already visited and process, and the new result is worse, skip.
+			if ((neighbourNode->flags & DT_NODE_CLOSED) && total >= neighbourNode->total)
+				continue;
+			
+			// Add or update the node.
+			neighbourNode->pidx = m_nodePool->getNodeIdx(bestNode);
+			neighbourNode->id = neighbourRef;
+			neighbourNode->flags = (neighbourNode->flags & ~DT_NODE_CLOSED);
+			neighbourNode->cost = cost;
+			neighbourNode->total = total;
+			
+			if (neighbourNode->flags & DT_NODE_OPEN)
+			{
+				// Already in open, update node location.
+				m_openList->modify(neighbourNode);
+			}
+			else
+			{
+				// Put the node in open list.
+				neighbourNode->flags |= DT_NODE_OPEN;
+				m_openList->push(neighbourNode);
+			}
+			
+			// Update nearest node to target so far.
+			if (heuristic < lastBestNodeCost)
+			{
+				lastBestNodeCost = heuristic;
+				lastBestNode = neighbourNode;
+			}
+		}
+	}
+
+	dtStatus status = getPathToNode(lastBestNode, path, pathCount, maxPath);
+
+	if (lastBestNode->id != endRef)
+		status |= DT_PARTIAL_RESULT;
+
+	if (outOfNodes)
+		status |= DT_OUT_OF_NODES;
+	
+	return status;
+}
+
+/// @par
+///
+/// Same search as findPath, with the default filter applied to the graph flags and areas:
+/// neighbours come from the contiguous edges of the polygon and their position is the
+/// precomputed portal mid point, no tile data is read. The filter is a dtGraphFilter or
+/// a dtGraphUnitCostFilter, both inlined in the neighbour loop.
+template <class TFilter>
+dtStatus dtNavMeshQuery::findPathGraph(dtPolyRef startRef, dtPolyRef endRef,
+									   const float* startPos, const float* endPos,
+									   const TFilter& filter,
+									   dtPolyRef* path, int* pathCount, const int maxPath,
+									   const dtSearchHeuristic* searchHeuristic) const
+{
+	dtAssert(m_searchGraph);
+
+	m_nodePool->clear();
+	m_openList->clear();
+	
+	dtNode* startNode = m_nodePool->getNode(startRef);
+	dtVcopy(startNode->pos, startPos);
+	startNode->pidx = 0;
+	startNode->cost = 0;
+	startNode->total = (searchHeuristic ? searchHeuristic->getCost(startRef, startPos) : dtVdist(startPos, endPos)) * H_SCALE;
+	startNode->id = startRef;
+	startNode->flags = DT_NODE_OPEN;
+	m_openList->push(startNode);
+	
+	dtNode* lastBestNode = startNode;
+	float lastBestNodeCost = startNode->total;
+	
+	bool outOfNodes = false;
+	
+	while (!m_openList->empty())
+	{
+		// Remove node from open list and put it in closed list.
+		dtNode* bestNode = m_openList->pop();
+		bestNode->flags &= ~DT_NODE_OPEN;
+		bestNode->flags |= DT_NODE_CLOSED;
+		
+		// Reached the goal, stop searching.
+		if (bestNode->id == endRef)
+		{
+			lastBestNode = bestNode;
+			break;
+		}
+		
+		// Out of budget, return the path to the best node so far.
+		if (m_searchBudget && !m_searchBudget->spend())
+			break;
+		
+		const dtPolyRef bestRef = bestNode->id;
+		const float bestAreaCost = filter.getAreaCost(m_searchGraph, bestRef);
+		const dtPolyRef parentRef = bestNode->pidx ? m_nodePool->getNodeAtIdx(bestNode->pidx)->id : 0;
+		
+		int edgeCount = 0;
+		const dtSearchGraphEdge* edges = m_searchGraph->getEdges(bestRef, &edgeCount);
+		for (int i = 0; i < edgeCount; ++i)
+		{
+			const dtSearchGraphEdge& edge = edges[i];
+			const dtPolyRef neighbourRef = edge.ref;
+			
+			// Do not expand back to where we came from.
+			if (neighbourRef == parentRef)
+				continue;
+			
+			if (!filter.passFlags(m_searchGraph->getFlags(neighbourRef)))
+				continue;
+
+			dtNode* neighbourNode = m_nodePool->getNode(neighbourRef, edge.crossSide);
+			if (!neighbourNode)
+			{
+				outOfNodes = true;
+				continue;
+			}
+			
+			// If the node is visited the first time, calculate node position.
+			if (neighbourNode->flags == 0)
+				dtVcopy(neighbourNode->pos, edge.mid);
+
+			// Calculate cost and heuristic.
+			float cost = 0;
+			float heuristic = 0;
+			
+			// Special case for last node.
+			if (neighbourRef == endRef)
+			{
+				const float curCost = dtVdist(bestNode->pos, neighbourNode->pos) * bestAreaCost;
+				const float endCost = dtVdist(neighbourNode->pos, endPos) * filter.getAreaCost(m_searchGraph, neighbourRef);
+				cost = bestNode->cost + curCost + endCost;
+				heuristic = 0;
+			}
+			else
+			{
+				const float curCost = dtVdist(bestNode->pos, neighbourNode->pos) * bestAreaCost;
+				cost = bestNode->cost + curCost;
+				heuristic = (searchHeuristic ? searchHeuristic->getCost(neighbourRef, neighbourNode->pos) : dtVdist(neighbourNode->pos, endPos))*H_SCALE;
 			}
 
 			const float total = cost + heuristic;
@@ -1363,7 +1664,7 @@ dtStatus dtNavMeshQuery::updateSlicedFindPath(const int maxIter, int* doneIters)
 			const dtPoly* neighbourPoly = 0;
 			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);			
 			
-			if (!m_query.filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
+			if (!passFilter(m_query.filter, neighbourRef, neighbourTile, neighbourPoly))
 				continue;
 			
 			// get the neighbor node
@@ -2128,7 +2429,7 @@ dtStatus dtNavMeshQuery::moveAlongSurface(dtPolyRef startRef, const float* start
 							const dtMeshTile* neiTile = 0;
 							const dtPoly* neiPoly = 0;
 							m_nav->getTileAndPolyByRefUnsafe(link->ref, &neiTile, &neiPoly);
-							if (filter->passFilter(link->ref, neiTile, neiPoly))
+							if (passFilter(filter, link->ref, neiTile, neiPoly))
 							{
 								if (nneis < MAX_NEIS)
 									neis[nneis++] = link->ref;
@@ -2141,7 +2442,7 @@ dtStatus dtNavMeshQuery::moveAlongSurface(dtPolyRef startRef, const float* start
 			{
 				const unsigned int idx = (unsigned int)(curPoly->neis[j]-1);
 				const dtPolyRef ref = m_nav->getPolyRefBase(curTile) | idx;
-				if (filter->passFilter(ref, curTile, &curTile->polys[idx]))
+				if (passFilter(filter, ref, curTile, &curTile->polys[idx]))
 				{
 					// Internal edge, encode id.
 					neis[nneis++] = ref;
@@ -2565,7 +2866,7 @@ dtStatus dtNavMeshQuery::raycast(dtPolyRef startRef, const float* startPos, cons
 				continue;
 			
 			// Skip links based on filter.
-			if (!filter->passFilter(link->ref, nextTile, nextPoly))
+			if (!passFilter(filter, link->ref, nextTile, nextPoly))
 				continue;
 			
 			// If the link is internal, just return the ref.
@@ -2797,7 +3098,7 @@ dtStatus dtNavMeshQuery::findPolysAroundCircle(dtPolyRef startRef, const float*
 			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);
 		
 			// Do not advance if the polygon is excluded by the filter.
-			if (!filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
+			if (!passFilter(filter, neighbourRef, neighbourTile, neighbourPoly))
 				continue;
 			
 			// Find edge and calc distance to the edge.
@@ -2978,7 +3279,7 @@ dtStatus dtNavMeshQuery::findPolysAroundShape(dtPolyRef startRef, const float* v
 			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);
 			
 			// Do not advance if the polygon is excluded by the filter.
-			if (!filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
+			if (!passFilter(filter, neighbourRef, neighbourTile, neighbourPoly))
 				continue;
 			
 			// Find edge and calc distance to the edge.
@@ -3041,6 +3342,171 @@ dtStatus dtNavMeshQuery::findPolysAroundShape(dtPolyRef startRef, const float* v
 	return status;
 }
 
+/// @par
+///
+/// The search expands polygons in order of cost from the start position, as
+/// findPolysAroundCircle, and a target is settled when its polygon is expanded:
+/// its cost is the cost to the polygon plus the cost from the polygon entry point
+/// to the target position. The search ends once every target is settled, or when
+/// the next polygon costs more than @p maxCost.
+///
+/// The targets are compared against every expanded polygon, the method is meant
+/// for a handful of targets. Several targets may share a polygon.
+///
+/// The search tree is kept in the node pool, so getPathFromDijkstraSearch() can
+/// return the corridor to any reached target.
+///
+dtStatus dtNavMeshQuery::findTravelCosts(dtPolyRef startRef, const float* startPos,
+										 const dtPolyRef* targetRefs, const float* targetPos, const int targetCount,
+										 const float maxCost, const dtQueryFilter* filter, float* costs) const
+{
+	dtAssert(m_nav);
+	dtAssert(m_nodePool);
+	dtAssert(m_openList);
+
+	if (!m_nav->isValidPolyRef(startRef) ||
+		!startPos || !dtVisfinite(startPos) ||
+		!targetRefs || !targetPos || targetCount < 0 ||
+		!(maxCost >= 0) ||
+		!filter || !costs)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	int remaining = 0;
+	for (int i = 0; i < targetCount; ++i)
+	{
+		costs[i] = FLT_MAX;
+		if (targetRefs[i])
+			++remaining;
+	}
+
+	m_nodePool->clear();
+	m_openList->clear();
+
+	dtNode* startNode = m_nodePool->getNode(startRef);
+	dtVcopy(startNode->pos, startPos);
+	startNode->pidx = 0;
+	startNode->cost = 0;
+	startNode->total = 0;
+	startNode->id = startRef;
+	startNode->flags = DT_NODE_OPEN;
+	m_openList->push(startNode);
+
+	dtStatus status = DT_SUCCESS;
+
+	while (remaining > 0 && !m_openList->empty())
+	{
+		dtNode* bestNode = m_openList->pop();
+		if (bestNode->total > maxCost)
+			break;
+		bestNode->flags &= ~DT_NODE_OPEN;
+		bestNode->flags |= DT_NODE_CLOSED;
+
+		// Get poly and tile.
+		// The API input has been cheked already, skip checking internal data.
+		const dtPolyRef bestRef = bestNode->id;
+		const dtMeshTile* bestTile = 0;
+		const dtPoly* bestPoly = 0;
+		m_nav->getTileAndPolyByRefUnsafe(bestRef, &bestTile, &bestPoly);
+
+		// Get parent poly and tile.
+		dtPolyRef parentRef = 0;
+		const dtMeshTile* parentTile = 0;
+		const dtPoly* parentPoly = 0;
+		if (bestNode->pidx)
+			parentRef = m_nodePool->getNodeAtIdx(bestNode->pidx)->id;
+		if (parentRef)
+			m_nav->getTileAndPolyByRefUnsafe(parentRef, &parentTile, &parentPoly);
+
+		// Settle the targets inside this polygon.
+		for (int i = 0; i < targetCount; ++i)
+		{
+			if (targetRefs[i] != bestRef || costs[i] != FLT_MAX)
+				continue;
+			const float cost = bestNode->total + filter->getCost(bestNode->pos, &targetPos[i*3],
+																 parentRef, parentTile, parentPoly,
+																 bestRef, bestTile, bestPoly,
+																 0, 0, 0);
+			if (cost <= maxCost)
+				costs[i] = cost;
+			--remaining;
+		}
+
+		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = bestTile->links[i].next)
+		{
+			const dtLink* link = &bestTile->links[i];
+			dtPolyRef neighbourRef = link->ref;
+			// Skip invalid neighbours and do not follow back to parent.
+			if (!neighbourRef || neighbourRef == parentRef)
+				continue;
+
+			// Expand to neighbour
+			const dtMeshTile* neighbourTile = 0;
+			const dtPoly* neighbourPoly = 0;
+			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);
+
+			// Do not advance if the polygon is excluded by the filter.
+			if (!passFilter(filter, neighbourRef, neighbourTile, neighbourPoly))
+				continue;
+
+			// Find edge and calc distance to the edge.
+			float va[3], vb[3];
+			if (!getPortalPoints(bestRef, bestPoly, bestTile, neighbourRef, neighbourPoly, neighbourTile, va, vb))
+				continue;
+
+			dtNode* neighbourNode = m_nodePool->getNode(neighbourRef);
+			if (!neighbourNode)
+			{
+				status |= DT_OUT_OF_NODES;
+				continue;
+			}
+
+			if (neighbourNode->flags & DT_NODE_CLOSED)
+				continue;
+
+			// Cost
+			if (neighbourNode->flags == 0)
+				dtVlerp(neighbourNode->pos, va, vb, 0.5f);
+
+			float cost = filter->getCost(
+				bestNode->pos, neighbourNode->pos,
+				parentRef, parentTile, parentPoly,
+				bestRef, bestTile, bestPoly,
+				neighbourRef, neighbourTile, neighbourPoly);
+
+			const float total = bestNode->total + cost;
+
+			// Beyond the cost cap, the node would never be expanded.
+			if (total > maxCost)
+				continue;
+
+			// The node is already in open list and the new result is worse, skip.
+			if ((neighbourNode->flags & DT_NODE_OPEN) && total >= neighbourNode->total)
+				continue;
+
+			neighbourNode->id = neighbourRef;
+			neighbourNode->pidx = m_nodePool->getNodeIdx(bestNode);
+			neighbourNode->total = total;
+
+			if (neighbourNode->flags & DT_NODE_OPEN)
+			{
+				m_openList->modify(neighbourNode);
+			}
+			else
+			{
+				neighbourNode->flags = DT_NODE_OPEN;
+				m_openList->push(neighbourNode);
+			}
+		}
+	}
+
+	if (remaining > 0 && (status & DT_OUT_OF_NODES))
+		status |= DT_PARTIAL_RESULT;
+
+	return status;
+}
+
 dtStatus dtNavMeshQuery::getPathFromDijkstraSearch(dtPolyRef endRef, dtPolyRef* path, int* pathCount, int maxPath) const
 {
 	if (!m_nav->isValidPolyRef(endRef) || !path || !pathCount || maxPath < 0)
@@ -3172,7 +3638,7 @@ dtStatus dtNavMeshQuery::findLocalNeighbourhood(dtPolyRef startRef, const float*
 				continue;
 			
 			// Do not advance if the polygon is excluded by the filter.
-			if (!filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
+			if (!passFilter(filter, neighbourRef, neighbourTile, neighbourPoly))
 				continue;
 			
 			// Find edge and calc distance to the edge.
@@ -3345,7 +3811,7 @@ dtStatus dtNavMeshQuery::getPolyWallSegments(dtPolyRef ref, const dtQueryFilter*
 						const dtMeshTile* neiTile = 0;
 						const dtPoly* neiPoly = 0;
 						m_nav->getTileAndPolyByRefUnsafe(link->ref, &neiTile, &neiPoly);
-						if (filter->passFilter(link->ref, neiTile, neiPoly))
+						if (passFilter(filter, link->ref, neiTile, neiPoly))
 						{
 							insertInterval(ints, nints, MAX_INTERVAL, link->bmin, link->bmax, link->ref);
 						}
@@ -3361,7 +3827,7 @@ dtStatus dtNavMeshQuery::getPolyWallSegments(dtPolyRef ref, const dtQueryFilter*
 			{
 				const unsigned int idx = (unsigned int)(poly->neis[j]-1);
 				neiRef = m_nav->getPolyRefBase(tile) | idx;
-				if (!filter->passFilter(neiRef, tile, &tile->polys[idx]))
+				if (!passFilter(filter, neiRef, tile, &tile->polys[idx]))
 					neiRef = 0;
 			}
 
@@ -3529,7 +3995,7 @@ dtStatus dtNavMeshQuery::findDistanceToWall(dtPolyRef startRef, const float* cen
 							const dtMeshTile* neiTile = 0;
 							const dtPoly* neiPoly = 0;
 							m_nav->getTileAndPolyByRefUnsafe(link->ref, &neiTile, &neiPoly);
-							if (filter->passFilter(link->ref, neiTile, neiPoly))
+							if (passFilter(filter, link->ref, neiTile, neiPoly))
 								solid = false;
 						}
 						break;
@@ -3542,7 +4008,7 @@ dtStatus dtNavMeshQuery::findDistanceToWall(dtPolyRef startRef, const float* cen
 				// Internal edge
 				const unsigned int idx = (unsigned int)(bestPoly->neis[j]-1);
 				const dtPolyRef ref = m_nav->getPolyRefBase(bestTile) | idx;
-				if (filter->passFilter(ref, bestTile, &bestTile->polys[idx]))
+				if (passFilter(filter, ref, bestTile, &bestTile->polys[idx]))
 					continue;
 			}
 			
@@ -3591,7 +4057,7 @@ dtStatus dtNavMeshQuery::findDistanceToWall(dtPolyRef startRef, const float* cen
 			if (distSqr > radiusSqr)
 				continue;
 			
-			if (!filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
+			if (!passFilter(filter, neighbourRef, neighbourTile, neighbourPoly))
 				continue;
 
 			dtNode* neighbourNode = m_nodePool->getNode(neighbourRef);
@@ -3652,11 +4118,24 @@ bool dtNavMeshQuery::isValidPolyRef(dtPolyRef ref, const dtQueryFilter* filter)
 	if (dtStatusFailed(status))
 		return false;
 	// If cannot pass filter, assume flags has changed and boundary is invalid.
-	if (!filter->passFilter(ref, tile, poly))
+	if (!passFilter(filter, ref, tile, poly))
 		return false;
 	return true;
 }
 
+dtStatus dtNavMeshQuery::getPolyFlags(dtPolyRef ref, unsigned short* resultFlags) const
+{
+	dtAssert(m_nav);
+	if (!resultFlags)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	const dtMeshTile* tile = 0;
+	const dtPoly* poly = 0;
+	if (dtStatusFailed(m_nav->getTileAndPolyByRef(ref, &tile, &poly)))
+		return DT_FAILURE | DT_INVALID_PARAM;
+	*resultFlags = m_flagsOverlay ? m_flagsOverlay->getFlags(ref, poly) : poly->flags;
+	return DT_SUCCESS;
+}
+
 /// @par
 ///
 /// The closed list is the list of polygons that were fully evaluated during 
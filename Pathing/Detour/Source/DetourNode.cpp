@@ -48,58 +48,65 @@ inline unsigned int dtHashRef(dtPolyRef a)
 #endif
 
 //////////////////////////////////////////////////////////////////////////////////////////
+static int dtNodeHashSize(int maxNodes, int hashSize)
+{
+	// Linear probing stays short while the table is at most half full.
+	const int minSize = (int)dtNextPow2((unsigned int)maxNodes*2);
+	return hashSize > minSize ? hashSize : minSize;
+}
+
 dtNodePool::dtNodePool(int maxNodes, int hashSize) :
 	m_nodes(0),
-	m_first(0),
-	m_next(0),
+	m_slots(0),
 	m_maxNodes(maxNodes),
-	m_hashSize(hashSize),
-	m_nodeCount(0)
+	m_hashSize(dtNodeHashSize(maxNodes, hashSize)),
+	m_nodeCount(0),
+	m_epoch(1)
 {
-	dtAssert(dtNextPow2(m_hashSize) == (unsigned int)m_hashSize);
+	dtAssert(dtNextPow2(hashSize) == (unsigned int)hashSize);
 	// pidx is special as 0 means "none" and 1 is the first node. For that reason
 	// we have 1 fewer nodes available than the number of values it can contain.
 	dtAssert(m_maxNodes > 0 && m_maxNodes <= DT_NULL_IDX && m_maxNodes <= (1 << DT_NODE_PARENT_BITS) - 1);
 
 	m_nodes = (dtNode*)dtAlloc(sizeof(dtNode)*m_maxNodes, DT_ALLOC_PERM);
-	m_next = (dtNodeIndex*)dtAlloc(sizeof(dtNodeIndex)*m_maxNodes, DT_ALLOC_PERM);
-	m_first = (dtNodeIndex*)dtAlloc(sizeof(dtNodeIndex)*hashSize, DT_ALLOC_PERM);
+	m_slots = (dtNodeSlot*)dtAlloc(sizeof(dtNodeSlot)*m_hashSize, DT_ALLOC_PERM);
 
 	dtAssert(m_nodes);
-	dtAssert(m_next);
-	dtAssert(m_first);
+	dtAssert(m_slots);
 
-	memset(m_first, 0xff, sizeof(dtNodeIndex)*m_hashSize);
-	memset(m_next, 0xff, sizeof(dtNodeIndex)*m_maxNodes);
+	memset(m_slots, 0, sizeof(dtNodeSlot)*m_hashSize);
 }
 
 dtNodePool::~dtNodePool()
 {
 	dtFree(m_nodes);
-	dtFree(m_next);
-	dtFree(m_first);
+	dtFree(m_slots);
 }
 
 void dtNodePool::clear()
 {
-	memset(m_first, 0xff, sizeof(dtNodeIndex)*m_hashSize);
+	// Slots of older epochs read as empty. The table is only wiped when the epoch wraps.
+	m_epoch++;
+	if (m_epoch == 0)
+	{
+		memset(m_slots, 0, sizeof(dtNodeSlot)*m_hashSize);
+		m_epoch = 1;
+	}
 	m_nodeCount = 0;
 }
 
 unsigned int dtNodePool::findNodes(dtPolyRef id, dtNode** nodes, const int maxNodes)
 {
 	int n = 0;
-	unsigned int bucket = dtHashRef(id) & (m_hashSize-1);
-	dtNodeIndex i = m_first[bucket];
-	while (i != DT_NULL_IDX)
+	const unsigned int mask = (unsigned int)m_hashSize-1;
+	for (unsigned int i = dtHashRef(id) & mask; m_slots[i].epoch == m_epoch; i = (i+1) & mask)
 	{
-		if (m_nodes[i].id == id)
+		if (m_slots[i].id == id)
 		{
 			if (n >= maxNodes)
 				return n;
-			nodes[n++] = &m_nodes[i];
+			nodes[n++] = &m_nodes[m_slots[i].idx];
 		}
-		i = m_next[i];
 	}
 
 	return n;
@@ -107,37 +114,33 @@ unsigned int dtNodePool::findNodes(dtPolyRef id, dtNode** nodes, const int maxNo
 
 dtNode* dtNodePool::findNode(dtPolyRef id, unsigned char state)
 {
-	unsigned int bucket = dtHashRef(id) & (m_hashSize-1);
-	dtNodeIndex i = m_first[bucket];
-	while (i != DT_NULL_IDX)
+	const unsigned int mask = (unsigned int)m_hashSize-1;
+	for (unsigned int i = dtHashRef(id) & mask; m_slots[i].epoch == m_epoch; i = (i+1) & mask)
 	{
-		if (m_nodes[i].id == id && m_nodes[i].state == state)
-			return &m_nodes[i];
-		i = m_next[i];
+		if (m_slots[i].id == id && m_nodes[m_slots[i].idx].state == state)
+			return &m_nodes[m_slots[i].idx];
 	}
 	return 0;
 }
 
 dtNode* dtNodePool::getNode(dtPolyRef id, unsigned char state)
 {
-	unsigned int bucket = dtHashRef(id) & (m_hashSize-1);
-	dtNodeIndex i = m_first[bucket];
-	dtNode* node = 0;
-	while (i != DT_NULL_IDX)
+	const unsigned int mask = (unsigned int)m_hashSize-1;
+	unsigned int i = dtHashRef(id) & mask;
+	for (; m_slots[i].epoch == m_epoch; i = (i+1) & mask)
 	{
-		if (m_nodes[i].id == id && m_nodes[i].state == state)
-			return &m_nodes[i];
-		i = m_next[i];
+		if (m_slots[i].id == id && m_nodes[m_slots[i].idx].state == state)
+			return &m_nodes[m_slots[i].idx];
 	}
 	
 	if (m_nodeCount >= m_maxNodes)
 		return 0;
 	
-	i = (dtNodeIndex)m_nodeCount;
+	const dtNodeIndex idx = (dtNodeIndex)m_nodeCount;
 	m_nodeCount++;
 	
 	// Init node
-	node = &m_nodes[i];
+	dtNode* node = &m_nodes[idx];
 	node->pidx = 0;
 	node->cost = 0;
 	node->total = 0;
@@ -145,8 +148,10 @@ dtNode* dtNodePool::getNode(dtPolyRef id, unsigned char state)
 	node->state = state;
 	node->flags = 0;
 	
-	m_next[i] = m_first[bucket];
-	m_first[bucket] = i;
+	// i is the first free slot of the probe sequence
+	m_slots[i].id = id;
+	m_slots[i].epoch = m_epoch;
+	m_slots[i].idx = idx;
 	
 	return node;
 }
@@ -0,0 +1,144 @@
+#include <math.h>
+#include <string.h>
+#include <new>
+
+#include "DetourPolyGrid.h"
+#include "DetourAlloc.h"
+#include "DetourCommon.h"
+
+// Cells per side are about the square root of the leaf count, at most this many.
+static const int MAX_CELLS_PER_SIDE = 256;
+
+dtPolyGrid::dtPolyGrid() :
+	m_nav(0),
+	m_maxTiles(0),
+	m_tiles(0),
+	m_memory(0)
+{
+}
+
+dtPolyGrid::~dtPolyGrid()
+{
+	for (int i = 0; i < m_maxTiles; ++i)
+		dtFree(m_tiles[i].cells);
+	delete[] m_tiles;
+}
+
+dtStatus dtPolyGrid::init(const dtNavMesh* nav)
+{
+	if (!nav || m_nav)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	m_maxTiles = nav->getMaxTiles();
+	m_tiles = new (std::nothrow) TileGrid[m_maxTiles];
+	if (!m_tiles)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(m_tiles, 0, sizeof(TileGrid) * m_maxTiles);
+	m_memory = sizeof(TileGrid) * m_maxTiles;
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		const dtMeshTile* tile = nav->getTile(i);
+		if (!tile->header || !tile->bvTree)
+			continue;
+		dtStatus status = initTile(tile, m_tiles[i]);
+		if (dtStatusFailed(status))
+			return status;
+	}
+	m_nav = nav;
+	return DT_SUCCESS;
+}
+
+dtStatus dtPolyGrid::initTile(const dtMeshTile* tile, TileGrid& grid)
+{
+	const dtMeshHeader* header = tile->header;
+	// Node indices are stored on 16 bits.
+	if (header->bvNodeCount > 0xffff)
+		return DT_SUCCESS;
+
+	int leafCount = 0;
+	for (int i = 0; i < header->bvNodeCount; ++i)
+		if (tile->bvTree[i].i >= 0)
+			leafCount++;
+	if (leafCount == 0)
+		return DT_SUCCESS;
+
+	const float qx = (header->bmax[0] - header->bmin[0]) * header->bvQuantFactor;
+	const float qz = (header->bmax[2] - header->bmin[2]) * header->bvQuantFactor;
+	const int side = dtClamp((int)ceilf(sqrtf((float)leafCount)), 1, MAX_CELLS_PER_SIDE);
+	const int cellSize = dtMax(1, (int)ceilf(dtMax(qx, qz) / side));
+	const int width = (int)(qx / cellSize) + 1;
+	const int height = (int)(qz / cellSize) + 1;
+	const int cellCount = width * height;
+
+	// Count the entries of every cell, then fill them in tree order.
+	unsigned int* counts = (unsigned int*)dtAlloc(sizeof(unsigned int) * (cellCount + 1), DT_ALLOC_TEMP);
+	if (!counts)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(counts, 0, sizeof(unsigned int) * (cellCount + 1));
+	unsigned int entryCount = 0;
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		for (int i = 0; i < header->bvNodeCount; ++i)
+		{
+			const dtBVNode& node = tile->bvTree[i];
+			if (node.i < 0)
+				continue;
+			const int x0 = dtMin((int)node.bmin[0] / cellSize, width - 1);
+			const int x1 = dtMin((int)node.bmax[0] / cellSize, width - 1);
+			const int z0 = dtMin((int)node.bmin[2] / cellSize, height - 1);
+			const int z1 = dtMin((int)node.bmax[2] / cellSize, height - 1);
+			for (int z = z0; z <= z1; ++z)
+			{
+				for (int x = x0; x <= x1; ++x)
+				{
+					const int c = x + z * width;
+					if (pass == 0)
+						counts[c]++;
+					else
+						grid.nodes[grid.cells[c] + counts[c]++] = (unsigned short)i;
+				}
+			}
+		}
+		if (pass == 1)
+			break;
+
+		for (int c = 0; c < cellCount; ++c)
+			entryCount += counts[c];
+		const size_t cellsSize = dtAlign4(sizeof(unsigned int) * (cellCount + 1));
+		const size_t size = cellsSize + sizeof(unsigned short) * entryCount;
+		unsigned char* data = (unsigned char*)dtAlloc(size, DT_ALLOC_PERM);
+		if (!data)
+		{
+			dtFree(counts);
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+		}
+		grid.cells = (unsigned int*)data;
+		grid.nodes = (unsigned short*)(data + cellsSize);
+		grid.cells[0] = 0;
+		for (int c = 0; c < cellCount; ++c)
+			grid.cells[c + 1] = grid.cells[c] + counts[c];
+		memset(counts, 0, sizeof(unsigned int) * (cellCount + 1));
+		m_memory += size;
+	}
+	dtFree(counts);
+
+	grid.header = header;
+	grid.width = width;
+	grid.height = height;
+	grid.cellSize = cellSize;
+	return DT_SUCCESS;
+}
+
+const unsigned short* dtPolyGrid::getCellNodes(const dtMeshTile* tile, const unsigned short* point, int* count) const
+{
+	if (!m_nav)
+		return 0;
+	const TileGrid& grid = m_tiles[m_nav->decodePolyIdTile(m_nav->getPolyRefBase(tile))];
+	// The tile may have been replaced since the grid was built.
+	if (!grid.header || grid.header != tile->header)
+		return 0;
+	const int x = dtMin((int)point[0] / grid.cellSize, grid.width - 1);
+	const int z = dtMin((int)point[2] / grid.cellSize, grid.height - 1);
+	const int c = x + z * grid.width;
+	*count = (int)(grid.cells[c + 1] - grid.cells[c]);
+	return &grid.nodes[grid.cells[c]];
+}
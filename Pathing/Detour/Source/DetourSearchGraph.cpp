@@ -0,0 +1,156 @@
+#include <string.h>
+#include <new>
+
+#include "DetourSearchGraph.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourAlloc.h"
+#include "DetourCommon.h"
+
+dtSearchGraph::dtSearchGraph() :
+	m_nav(0),
+	m_maxTiles(0),
+	m_tiles(0),
+	m_memory(0)
+{
+}
+
+dtSearchGraph::~dtSearchGraph()
+{
+	for (int i = 0; i < m_maxTiles; ++i)
+		dtFree(m_tiles[i].firstEdge);
+	delete[] m_tiles;
+}
+
+dtStatus dtSearchGraph::init(const dtNavMesh* nav)
+{
+	if (!nav || m_nav)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	// The portal mid points are computed as the queries do.
+	dtNavMeshQuery query;
+	dtStatus status = query.init(nav, 1);
+	if (dtStatusFailed(status))
+		return status;
+
+	m_maxTiles = nav->getMaxTiles();
+	m_tiles = new (std::nothrow) TileGraph[m_maxTiles];
+	if (!m_tiles)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(m_tiles, 0, sizeof(TileGraph) * m_maxTiles);
+	m_memory = sizeof(TileGraph) * m_maxTiles;
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		const dtMeshTile* tile = nav->getTile(i);
+		if (!tile->header)
+			continue;
+		status = initTile(tile, query, m_tiles[i]);
+		if (dtStatusFailed(status))
+			return status;
+	}
+	m_nav = nav;
+	return DT_SUCCESS;
+}
+
+/// @par
+///
+/// The links of the neighbour tiles change when a tile is added or removed, their graph is
+/// rebuilt with the graph of the tiles at the location. Tiles whose data changed since the
+/// graph was built are rebuilt too, wherever they are.
+dtStatus dtSearchGraph::updateTilesAt(const int x, const int y)
+{
+	if (!m_nav)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	dtNavMeshQuery query;
+	dtStatus status = query.init(m_nav, 1);
+	if (dtStatusFailed(status))
+		return status;
+
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		const dtMeshTile* tile = m_nav->getTile(i);
+		TileGraph& graph = m_tiles[i];
+		const bool changed = graph.header != tile->header || (tile->header && graph.salt != tile->salt);
+		const bool near = tile->header && dtAbs(tile->header->x - x) <= 1 && dtAbs(tile->header->y - y) <= 1;
+		if (!changed && !near)
+			continue;
+		freeTile(graph);
+		if (!tile->header)
+			continue;
+		status = initTile(tile, query, graph);
+		if (dtStatusFailed(status))
+			return status;
+	}
+	return DT_SUCCESS;
+}
+
+void dtSearchGraph::setPolyFlags(dtPolyRef ref, unsigned short flags)
+{
+	if (!m_nav || !m_nav->isValidPolyRef(ref))
+		return;
+	TileGraph& graph = m_tiles[m_nav->decodePolyIdTile(ref)];
+	if (graph.flags)
+		graph.flags[m_nav->decodePolyIdPoly(ref)] = flags;
+}
+
+dtStatus dtSearchGraph::initTile(const dtMeshTile* tile, const dtNavMeshQuery& query, TileGraph& graph)
+{
+	const dtMeshHeader* header = tile->header;
+	const int polyCount = header->polyCount;
+
+	unsigned int edgeCount = 0;
+	for (int i = 0; i < polyCount; ++i)
+	{
+		for (unsigned int j = tile->polys[i].firstLink; j != DT_NULL_LINK; j = tile->links[j].next)
+		{
+			if (tile->links[j].ref)
+				edgeCount++;
+		}
+	}
+
+	// One block: edge offsets, edges, flags and areas.
+	const size_t firstEdgeSize = dtAlign4(sizeof(unsigned int) * (polyCount + 1));
+	const size_t edgesSize = sizeof(dtSearchGraphEdge) * edgeCount;
+	const size_t flagsSize = dtAlign4(sizeof(unsigned short) * polyCount);
+	const size_t size = firstEdgeSize + edgesSize + flagsSize + sizeof(unsigned char) * polyCount;
+	unsigned char* data = (unsigned char*)dtAlloc(size, DT_ALLOC_PERM);
+	if (!data)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	graph.firstEdge = (unsigned int*)data;
+	graph.edges = (dtSearchGraphEdge*)(data + firstEdgeSize);
+	graph.flags = (unsigned short*)(data + firstEdgeSize + edgesSize);
+	graph.areas = data + firstEdgeSize + edgesSize + flagsSize;
+
+	const dtPolyRef base = query.getAttachedNavMesh()->getPolyRefBase(tile);
+	unsigned int e = 0;
+	for (int i = 0; i < polyCount; ++i)
+	{
+		const dtPoly* poly = &tile->polys[i];
+		graph.firstEdge[i] = e;
+		graph.flags[i] = poly->flags;
+		graph.areas[i] = poly->getArea();
+		for (unsigned int j = poly->firstLink; j != DT_NULL_LINK; j = tile->links[j].next)
+		{
+			const dtLink& link = tile->links[j];
+			if (!link.ref)
+				continue;
+			dtSearchGraphEdge& edge = graph.edges[e++];
+			edge.ref = link.ref;
+			edge.crossSide = link.side != 0xff ? (unsigned char)(link.side >> 1) : 0;
+			if (dtStatusFailed(query.getEdgeMidPoint(base | (dtPolyRef)i, link.ref, edge.mid)))
+				dtVset(edge.mid, 0, 0, 0);
+		}
+	}
+	graph.firstEdge[polyCount] = e;
+
+	graph.header = header;
+	graph.salt = tile->salt;
+	graph.memory = size;
+	m_memory += size;
+	return DT_SUCCESS;
+}
+
+void dtSearchGraph::freeTile(TileGraph& graph)
+{
+	dtFree(graph.firstEdge);
+	m_memory -= graph.memory;
+	memset(&graph, 0, sizeof(TileGraph));
+}
@@ -1,8 +1,16 @@
 #include "dol_detour.hpp"
+#include "dol_trace.hpp"
 
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
 #include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <filesystem>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <thread>
 #include <vector>
 
@@ -28,6 +36,30 @@ void test_FindRandomPointAroundCircle(dtNavMeshQuery *query)
     }
 }
 
+void test_FindRandomRoamPath(dtNavMeshQuery *query)
+{
+    for (int i = 0; i < 1000; ++i)
+    {
+        // the failing iteration reproduces with its seed
+        SeedRandom(i);
+        float start[] = {30893 * FACTOR, 15637 * FACTOR, 33758 * FACTOR};
+        float polyPick[] = {2.0f, 4.0f, 2.0f};
+        float output[3];
+        int pointCount;
+        float pointBuffer[MAX_POLY * 3];
+        dtPolyFlags pointFlags[MAX_POLY];
+        auto status = FindRandomRoamPath(query, start, 512 * FACTOR, polyPick, filter, DT_STRAIGHTPATH_ALL_CROSSINGS, output, &pointCount, pointBuffer, pointFlags);
+        if (!dtStatusSucceed(status) || pointCount < 1)
+            throw i;
+        // from the start on the mesh to the returned destination
+        if (dtVdist2D(&pointBuffer[0], start) > 0.01f || !dtVequal(&pointBuffer[(pointCount - 1) * 3], output))
+            throw 10000 + i;
+        for (int k = 0; k < pointCount; ++k)
+            if (pointFlags[k] & DISABLED)
+                throw 20000 + i;
+    }
+}
+
 void test_FindClosestPoint(dtNavMeshQuery *query)
 {
     for (int i = 0; i < 1000; ++i)
@@ -73,6 +105,1255 @@ void test_PathStraight__ALL(dtNavMeshQuery *query)
     }
 }
 
+void test_FlowField(dtNavMeshQuery *query)
+{
+    float target[] = {31095 * FACTOR, 15511 * FACTOR, 33902 * FACTOR};
+    float polyPick[] = {64 * FACTOR, 256 * FACTOR, 64 * FACTOR};
+    dtFlowField *field;
+    if (!dtStatusSucceed(CreateFlowField(query, target, 1024 * FACTOR, polyPick, filter, &field)))
+        throw 0;
+    std::unique_ptr<dtFlowField, decltype(&FreeFlowField)> _field(field, FreeFlowField);
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        // the target drifts a little every tick
+        target[0] += (i % 2 ? 4 : -4) * FACTOR;
+        if (!dtStatusSucceed(UpdateFlowField(query, field, target, polyPick)))
+            throw i;
+
+        float pos[] = {30893 * FACTOR, 15637 * FACTOR, 33758 * FACTOR};
+        float lastCost = FLT_MAX;
+        int step = 0;
+        for (; step < MAX_POLY; ++step)
+        {
+            float waypoint[3];
+            float cost;
+            if (!dtStatusSucceed(FlowFieldNextWaypoint(query, field, pos, polyPick, waypoint, &cost)))
+                throw i;
+            if (cost > lastCost + 0.01f)
+                throw i;
+            lastCost = cost;
+            if (dtVdist(waypoint, target) < 0.01f)
+                break;
+            // step slightly past the portal so the agent enters the next poly
+            float next[3];
+            dtVlerp(next, pos, waypoint, 1.05f);
+            dtVcopy(pos, next);
+        }
+        if (step == MAX_POLY)
+            throw i;
+    }
+
+    // every poly of a fresh field leads through the portal to its parent in the search from the target
+    float root[] = {31095 * FACTOR, 15511 * FACTOR, 33902 * FACTOR};
+    if (!dtStatusSucceed(CreateFlowField(query, root, 1024 * FACTOR, polyPick, filter, &field)))
+        throw 1;
+    std::unique_ptr<dtFlowField, decltype(&FreeFlowField)> _fresh(field, FreeFlowField);
+    dtQueryFilter queryFilter;
+    queryFilter.setIncludeFlags(filter[0]);
+    queryFilter.setExcludeFlags(filter[1]);
+    dtPolyRef rootRef;
+    query->findNearestPoly(root, polyPick, &queryFilter, &rootRef, nullptr);
+    static const int MAX_FIELD = 2048;
+    std::vector<dtPolyRef> refs(MAX_FIELD), parents(MAX_FIELD);
+    int count;
+    query->findPolysAroundCircle(rootRef, root, 1024 * FACTOR, &queryFilter, refs.data(), parents.data(), nullptr, &count, MAX_FIELD);
+    int checked = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        float portal[3];
+        if (!parents[i] || dtStatusFailed(query->getEdgeMidPoint(refs[i], parents[i], portal)))
+            continue;
+        // the poly center, when it resolves to the poly itself
+        dtMeshTile const *tile;
+        dtPoly const *poly;
+        navMesh->getTileAndPolyByRefUnsafe(refs[i], &tile, &poly);
+        float center[3] = {0, 0, 0};
+        for (int k = 0; k < poly->vertCount; ++k)
+            dtVadd(center, center, &tile->verts[poly->verts[k] * 3]);
+        dtVscale(center, center, 1.0f / poly->vertCount);
+        dtPolyRef ref;
+        float closest[3];
+        if (dtStatusFailed(query->findNearestPoly(center, polyPick, &queryFilter, &ref, closest)) || ref != refs[i])
+            continue;
+        float waypoint[3];
+        float cost;
+        if (!dtStatusSucceed(FlowFieldNextWaypoint(query, field, closest, polyPick, waypoint, &cost)) || !dtVequal(waypoint, portal))
+            throw 2 + i;
+        ++checked;
+    }
+    if (checked == 0)
+        throw -1;
+}
+
+void test_SpatialBatch(dtNavMeshQuery *query)
+{
+    static const int COUNT = 16;
+    static const int MAX_POLYS = 32;
+    float centers[COUNT * 3];
+    for (int i = 0; i < COUNT; ++i)
+    {
+        centers[i * 3 + 0] = (30893 + i * 12) * FACTOR;
+        centers[i * 3 + 1] = 15637 * FACTOR;
+        centers[i * 3 + 2] = (33758 + i * 9) * FACTOR;
+    }
+    float polyPick[] = {64 * FACTOR, 256 * FACTOR, 64 * FACTOR};
+    float hitDists[COUNT];
+    float hitPositions[COUNT * 3];
+    dtPolyRef polys[COUNT * MAX_POLYS];
+    float costs[COUNT * MAX_POLYS];
+    int polyCounts[COUNT];
+    dtStatus statuses[COUNT];
+    for (int i = 0; i < 100; ++i)
+    {
+        if (!dtStatusSucceed(FindDistanceToWallBatch(query, COUNT, centers, 256 * FACTOR, polyPick, filter, hitDists, hitPositions, nullptr, statuses)))
+            throw i;
+        for (int j = 0; j < COUNT; ++j)
+            if (!dtStatusSucceed(statuses[j]) || hitDists[j] < 0 || hitDists[j] > 256 * FACTOR + 0.01f)
+                throw i;
+
+        if (!dtStatusSucceed(FindLocalNeighbourhoodBatch(query, COUNT, centers, 128 * FACTOR, polyPick, filter, MAX_POLYS, polys, polyCounts, statuses)))
+            throw i;
+        for (int j = 0; j < COUNT; ++j)
+            if (!dtStatusSucceed(statuses[j]) || polyCounts[j] < 1)
+                throw i;
+
+        if (!dtStatusSucceed(FindPolysAroundCircleBatch(query, COUNT, centers, 128 * FACTOR, polyPick, filter, MAX_POLYS, polys, costs, polyCounts, statuses)))
+            throw i;
+        for (int j = 0; j < COUNT; ++j)
+            if (!dtStatusSucceed(statuses[j]) || polyCounts[j] < 1 || costs[j * MAX_POLYS] != 0)
+                throw i;
+    }
+}
+
+void test_MoveAlongSurfaceBatch(dtNavMeshQuery *query)
+{
+    static const int COUNT = 16;
+    float positions[COUNT * 3];
+    float targets[COUNT * 3];
+    dtPolyRef refs[COUNT] = {};
+    for (int i = 0; i < COUNT; ++i)
+    {
+        positions[i * 3 + 0] = (30893 + i * 12) * FACTOR;
+        positions[i * 3 + 1] = 15637 * FACTOR;
+        positions[i * 3 + 2] = (33758 + i * 9) * FACTOR;
+    }
+    float polyPick[] = {64 * FACTOR, 256 * FACTOR, 64 * FACTOR};
+    float results[COUNT * 3];
+    unsigned char clamped[COUNT];
+    dtStatus statuses[COUNT];
+
+    // snap every entity on the mesh
+    if (!dtStatusSucceed(MoveAlongSurfaceBatch(query, COUNT, refs, positions, positions, polyPick, filter, results, clamped, statuses)))
+        throw 0;
+    for (int j = 0; j < COUNT; ++j)
+        if (!dtStatusSucceed(statuses[j]) || !refs[j])
+            throw 0;
+    std::copy(results, results + COUNT * 3, positions);
+
+    // small steps toward the path end, the refs are reused from one tick to the next
+    for (int i = 1; i < 100; ++i)
+    {
+        for (int j = 0; j < COUNT; ++j)
+        {
+            targets[j * 3 + 0] = positions[j * 3 + 0] + 2 * FACTOR;
+            targets[j * 3 + 1] = positions[j * 3 + 1];
+            targets[j * 3 + 2] = positions[j * 3 + 2] + 1.5f * FACTOR;
+        }
+        if (!dtStatusSucceed(MoveAlongSurfaceBatch(query, COUNT, refs, positions, targets, polyPick, filter, results, clamped, statuses)))
+            throw i;
+        for (int j = 0; j < COUNT; ++j)
+        {
+            if (!dtStatusSucceed(statuses[j]) || !refs[j])
+                throw i;
+            if (dtVdist2D(&positions[j * 3], &results[j * 3]) > dtVdist2D(&positions[j * 3], &targets[j * 3]) + 0.001f)
+                throw i;
+        }
+        std::copy(results, results + COUNT * 3, positions);
+    }
+
+    // a teleport far away cannot be done in one tick
+    for (int j = 0; j < COUNT; ++j)
+    {
+        targets[j * 3 + 0] = positions[j * 3 + 0] + 8000 * FACTOR;
+        targets[j * 3 + 1] = positions[j * 3 + 1];
+        targets[j * 3 + 2] = positions[j * 3 + 2];
+    }
+    if (!dtStatusSucceed(MoveAlongSurfaceBatch(query, COUNT, refs, positions, targets, polyPick, filter, results, clamped, statuses)))
+        throw 100;
+    for (int j = 0; j < COUNT; ++j)
+        if (!dtStatusSucceed(statuses[j]) || !clamped[j])
+            throw 100;
+}
+
+void test_SnapToGroundBatch(dtNavMeshQuery *query)
+{
+    // large enough to be split over the worker threads
+    static const int COUNT = 16384;
+    std::vector<float> positions(COUNT * 3);
+    for (int i = 0; i < COUNT; ++i)
+    {
+        positions[i * 3 + 0] = 30600.0f + (i % 128) * 6;
+        positions[i * 3 + 1] = 33500.0f + (i / 128) * 6;
+        positions[i * 3 + 2] = 15637.0f;
+    }
+    float extents[] = {64, 64, 256};
+    std::vector<float> heights(COUNT);
+    std::vector<dtPolyRef> refs(COUNT);
+    std::vector<unsigned char> onMesh(COUNT);
+    std::vector<dtStatus> statuses(COUNT);
+    if (!dtStatusSucceed(SnapToGroundBatch(query, COUNT, positions.data(), extents, filter, heights.data(), refs.data(), onMesh.data(), statuses.data())))
+        throw 0;
+
+    int onMeshCount = 0;
+    for (int i = 0; i < COUNT; ++i)
+    {
+        if (!dtStatusSucceed(statuses[i]))
+            continue;
+        if (!refs[i] || std::abs(heights[i] - positions[i * 3 + 2]) > 256 + 8)
+            throw i;
+        onMeshCount += onMesh[i];
+    }
+    if (onMeshCount < COUNT / 2)
+        throw onMeshCount;
+
+    // same answers as a small, single threaded batch
+    for (int i = 0; i < COUNT; i += 997)
+    {
+        float height;
+        dtPolyRef ref;
+        unsigned char over;
+        dtStatus status;
+        SnapToGroundBatch(query, 1, &positions[i * 3], extents, filter, &height, &ref, &over, &status);
+        if (status != statuses[i] || ref != refs[i] || height != heights[i] || over != onMesh[i])
+            throw i;
+    }
+}
+
+void test_Agent(dtNavMeshQuery *query)
+{
+    float start[] = {30893 * FACTOR, 15637 * FACTOR, 33758 * FACTOR};
+    float end[] = {31095 * FACTOR, 15511 * FACTOR, 33902 * FACTOR};
+    float polyPick[] = {64 * FACTOR, 256 * FACTOR, 64 * FACTOR};
+    dtNavAgent *rawAgent;
+    dtNavAgent *rawTarget;
+    if (!dtStatusSucceed(CreateAgent(query, start, polyPick, filter, &rawAgent)))
+        throw 0;
+    std::unique_ptr<dtNavAgent, decltype(&FreeAgent)> agent(rawAgent, FreeAgent);
+    if (!dtStatusSucceed(CreateAgent(query, end, polyPick, filter, &rawTarget)))
+        throw 0;
+    std::unique_ptr<dtNavAgent, decltype(&FreeAgent)> target(rawTarget, FreeAgent);
+
+    int pointCount;
+    float pointBuffer[MAX_POLY * 3];
+    dtPolyFlags pointFlags[MAX_POLY];
+    int expectedCount;
+    float expectedBuffer[MAX_POLY * 3];
+    dtPolyFlags expectedFlags[MAX_POLY];
+    if (!dtStatusSucceed(PathStraight(query, start, end, polyPick, filter, DT_STRAIGHTPATH_ALL_CROSSINGS, &expectedCount, expectedBuffer, expectedFlags)))
+        throw 0;
+    if (!dtStatusSucceed(AgentPathToAgent(query, agent.get(), target.get(), DT_STRAIGHTPATH_ALL_CROSSINGS, &pointCount, pointBuffer, pointFlags)))
+        throw 0;
+    if (pointCount != expectedCount || dtVdist2D(&pointBuffer[(pointCount - 1) * 3], &expectedBuffer[(expectedCount - 1) * 3]) > 0.01f)
+        throw 0;
+
+    // walk along the path in small steps, the agent must follow it without losing its poly
+    float position[3];
+    GetAgentPosition(agent.get(), nullptr, position);
+    for (int i = 1; i < pointCount; ++i)
+    {
+        float const *waypoint = &pointBuffer[i * 3];
+        for (int step = 0; step < 1000 && dtVdist2D(position, waypoint) > 0.01f; ++step)
+        {
+            float dir[3];
+            dtVsub(dir, waypoint, position);
+            auto len = dtVlen(dir);
+            dtVmad(position, position, dir, dtMin(1.0f, (float)(4 * FACTOR) / len));
+            dtPolyRef ref;
+            if (!dtStatusSucceed(UpdateAgent(query, agent.get(), position, position)))
+                throw i;
+            GetAgentPosition(agent.get(), &ref, nullptr);
+            if (!ref)
+                throw i;
+        }
+        if (!dtStatusSucceed(AgentPathStraight(query, agent.get(), end, DT_STRAIGHTPATH_ALL_CROSSINGS, &expectedCount, expectedBuffer, expectedFlags)))
+            throw i;
+    }
+    if (dtVdist2D(position, end) > 0.1f)
+        throw 1;
+
+    // a teleport relocates the agent
+    if (!dtStatusSucceed(UpdateAgent(query, agent.get(), start, position)) || dtVdist2D(position, start) > 0.01f)
+        throw 2;
+    for (int i = 0; i < 100; ++i)
+    {
+        float randomPoint[3];
+        if (!dtStatusSucceed(AgentFindRandomPointAroundCircle(query, agent.get(), 256 * FACTOR, randomPoint)))
+            throw i;
+    }
+}
+
+static std::vector<std::vector<float>> PolyCenters(int step)
+{
+    std::vector<std::vector<float>> centers;
+    for (int i = 0; i < navMesh->getMaxTiles(); ++i)
+    {
+        auto tile = ((dtNavMesh const *)navMesh)->getTile(i);
+        if (!tile->header)
+            continue;
+        for (int j = 0; j < tile->header->polyCount; j += step)
+        {
+            auto const &poly = tile->polys[j];
+            if (poly.getType() != DT_POLYTYPE_GROUND || !(poly.flags & defaultInclude) || (poly.flags & DISABLED))
+                continue;
+            std::vector<float> center(3, 0.0f);
+            for (int k = 0; k < poly.vertCount; ++k)
+                dtVadd(center.data(), center.data(), &tile->verts[poly.verts[k] * 3]);
+            dtVscale(center.data(), center.data(), 1.0f / poly.vertCount);
+            centers.push_back(center);
+        }
+    }
+    return centers;
+}
+
+static std::vector<dtPolyRef> Doors()
+{
+    std::vector<dtPolyRef> doors;
+    for (int i = 0; i < navMesh->getMaxTiles(); ++i)
+    {
+        auto tile = ((dtNavMesh const *)navMesh)->getTile(i);
+        if (!tile->header)
+            continue;
+        for (int j = 0; j < tile->header->polyCount; ++j)
+            if (tile->polys[j].flags & DOOR)
+                doors.push_back(navMesh->getPolyRefBase(tile) | (dtPolyRef)j);
+    }
+    return doors;
+}
+
+// every unreachable answer is checked against a full findPath, returns the unreachable pairs
+static std::vector<bool> CheckReachability(dtNavMeshQuery *query, std::vector<std::vector<float>> &centers)
+{
+    float polyPick[] = {2 * FACTOR, 8 * FACTOR, 2 * FACTOR};
+    dtQueryFilter queryFilter;
+    queryFilter.setIncludeFlags(filter[0]);
+    queryFilter.setExcludeFlags(filter[1]);
+    std::vector<bool> unreachable;
+    for (size_t i = 1; i < centers.size(); i += 3)
+    {
+        auto start = centers[i - 1].data();
+        auto end = centers[i].data();
+        bool reachable;
+        if (!dtStatusSucceed(IsReachable(query, start, end, polyPick, filter, &reachable)))
+            throw (int)i;
+        unreachable.push_back(!reachable);
+        if (reachable)
+            continue;
+        dtPolyRef startRef, endRef;
+        query->findNearestPoly(start, polyPick, &queryFilter, &startRef, nullptr);
+        query->findNearestPoly(end, polyPick, &queryFilter, &endRef, nullptr);
+        int npolys;
+        dtPolyRef polys[MAX_POLY];
+        query->findPath(startRef, endRef, start, end, &queryFilter, polys, &npolys, MAX_POLY);
+        if (npolys > 0 && polys[npolys - 1] == endRef)
+            throw (int)i;
+
+        int pointCount;
+        float pointBuffer[MAX_POLY * 3];
+        dtPolyFlags pointFlags[MAX_POLY];
+        auto status = PathStraight(query, start, end, polyPick, filter, DT_STRAIGHTPATH_ALL_CROSSINGS, &pointCount, pointBuffer, pointFlags);
+        if (!dtStatusFailed(status) || !dtStatusDetail(status, DT_UNREACHABLE))
+            throw (int)i;
+    }
+    return unreachable;
+}
+
+void test_GetTravelCosts(dtNavMeshQuery *query)
+{
+    float polyPick[] = {2 * FACTOR, 8 * FACTOR, 2 * FACTOR};
+    auto centers = PolyCenters(7);
+    int reached = 0;
+    for (size_t i = 0; i < centers.size(); i += 11)
+    {
+        auto start = centers[i].data();
+        std::vector<float> targets;
+        for (auto const &center : centers)
+            if (targets.size() < 8 * 3 && &center != &centers[i] && dtVdist2D(start, center.data()) < 2000 * FACTOR)
+                targets.insert(targets.end(), center.begin(), center.end());
+        int count = (int)targets.size() / 3;
+
+        float costs[8];
+        int best;
+        int pointCount;
+        float pointBuffer[MAX_POLY * 3];
+        dtPolyFlags pointFlags[MAX_POLY];
+        auto status = GetTravelCosts(query, start, count, targets.data(), 0, polyPick, filter, DT_STRAIGHTPATH_ALL_CROSSINGS, costs, &best, &pointCount, pointBuffer, pointFlags);
+        if (!dtStatusSucceed(status))
+            throw (int)i;
+        for (int k = 0; k < count; ++k)
+        {
+            int straightCount;
+            float straightBuffer[MAX_POLY * 3];
+            dtPolyFlags straightFlags[MAX_POLY];
+            auto straight = PathStraight(query, start, &targets[k * 3], polyPick, filter, DT_STRAIGHTPATH_ALL_CROSSINGS, &straightCount, straightBuffer, straightFlags);
+            bool complete = dtStatusSucceed(straight) && !dtStatusDetail(straight, DT_PARTIAL_RESULT);
+            if (complete != (costs[k] != FLT_MAX) && !dtStatusDetail(status, DT_OUT_OF_NODES))
+                throw 10000 + (int)i;
+            if (!complete || costs[k] == FLT_MAX)
+                continue;
+            ++reached;
+            if (costs[k] < costs[best])
+                throw 20000 + (int)i;
+        }
+        if (best < 0)
+            continue;
+        // the Dijkstra cost goes through the portal mid points, never shorter than the straight path along its corridor
+        float length = 0;
+        for (int p = 1; p < pointCount; ++p)
+            length += dtVdist(&pointBuffer[(p - 1) * 3], &pointBuffer[p * 3]);
+        if (pointCount < 1 || dtVdist2D(&pointBuffer[(pointCount - 1) * 3], &targets[best * 3]) > 0.01f || length > costs[best] * 1.01f + 0.01f)
+            throw 30000 + (int)i;
+
+        // a cap keeps the costs below it and drops the others
+        float cap = costs[best] * 2;
+        float capped[8];
+        int cappedBest;
+        if (!dtStatusSucceed(GetTravelCosts(query, start, count, targets.data(), cap, polyPick, filter, DT_STRAIGHTPATH_ALL_CROSSINGS, capped, &cappedBest, nullptr, nullptr, nullptr)) || cappedBest != best)
+            throw 40000 + (int)i;
+        for (int k = 0; k < count; ++k)
+            if (capped[k] != (costs[k] <= cap ? costs[k] : FLT_MAX))
+                throw 50000 + (int)i;
+    }
+    if (reached == 0)
+        throw -1;
+}
+
+void test_IsReachable(dtNavMeshQuery *query)
+{
+    auto centers = PolyCenters(7);
+    auto unreachable = CheckReachability(query, centers);
+    if (std::find(unreachable.begin(), unreachable.end(), true) == unreachable.end())
+        throw 0;
+}
+
+// closing doors must update the islands, opening them again must restore them
+// (not threaded: the other threads would see the doors closed)
+void test_IsReachable__DOOR(dtNavMeshQuery *query)
+{
+    auto centers = PolyCenters(7);
+    auto unreachable = CheckReachability(query, centers);
+    auto doors = Doors();
+    for (auto door : doors)
+        SetPolyFlags(navMesh, door, WALK | DOOR | DISABLED);
+    auto closed = CheckReachability(query, centers);
+    for (size_t i = 0; i < closed.size(); ++i)
+        if (unreachable[i] && !closed[i])
+            throw (int)i;
+    for (auto door : doors)
+        SetPolyFlags(navMesh, door, WALK | DOOR);
+    if (CheckReachability(query, centers) != unreachable)
+        throw 0;
+
+    // a walkable poly changing flags relabels the whole mesh
+    float start[] = {30893 * FACTOR, 15637 * FACTOR, 33758 * FACTOR};
+    float polyPick[] = {64 * FACTOR, 256 * FACTOR, 64 * FACTOR};
+    dtPolyRef ref;
+    float point[3];
+    GetPolyAt(query, start, polyPick, (unsigned short *)filter, &ref, point);
+    SetPolyFlags(navMesh, ref, WALK | DISABLED);
+    CheckReachability(query, centers);
+    SetPolyFlags(navMesh, ref, WALK);
+    if (CheckReachability(query, centers) != unreachable)
+        throw 1;
+}
+
+// the landmark heuristic is a lower bound of the portal costs: same ends, same path lengths as plain A*
+void test_PathStraight__LANDMARKS(dtNavMeshQuery *query)
+{
+    auto centers = PolyCenters(5);
+    float polyPick[] = {2 * FACTOR, 8 * FACTOR, 2 * FACTOR};
+    for (size_t i = 1; i < centers.size(); i += 2)
+    {
+        int counts[2];
+        float buffers[2][MAX_POLY * 3];
+        dtPolyFlags flags[MAX_POLY];
+        dtStatus statuses[2];
+        float lengths[2] = {};
+        dtPathOptions options[] = {DT_PATH_DEFAULT, DT_PATH_LANDMARKS};
+        for (int j = 0; j < 2; ++j)
+        {
+            statuses[j] = PathStraightEx(query, centers[i - 1].data(), centers[i].data(), polyPick, filter, DT_STRAIGHTPATH_ALL_CROSSINGS, options[j], &counts[j], buffers[j], flags);
+            for (int k = 1; k < counts[j]; ++k)
+                lengths[j] += dtVdist(&buffers[j][(k - 1) * 3], &buffers[j][k * 3]);
+        }
+        if (statuses[0] != statuses[1])
+            throw (int)i;
+        if (dtStatusFailed(statuses[0]) || dtStatusDetail(statuses[0], DT_PARTIAL_RESULT))
+            continue;
+        if (dtVdist(&buffers[0][(counts[0] - 1) * 3], &buffers[1][(counts[1] - 1) * 3]) > 0.01f || std::fabs(lengths[1] - lengths[0]) > 0.01f)
+            throw (int)i;
+    }
+}
+
+// short chases: the raycast fast path must return the same ends and never a longer path
+void test_PathStraight__RAYCAST(dtNavMeshQuery *query)
+{
+    auto centers = PolyCenters(1);
+    float polyPick[] = {2 * FACTOR, 8 * FACTOR, 2 * FACTOR};
+    dtPathStats before;
+    GetPathStats(&before, false);
+    for (size_t i = 1; i < centers.size(); ++i)
+    {
+        int counts[2];
+        float buffers[2][MAX_POLY * 3];
+        dtPolyFlags flags[2][MAX_POLY];
+        dtStatus statuses[2];
+        float lengths[2] = {};
+        dtPathOptions options[] = {DT_PATH_DEFAULT, DT_PATH_RAYCAST};
+        for (int j = 0; j < 2; ++j)
+        {
+            statuses[j] = PathStraightEx(query, centers[i - 1].data(), centers[i].data(), polyPick, filter, DT_STRAIGHTPATH_ALL_CROSSINGS, options[j], &counts[j], buffers[j], flags[j]);
+            for (int k = 1; k < counts[j]; ++k)
+                lengths[j] += dtVdist(&buffers[j][(k - 1) * 3], &buffers[j][k * 3]);
+        }
+        if (dtStatusSucceed(statuses[0]) != dtStatusSucceed(statuses[1]))
+            throw (int)i;
+        if (dtStatusFailed(statuses[0]) || dtStatusDetail(statuses[0], DT_PARTIAL_RESULT))
+            continue;
+        if (dtVdist(&buffers[0][(counts[0] - 1) * 3], &buffers[1][(counts[1] - 1) * 3]) > 0.01f || lengths[1] > lengths[0] + 0.01f)
+            throw (int)i;
+    }
+    dtPathStats after;
+    GetPathStats(&after, false);
+    if (after.raycastHits <= before.raycastHits || after.queries <= before.queries)
+        throw 0;
+}
+
+// post-processing stages: raw >= compacted >= shortcut points, same ends, never longer
+void test_PathStraight__SHORTCUT(dtNavMeshQuery *query)
+{
+    auto centers = PolyCenters(3);
+    float polyPick[] = {2 * FACTOR, 8 * FACTOR, 2 * FACTOR};
+    for (size_t i = 1; i < centers.size(); ++i)
+    {
+        int counts[3];
+        float buffers[3][MAX_POLY * 3];
+        dtPolyFlags flags[3][MAX_POLY];
+        float lengths[3] = {};
+        dtPathOptions options[] = {DT_PATH_KEEP_COLLINEAR, DT_PATH_DEFAULT, DT_PATH_SHORTCUT};
+        for (int j = 0; j < 3; ++j)
+        {
+            auto status = PathStraightEx(query, centers[i - 1].data(), centers[i].data(), polyPick, filter, DT_STRAIGHTPATH_ALL_CROSSINGS, options[j], &counts[j], buffers[j], flags[j]);
+            if (dtStatusFailed(status))
+                counts[j] = 0;
+            for (int k = 1; k < counts[j]; ++k)
+                lengths[j] += dtVdist(&buffers[j][(k - 1) * 3], &buffers[j][k * 3]);
+        }
+        if (counts[0] == 0)
+            continue;
+        if (counts[1] > counts[0] || counts[2] > counts[1] || lengths[2] > lengths[1] + 0.01f)
+            throw (int)i;
+        for (int j = 1; j < 3; ++j)
+            if (!dtVequal(buffers[0], buffers[j]) || !dtVequal(&buffers[0][(counts[0] - 1) * 3], &buffers[j][(counts[j] - 1) * 3]) || flags[0][0] != flags[j][0])
+                throw (int)i;
+    }
+}
+
+// unlimited budget: same path as PathStraightEx, node budget: partial path from the same start
+void test_PathStraight__BUDGET(dtNavMeshQuery *query)
+{
+    auto centers = PolyCenters(5);
+    float polyPick[] = {2 * FACTOR, 8 * FACTOR, 2 * FACTOR};
+    int cut = 0;
+    for (size_t i = 1; i < centers.size(); i += 2)
+    {
+        int counts[2];
+        float buffers[2][MAX_POLY * 3];
+        dtPolyFlags flags[2][MAX_POLY];
+        auto status = PathStraightEx(query, centers[i - 1].data(), centers[i].data(), polyPick, filter, DT_STRAIGHTPATH_ALL_CROSSINGS, DT_PATH_DEFAULT, &counts[0], buffers[0], flags[0]);
+        dtQueryBudget unlimited = {0, 0, 0, 0};
+        auto unlimitedStatus = PathStraightBudget(query, centers[i - 1].data(), centers[i].data(), polyPick, filter, DT_STRAIGHTPATH_ALL_CROSSINGS, DT_PATH_DEFAULT, &unlimited, &counts[1], buffers[1], flags[1]);
+        if (status != unlimitedStatus || counts[0] != counts[1] || std::memcmp(buffers[0], buffers[1], sizeof(float) * 3 * counts[0]) != 0)
+            throw (int)i;
+        if (dtStatusFailed(status) || dtStatusDetail(status, DT_PARTIAL_RESULT) || unlimited.nodes < 2)
+            continue;
+
+        dtQueryBudget budget = {unlimited.nodes / 2, 0, 0, 0};
+        status = PathStraightBudget(query, centers[i - 1].data(), centers[i].data(), polyPick, filter, DT_STRAIGHTPATH_ALL_CROSSINGS, DT_PATH_DEFAULT, &budget, &counts[1], buffers[1], flags[1]);
+        if (budget.nodes > budget.maxNodes || dtStatusFailed(status) || counts[1] < 1 || !dtVequal(buffers[0], buffers[1]))
+            throw (int)i;
+        if (budget.nodes == budget.maxNodes)
+        {
+            if (!dtStatusDetail(status, DT_BUDGET_EXHAUSTED) || !dtStatusDetail(status, DT_PARTIAL_RESULT))
+                throw (int)i;
+            ++cut;
+        }
+    }
+    if (cut == 0)
+        throw 0;
+}
+
+void test_FindRandomPointAroundCircle__BUDGET(dtNavMeshQuery *query)
+{
+    float center[] = {31000 * FACTOR, 15800 * FACTOR, 33750 * FACTOR};
+    float polyPick[] = {2.0f, 4.0f, 2.0f};
+    float output[3];
+    dtQueryBudget budget = {1, 0, 0, 0};
+    auto status = FindRandomPointAroundCircleBudget(query, center, 512 * FACTOR, polyPick, filter, &budget, output);
+    if (!dtStatusSucceed(status) || !dtStatusDetail(status, DT_BUDGET_EXHAUSTED) || budget.nodes != 1)
+        throw 0;
+    // a single expansion samples the center poly only
+    dtPolyRef centerRef;
+    float closest[3];
+    unsigned short queryFilter[] = {filter[0], filter[1]};
+    GetPolyAt(query, center, polyPick, queryFilter, &centerRef, closest);
+    query->closestPointOnPoly(centerRef, output, closest, nullptr);
+    if (dtVdist2D(output, closest) > 0.01f)
+        throw 1;
+
+    // a deadline far away leaves the search unchanged
+    budget = {0, 1000000, 0, 0};
+    status = FindRandomPointAroundCircleBudget(query, center, 512 * FACTOR, polyPick, filter, &budget, output);
+    if (!dtStatusSucceed(status) || dtStatusDetail(status, DT_BUDGET_EXHAUSTED) || budget.nodes <= 1)
+        throw 2;
+
+    // the core query reports the cut search itself
+    struct OneNode : dtSearchBudget
+    {
+        int nodes = 0;
+        bool spend() override { return nodes++ < 1; }
+    } oneNode;
+    dtQueryFilter coreFilter;
+    coreFilter.setIncludeFlags(filter[0]);
+    coreFilter.setExcludeFlags(filter[1]);
+    dtPolyRef randomRef;
+    query->setSearchBudget(&oneNode);
+    status = query->findRandomPointAroundCircle(centerRef, center, 512 * FACTOR, &coreFilter, []() { return 0.5f; }, &randomRef, output);
+    query->setSearchBudget(nullptr);
+    if (!dtStatusSucceed(status) || !dtStatusDetail(status, DT_PARTIAL_RESULT) || randomRef != centerRef)
+        throw 3;
+}
+
+// presets are plain queryFilter pairs: same paths as the flags they stand for
+void test_FilterPreset(dtNavMeshQuery *query)
+{
+    dtPolyFlags presetFilter[2];
+    if (!GetFilterPreset(DT_FILTER_DEFAULT, presetFilter) || presetFilter[0] != filter[0] || presetFilter[1] != filter[1])
+        throw 0;
+    if (GetFilterPreset(DT_FILTER_PRESET_COUNT, presetFilter))
+        throw 1;
+    auto centers = PolyCenters(7);
+    float polyPick[] = {2 * FACTOR, 8 * FACTOR, 2 * FACTOR};
+    for (unsigned int preset = 0; preset < DT_FILTER_PRESET_COUNT; ++preset)
+    {
+        GetFilterPreset((dtFilterPreset)preset, presetFilter);
+        dtPolyFlags flagsFilter[] = {dtFilterPresetFlags[preset][0], dtFilterPresetFlags[preset][1]};
+        for (size_t i = 1; i < centers.size(); i += 2)
+        {
+            int counts[2];
+            float buffers[2][MAX_POLY * 3];
+            dtPolyFlags flags[2][MAX_POLY];
+            auto status = PathStraight(query, centers[i - 1].data(), centers[i].data(), polyPick, presetFilter, DT_STRAIGHTPATH_ALL_CROSSINGS, &counts[0], buffers[0], flags[0]);
+            auto flagsStatus = PathStraight(query, centers[i - 1].data(), centers[i].data(), polyPick, flagsFilter, DT_STRAIGHTPATH_ALL_CROSSINGS, &counts[1], buffers[1], flags[1]);
+            if (status != flagsStatus || counts[0] != counts[1] || std::memcmp(buffers[0], buffers[1], sizeof(float) * 3 * counts[0]) != 0)
+                throw (int)(preset * 100000 + i);
+            // the path never enters a poly the preset excludes
+            for (int k = 0; dtStatusSucceed(status) && k < counts[0]; ++k)
+                if (flags[0][k] && ((flags[0][k] & presetFilter[1]) || !(flags[0][k] & presetFilter[0])))
+                    throw (int)(preset * 100000 + 50000 + i);
+        }
+    }
+}
+
+void test_LoadNavMeshEx__ARENA(dtNavMeshQuery *query)
+{
+    for (auto options : {DT_LOAD_ARENA, DT_LOAD_HUGE_PAGES})
+    {
+        dtNavMesh *arenaMesh;
+        dtNavMeshQuery *arenaQuery;
+        if (!LoadNavMeshEx("zone078.nav", options, &arenaMesh))
+            throw "load";
+        if (!CreateNavMeshQuery(arenaMesh, &arenaQuery))
+            throw "query";
+        auto centers = PolyCenters(17);
+        float polyPick[] = {2 * FACTOR, 8 * FACTOR, 2 * FACTOR};
+        for (size_t i = 1; i < centers.size(); ++i)
+        {
+            int counts[2];
+            float buffers[2][MAX_POLY * 3];
+            dtPolyFlags flags[2][MAX_POLY];
+            auto status = PathStraight(query, centers[i - 1].data(), centers[i].data(), polyPick, filter, DT_STRAIGHTPATH_ALL_CROSSINGS, &counts[0], buffers[0], flags[0]);
+            auto arenaStatus = PathStraight(arenaQuery, centers[i - 1].data(), centers[i].data(), polyPick, filter, DT_STRAIGHTPATH_ALL_CROSSINGS, &counts[1], buffers[1], flags[1]);
+            if (status != arenaStatus || counts[0] != counts[1])
+                throw (int)i;
+            for (int k = 0; dtStatusSucceed(status) && k < counts[0]; ++k)
+                if (!dtVequal(&buffers[0][k * 3], &buffers[1][k * 3]) || flags[0][k] != flags[1][k])
+                    throw (int)i;
+        }
+        FreeNavMeshQuery(arenaQuery);
+        if (!FreeNavMesh(arenaMesh))
+            throw "free";
+    }
+}
+
+void test_LoadNavMeshEx__POLY_GRID(dtNavMeshQuery *query)
+{
+    dtNavMesh *gridMesh;
+    dtNavMeshQuery *gridQuery;
+    if (!LoadNavMeshEx("zone078.nav", DT_LOAD_POLY_GRID, &gridMesh) || !CreateNavMeshQuery(gridMesh, &gridQuery))
+        throw 1;
+    int memory = 0;
+    if (dtStatusFailed(BuildPolyGrid(gridMesh, &memory)) || memory <= 0)
+        throw 2;
+    // poly centers, vertices shared by several polys and points off the mesh
+    std::vector<std::vector<float>> points;
+    for (int i = 0; i < navMesh->getMaxTiles(); ++i)
+    {
+        auto tile = ((dtNavMesh const *)navMesh)->getTile(i);
+        if (!tile->header)
+            continue;
+        for (int j = 0; j < tile->header->vertCount; j += 3)
+            points.push_back({tile->verts[j * 3], tile->verts[j * 3 + 1], tile->verts[j * 3 + 2]});
+    }
+    for (auto const &center : PolyCenters(1))
+    {
+        points.push_back(center);
+        points.push_back({center[0] + 40 * (float)FACTOR, center[1] + 90 * (float)FACTOR, center[2]});
+    }
+    // every vertex of the polys whose leaf starts on an odd quantum: the vertex truncates to the
+    // leaf bmin, which may be the first quantum of a cell, and the polys sharing it are all at
+    // distance zero, the grid must find the first one of the full search
+    for (int i = 0; i < navMesh->getMaxTiles(); ++i)
+    {
+        auto tile = ((dtNavMesh const *)navMesh)->getTile(i);
+        if (!tile->header || !tile->bvTree)
+            continue;
+        for (int j = 0; j < tile->header->bvNodeCount; ++j)
+        {
+            auto const &node = tile->bvTree[j];
+            if (node.i < 0 || !((node.bmin[0] | node.bmin[2]) & 1))
+                continue;
+            auto const &poly = tile->polys[node.i];
+            for (int k = 0; k < poly.vertCount; ++k)
+            {
+                auto vert = &tile->verts[poly.verts[k] * 3];
+                points.push_back({vert[0], vert[1], vert[2]});
+            }
+        }
+    }
+    float polyPick[] = {64 * FACTOR, 256 * FACTOR, 64 * FACTOR};
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+        dtPolyRef refs[2];
+        float results[2][3];
+        auto status = GetPolyAt(query, points[i].data(), polyPick, (unsigned short *)filter, &refs[0], results[0]);
+        auto gridStatus = GetPolyAt(gridQuery, points[i].data(), polyPick, (unsigned short *)filter, &refs[1], results[1]);
+        if (status != gridStatus || refs[0] != refs[1] || (refs[0] && !dtVequal(results[0], results[1])))
+            throw (int)i;
+    }
+    FreeNavMeshQuery(gridQuery);
+    FreeNavMesh(gridMesh);
+}
+
+// paths over the search graph must match the tile links, also after flag changes and tile updates
+void test_LoadNavMeshEx__SEARCH_GRAPH(dtNavMeshQuery *)
+{
+    dtNavMesh *graphMesh;
+    dtNavMeshQuery *graphQuery, *linkQuery;
+    if (!LoadNavMeshEx("zone078.nav", DT_LOAD_SEARCH_GRAPH, &graphMesh) || !CreateNavMeshQuery(graphMesh, &graphQuery) || !CreateNavMeshQuery(graphMesh, &linkQuery))
+        throw 1;
+    int memory = 0;
+    if (dtStatusFailed(BuildSearchGraph(graphMesh, &memory)) || memory <= 0 || !graphQuery->getSearchGraph())
+        throw 2;
+    linkQuery->setSearchGraph(nullptr);
+
+    dtQueryFilter queryFilter;
+    queryFilter.setIncludeFlags(filter[0]);
+    queryFilter.setExcludeFlags(filter[1]);
+    auto costFilter = queryFilter;
+    for (int area = 0; area < DT_MAX_AREAS; ++area)
+        costFilter.setAreaCost(area, 1.0f + area % 3);
+    if (!queryFilter.hasUnitAreaCosts() || costFilter.hasUnitAreaCosts())
+        throw 6;
+    float polyPick[] = {2 * FACTOR, 8 * FACTOR, 2 * FACTOR};
+    auto centers = PolyCenters(5);
+    auto compare = [&](int error)
+    {
+        for (size_t i = 1; i < centers.size(); i += 2)
+        {
+            dtPolyRef startRef, endRef;
+            linkQuery->findNearestPoly(centers[i - 1].data(), polyPick, &queryFilter, &startRef, nullptr);
+            linkQuery->findNearestPoly(centers[i].data(), polyPick, &queryFilter, &endRef, nullptr);
+            dtPolyRef paths[2][MAX_POLY];
+            int counts[2];
+            // unit area costs and the area cost table
+            for (auto pathFilter : {&queryFilter, &costFilter})
+            {
+                auto status = linkQuery->findPath(startRef, endRef, centers[i - 1].data(), centers[i].data(), pathFilter, paths[0], &counts[0], MAX_POLY);
+                auto graphStatus = graphQuery->findPath(startRef, endRef, centers[i - 1].data(), centers[i].data(), pathFilter, paths[1], &counts[1], MAX_POLY);
+                if (status != graphStatus || counts[0] != counts[1] || !std::equal(paths[0], paths[0] + counts[0], paths[1]))
+                    throw error + (int)i;
+            }
+        }
+    };
+    compare(1000);
+
+    // disable the middle poly of a long path
+    dtPolyRef startRef, endRef, path[MAX_POLY];
+    int count;
+    linkQuery->findNearestPoly(centers.front().data(), polyPick, &queryFilter, &startRef, nullptr);
+    linkQuery->findNearestPoly(centers.back().data(), polyPick, &queryFilter, &endRef, nullptr);
+    linkQuery->findPath(startRef, endRef, centers.front().data(), centers.back().data(), &queryFilter, path, &count, MAX_POLY);
+    if (count < 3)
+        throw 3;
+    unsigned short flags;
+    graphMesh->getPolyFlags(path[count / 2], &flags);
+    SetPolyFlags(graphMesh, path[count / 2], DISABLED);
+    compare(100000);
+    SetPolyFlags(graphMesh, path[count / 2], flags);
+
+    // remove a tile crossed by the path, then add it back
+    const dtMeshTile *tile;
+    const dtPoly *poly;
+    graphMesh->getTileAndPolyByRefUnsafe(path[count / 2], &tile, &poly);
+    auto tileRef = graphMesh->getTileRef(tile);
+    int x = tile->header->x, y = tile->header->y;
+    // the mesh frees the data of the removed tile
+    int dataSize = tile->dataSize;
+    auto data = (unsigned char *)dtAlloc(dataSize, DT_ALLOC_PERM);
+    std::memcpy(data, tile->data, dataSize);
+    auto searchGraph = const_cast<dtSearchGraph *>(graphQuery->getSearchGraph());
+    if (dtStatusFailed(graphMesh->removeTile(tileRef, nullptr, nullptr)) || dtStatusFailed(searchGraph->updateTilesAt(x, y)))
+        throw 4;
+    centers.erase(std::remove_if(centers.begin(), centers.end(), [&](std::vector<float> const &center)
+                                 {
+                                     dtPolyRef ref;
+                                     linkQuery->findNearestPoly(center.data(), polyPick, &queryFilter, &ref, nullptr);
+                                     return !ref; }),
+                  centers.end());
+    compare(200000);
+    if (dtStatusFailed(graphMesh->addTile(data, dataSize, DT_TILE_FREE_DATA, tileRef, nullptr)) || dtStatusFailed(searchGraph->updateTilesAt(x, y)))
+        throw 5;
+    centers = PolyCenters(5);
+    compare(300000);
+
+    FreeNavMeshQuery(linkQuery);
+    FreeNavMeshQuery(graphQuery);
+    FreeNavMesh(graphMesh);
+}
+
+void test_Trace(dtNavMeshQuery *query)
+{
+    auto file = (std::filesystem::temp_directory_path() / "detour_test.trace").string();
+    if (!StartTrace(file.c_str()) || StartTrace(file.c_str()))
+        throw 1;
+    auto centers = PolyCenters(29);
+    float polyPick[] = {2 * FACTOR, 8 * FACTOR, 2 * FACTOR};
+    std::vector<dtStatus> statuses;
+    for (size_t i = 1; i < centers.size(); ++i)
+    {
+        int pointCount;
+        float buffer[MAX_POLY * 3];
+        dtPolyFlags flags[MAX_POLY];
+        statuses.push_back(PathStraight(query, centers[i - 1].data(), centers[i].data(), polyPick, filter, DT_STRAIGHTPATH_ALL_CROSSINGS, &pointCount, buffer, flags));
+        dtPolyRef ref;
+        float point[3];
+        statuses.push_back(GetPolyAt(query, centers[i].data(), polyPick, (unsigned short *)filter, &ref, point));
+    }
+    // a failed call records no ref
+    float nowhere[] = {NAN, NAN, NAN};
+    dtPolyRef ref = 1;
+    float point[3];
+    auto failed = GetPolyAt(query, nowhere, polyPick, (unsigned short *)filter, &ref, point);
+    if (!dtStatusFailed(failed) || ref != 0)
+        throw 12;
+    if (!StopTrace() || StopTrace())
+        throw 2;
+
+    auto in = std::fopen(file.c_str(), "rb");
+    if (!in)
+        throw 3;
+    dtTraceFileHeader header;
+    if (std::fread(&header, sizeof(header), 1, in) != 1 || header.magic != DT_TRACE_MAGIC || header.version != DT_TRACE_VERSION || header.polyRefSize != sizeof(dtPolyRef))
+        throw 4;
+    size_t calls = 0;
+    int meshes = 0;
+    std::uint64_t sequence = 0;
+    dtTraceRecordHeader record;
+    while (std::fread(&record, sizeof(record), 1, in) == 1)
+    {
+        std::vector<unsigned char> payload(record.size);
+        if (record.size && std::fread(payload.data(), record.size, 1, in) != 1)
+            throw 5;
+        // single thread: the mesh comes first, the sequence follows the file
+        if (record.sequence != sequence++)
+            throw 10;
+        if (calls == statuses.size())
+        {
+            dtPolyRef recordedRef;
+            std::memcpy(&recordedRef, &payload[sizeof(float) * 6 + sizeof(dtPolyFlags) * 2], sizeof(recordedRef));
+            if (record.call != DT_TRACE_GET_POLY_AT || record.status != failed || recordedRef != 0)
+                throw 11;
+            ++calls;
+            continue;
+        }
+        if (record.call == DT_TRACE_MESH)
+        {
+            if (std::string(payload.begin(), payload.end()) != "zone078.nav")
+                throw 6;
+            ++meshes;
+            continue;
+        }
+        // single thread: the records are in call order
+        if (calls >= statuses.size() || record.call != (calls % 2 ? DT_TRACE_GET_POLY_AT : DT_TRACE_PATH_STRAIGHT) || record.status != statuses[calls])
+            throw 7;
+        float start[3];
+        std::memcpy(start, payload.data(), sizeof(start));
+        if (!dtVequal(start, centers[calls / 2 + (calls % 2)].data()))
+            throw 8;
+        ++calls;
+    }
+    std::fclose(in);
+    std::filesystem::remove(file);
+    if (meshes != 1 || calls != statuses.size() + 1)
+        throw 9;
+}
+
+void test_GameApi(dtNavMeshQuery *query)
+{
+    auto api = GetGameApi();
+    if (api->version != DT_GAME_API_VERSION || api->size != sizeof(dtGameApi))
+        throw "version";
+    dtGameQueryParams params = {{64, 64, 256}, defaultInclude, defaultExclude};
+    auto centers = PolyCenters(13);
+    for (size_t i = 1; i < centers.size(); ++i)
+    {
+        dtGameVector start, end;
+        dtDetourToGame(centers[i - 1].data(), &start.x);
+        dtDetourToGame(centers[i].data(), &end.x);
+        float from[3], to[3], polyPick[3];
+        dtGameToDetour(&start.x, from);
+        dtGameToDetour(&end.x, to);
+        dtGameExtentsToDetour(&params.extents.x, polyPick);
+
+        int pointCount, gamePointCount;
+        float pointBuffer[MAX_POLY * 3];
+        dtPolyFlags pointFlags[MAX_POLY];
+        dtGamePathPoint points[MAX_POLY];
+        auto status = PathStraight(query, from, to, polyPick, filter, DT_STRAIGHTPATH_ALL_CROSSINGS, &pointCount, pointBuffer, pointFlags);
+        auto gameStatus = api->pathStraight(query, &start, &end, &params, DT_STRAIGHTPATH_ALL_CROSSINGS, DT_PATH_DEFAULT, points, MAX_POLY, &gamePointCount);
+        if (status != gameStatus || (dtStatusSucceed(status) && pointCount != gamePointCount))
+            throw (int)i;
+        for (int k = 0; dtStatusSucceed(status) && k < pointCount; ++k)
+        {
+            float position[3];
+            dtDetourToGame(&pointBuffer[k * 3], position);
+            if (!dtVequal(position, &points[k].position.x) || points[k].flags != pointFlags[k])
+                throw (int)i;
+        }
+        // truncated to the caller span
+        if (dtStatusSucceed(status) && pointCount > 2)
+        {
+            gameStatus = GamePathStraight(query, &start, &end, &params, DT_STRAIGHTPATH_ALL_CROSSINGS, DT_PATH_DEFAULT, points, 2, &gamePointCount);
+            if (!dtStatusDetail(gameStatus, DT_BUFFER_TOO_SMALL) || gamePointCount != 2)
+                throw (int)i;
+        }
+
+        dtGameVector closest;
+        if (dtStatusFailed(api->findClosestPoint(query, &start, &params, &closest)) || std::fabs(closest.x - start.x) > 1 || std::fabs(closest.y - start.y) > 1)
+            throw (int)i;
+        int reachable;
+        if (dtStatusFailed(api->isReachable(query, &start, &end, &params, &reachable)) || (dtStatusSucceed(status) && !dtStatusDetail(status, DT_PARTIAL_RESULT) && !reachable))
+            throw (int)i;
+    }
+}
+
+void test_NavMeshInstance(dtNavMeshQuery *query)
+{
+    dtNavMeshInstance *instance;
+    dtNavMeshQuery *instanceQuery;
+    if (dtStatusFailed(CreateNavMeshInstance(navMesh, &instance)) || !CreateInstanceQuery(instance, &instanceQuery))
+        throw 0;
+
+    float start[] = {30893 * FACTOR, 15637 * FACTOR, 33758 * FACTOR};
+    float polyPick[] = {64 * FACTOR, 256 * FACTOR, 64 * FACTOR};
+    dtPolyRef ref;
+    float point[3];
+    GetPolyAt(query, start, polyPick, (unsigned short *)filter, &ref, point);
+    if (dtStatusFailed(SetInstancePolyFlags(instance, ref, DISABLED)))
+        throw 1;
+
+    // the shared navmesh keeps its flags, the instance sees its own
+    dtQueryFilter queryFilter;
+    queryFilter.setIncludeFlags(filter[0]);
+    queryFilter.setExcludeFlags(filter[1]);
+    unsigned short flags;
+    navMesh->getPolyFlags(ref, &flags);
+    if (flags != WALK || !query->isValidPolyRef(ref, &queryFilter))
+        throw 2;
+    if (dtStatusFailed(GetInstancePolyFlags(instance, ref, &flags)) || flags != DISABLED || instanceQuery->isValidPolyRef(ref, &queryFilter))
+        throw 3;
+
+    auto centers = PolyCenters(11);
+    for (size_t i = 1; i < centers.size(); ++i)
+    {
+        dtPolyRef startRef, endRef;
+        instanceQuery->findNearestPoly(centers[i - 1].data(), polyPick, &queryFilter, &startRef, nullptr);
+        instanceQuery->findNearestPoly(centers[i].data(), polyPick, &queryFilter, &endRef, nullptr);
+        if (startRef == ref || endRef == ref)
+            throw (int)i;
+        dtPolyRef path[MAX_POLY];
+        int pathCount = 0;
+        instanceQuery->findPath(startRef, endRef, centers[i - 1].data(), centers[i].data(), &queryFilter, path, &pathCount, MAX_POLY);
+        if (std::find(path, path + pathCount, ref) != path + pathCount)
+            throw (int)i;
+    }
+
+    FreeNavMeshQuery(instanceQuery);
+    FreeNavMeshInstance(instance);
+}
+
+// a door closed in the base zone: the instances that wrote its tile keep their copy, the others follow
+void test_NavMeshInstance__DOOR(dtNavMeshQuery *query)
+{
+    dtNavMeshInstance *reader, *writer;
+    dtNavMeshQuery *readerQuery, *writerQuery;
+    if (dtStatusFailed(CreateNavMeshInstance(navMesh, &reader)) || !CreateInstanceQuery(reader, &readerQuery) ||
+        dtStatusFailed(CreateNavMeshInstance(navMesh, &writer)) || !CreateInstanceQuery(writer, &writerQuery))
+        throw 0;
+
+    float start[] = {30893 * FACTOR, 15637 * FACTOR, 33758 * FACTOR};
+    float polyPick[] = {64 * FACTOR, 256 * FACTOR, 64 * FACTOR};
+    dtPolyRef ref;
+    float point[3];
+    GetPolyAt(query, start, polyPick, (unsigned short *)filter, &ref, point);
+    unsigned short baseFlags;
+    navMesh->getPolyFlags(ref, &baseFlags);
+    if (dtStatusFailed(SetInstancePolyFlags(writer, ref, baseFlags)) || dtStatusFailed(SetPolyFlags(navMesh, ref, DISABLED)))
+        throw 1;
+
+    dtQueryFilter queryFilter;
+    queryFilter.setIncludeFlags(filter[0]);
+    queryFilter.setExcludeFlags(filter[1]);
+    unsigned short flags;
+    if (dtStatusFailed(GetInstancePolyFlags(reader, ref, &flags)) || flags != DISABLED || readerQuery->isValidPolyRef(ref, &queryFilter))
+        throw 2;
+    if (dtStatusFailed(GetInstancePolyFlags(writer, ref, &flags)) || flags != baseFlags || !writerQuery->isValidPolyRef(ref, &queryFilter))
+        throw 3;
+    if (query->isValidPolyRef(ref, &queryFilter))
+        throw 4;
+
+    SetPolyFlags(navMesh, ref, baseFlags);
+    FreeNavMeshQuery(readerQuery);
+    FreeNavMeshQuery(writerQuery);
+    FreeNavMeshInstance(reader);
+    FreeNavMeshInstance(writer);
+}
+
+void test_TileLookup(dtNavMeshQuery *query)
+{
+    auto mesh = query->getAttachedNavMesh();
+    dtMeshTile const *source = nullptr;
+    for (int i = 0; i < mesh->getMaxTiles(); ++i)
+    {
+        auto tile = mesh->getTile(i);
+        if (!tile->header)
+            continue;
+        source = tile;
+        auto header = tile->header;
+        dtMeshTile const *tiles[8];
+        int count = mesh->getTilesAt(header->x, header->y, tiles, 8);
+        if (mesh->getTileAt(header->x, header->y, header->layer) != tile || std::find(tiles, tiles + count, tile) == tiles + count)
+            throw 1;
+        if (mesh->getTileRefAt(header->x, header->y, header->layer) != mesh->getTileRef(tile))
+            throw 2;
+    }
+    if (mesh->getTileAt(-1000, -1000, 0) || mesh->getTileAt(100000, 0, 0))
+        throw 3;
+
+    // copies of a tile, far enough apart for the dense grid to fall back to the hash
+    auto params = *mesh->getParams();
+    params.maxTiles = 4;
+    auto sparse = dtAllocNavMesh();
+    if (!source || dtStatusFailed(sparse->init(&params)))
+        throw 4;
+    int locations[][2] = {{0, 0}, {2, 0}, {1000, -1000}, {-5000, 70}};
+    for (auto const &location : locations)
+    {
+        auto data = (unsigned char *)dtAlloc(source->dataSize, DT_ALLOC_PERM);
+        std::memcpy(data, source->data, source->dataSize);
+        auto header = (dtMeshHeader *)data;
+        header->x = location[0];
+        header->y = location[1];
+        if (dtStatusFailed(sparse->addTile(data, source->dataSize, DT_TILE_FREE_DATA, 0, nullptr)))
+            throw 5;
+    }
+    for (auto const &location : locations)
+    {
+        auto tile = ((dtNavMesh const *)sparse)->getTileAt(location[0], location[1], source->header->layer);
+        if (!tile || tile->header->x != location[0] || tile->header->y != location[1])
+            throw 6;
+    }
+    if (((dtNavMesh const *)sparse)->getTileAt(1, 0, source->header->layer))
+        throw 7;
+    dtFreeNavMesh(sparse);
+}
+
+// closing the doors queues exactly the agents whose path crosses one, their repaired paths avoid them
+// (not threaded: the other threads would see the doors closed)
+void test_Agent__DOOR(dtNavMeshQuery *query)
+{
+    auto centers = PolyCenters(7);
+    float polyPick[] = {2 * FACTOR, 8 * FACTOR, 2 * FACTOR};
+    // the default filter lets agents through disabled polys
+    dtPolyFlags doorFilter[] = {defaultInclude, DISABLED};
+    int pointCount;
+    float pointBuffer[MAX_POLY * 3];
+    dtPolyFlags pointFlags[MAX_POLY];
+    std::vector<std::unique_ptr<dtNavAgent, decltype(&FreeAgent)>> agents;
+    std::vector<dtNavAgent *> crossing;
+    std::map<dtNavAgent *, float *> destinations;
+    for (size_t i = 1; i < centers.size(); i += 2)
+    {
+        dtNavAgent *agent;
+        if (!dtStatusSucceed(CreateAgent(query, centers[i - 1].data(), polyPick, doorFilter, &agent)))
+            throw (int)i;
+        agents.emplace_back(agent, FreeAgent);
+        destinations[agent] = centers[i].data();
+        if (dtStatusFailed(AgentPathStraight(query, agent, centers[i].data(), DT_STRAIGHTPATH_ALL_CROSSINGS, &pointCount, pointBuffer, pointFlags)))
+            continue;
+        if (std::any_of(pointFlags, pointFlags + pointCount, [](dtPolyFlags flags)
+                        { return (flags & DOOR) != 0; }))
+            crossing.push_back(agent);
+    }
+    if (crossing.empty())
+        throw 0;
+
+    auto doors = Doors();
+    for (auto door : doors)
+        SetPolyFlags(navMesh, door, WALK | DOOR | DISABLED);
+    std::vector<dtNavAgent *> blocked(agents.size() + 1);
+    blocked.resize(GetBlockedAgents(navMesh, blocked.data(), (int)blocked.size()));
+    std::sort(blocked.begin(), blocked.end());
+    std::sort(crossing.begin(), crossing.end());
+    if (blocked != crossing)
+        throw 1;
+    for (auto agent : blocked)
+    {
+        // the repaired path reaches the destination whenever a new one does
+        float start[3];
+        GetAgentPosition(agent, nullptr, start);
+        auto end = destinations[agent];
+        int fullCount;
+        float fullBuffer[MAX_POLY * 3];
+        dtPolyFlags fullFlags[MAX_POLY];
+        auto fullStatus = PathStraight(query, start, end, polyPick, doorFilter, DT_STRAIGHTPATH_ALL_CROSSINGS, &fullCount, fullBuffer, fullFlags);
+        auto status = AgentRepairPath(query, agent, DT_STRAIGHTPATH_ALL_CROSSINGS, &pointCount, pointBuffer, pointFlags);
+        if (dtStatusFailed(status))
+        {
+            if (dtStatusSucceed(fullStatus))
+                throw 2;
+            continue;
+        }
+        if (std::any_of(pointFlags + 1, pointFlags + pointCount, [](dtPolyFlags flags)
+                        { return (flags & DISABLED) != 0; }))
+            throw 3;
+        if (dtStatusSucceed(fullStatus) && dtVdist2D(&fullBuffer[(fullCount - 1) * 3], end) < 0.01f && dtVdist2D(&pointBuffer[(pointCount - 1) * 3], end) >= 0.01f)
+            throw 4;
+    }
+    if (GetBlockedAgents(navMesh, blocked.data(), (int)blocked.size()) != 0)
+        throw 5;
+    for (auto door : doors)
+        SetPolyFlags(navMesh, door, WALK | DOOR);
+    if (GetBlockedAgents(navMesh, blocked.data(), (int)blocked.size()) != 0)
+        throw 6;
+
+    // a gate in the open: the corridor is repaired around it
+    dtQueryFilter queryFilter;
+    queryFilter.setIncludeFlags(doorFilter[0]);
+    queryFilter.setExcludeFlags(doorFilter[1]);
+    float start[] = {30893 * FACTOR, 15637 * FACTOR, 33758 * FACTOR};
+    float end[] = {31095 * FACTOR, 15511 * FACTOR, 33902 * FACTOR};
+    float endPick[] = {64 * FACTOR, 256 * FACTOR, 64 * FACTOR};
+    dtPolyRef startRef, endRef, path[MAX_POLY];
+    int count;
+    query->findNearestPoly(start, endPick, &queryFilter, &startRef, nullptr);
+    query->findNearestPoly(end, endPick, &queryFilter, &endRef, nullptr);
+    query->findPath(startRef, endRef, start, end, &queryFilter, path, &count, MAX_POLY);
+    if (count < 3)
+        throw 7;
+    auto gate = path[count / 2];
+    unsigned short flags;
+    navMesh->getPolyFlags(gate, &flags);
+    SetPolyFlags(navMesh, gate, flags | DOOR);
+    dtNavAgent *agent;
+    if (!dtStatusSucceed(CreateAgent(query, start, endPick, doorFilter, &agent)))
+        throw 8;
+    agents.emplace_back(agent, FreeAgent);
+    AgentPathStraight(query, agent, end, DT_STRAIGHTPATH_ALL_CROSSINGS, &pointCount, pointBuffer, pointFlags);
+    SetPolyFlags(navMesh, gate, flags | DOOR | DISABLED);
+    auto blockedCount = GetBlockedAgents(navMesh, blocked.data(), (int)blocked.size());
+    auto status = AgentRepairPath(query, agent, DT_STRAIGHTPATH_ALL_CROSSINGS, &pointCount, pointBuffer, pointFlags);
+    SetPolyFlags(navMesh, gate, flags);
+    if (blockedCount != 1 || blocked[0] != agent || dtStatusFailed(status) || dtVdist2D(&pointBuffer[(pointCount - 1) * 3], end) > 0.1f)
+        throw 9;
+    if (std::any_of(pointFlags, pointFlags + pointCount, [](dtPolyFlags flags)
+                    { return (flags & DISABLED) != 0; }))
+        throw 10;
+}
+
+// a gate closed in an instance queues the agents of the instance, not the ones of the base zone
+void test_Agent__INSTANCE(dtNavMeshQuery *query)
+{
+    dtNavMeshInstance *instance;
+    dtNavMeshQuery *instanceQuery;
+    if (dtStatusFailed(CreateNavMeshInstance(navMesh, &instance)) || !CreateInstanceQuery(instance, &instanceQuery))
+        throw 0;
+    dtPolyFlags doorFilter[] = {defaultInclude, DISABLED};
+    dtQueryFilter queryFilter;
+    queryFilter.setIncludeFlags(doorFilter[0]);
+    queryFilter.setExcludeFlags(doorFilter[1]);
+    float start[] = {30893 * FACTOR, 15637 * FACTOR, 33758 * FACTOR};
+    float end[] = {31095 * FACTOR, 15511 * FACTOR, 33902 * FACTOR};
+    float polyPick[] = {64 * FACTOR, 256 * FACTOR, 64 * FACTOR};
+    dtPolyRef startRef, endRef, path[MAX_POLY];
+    int count;
+    query->findNearestPoly(start, polyPick, &queryFilter, &startRef, nullptr);
+    query->findNearestPoly(end, polyPick, &queryFilter, &endRef, nullptr);
+    query->findPath(startRef, endRef, start, end, &queryFilter, path, &count, MAX_POLY);
+    if (count < 3)
+        throw 1;
+    auto gate = path[count / 2];
+    unsigned short flags;
+    navMesh->getPolyFlags(gate, &flags);
+    SetInstancePolyFlags(instance, gate, flags | DOOR);
+
+    dtNavAgent *agent, *baseAgent;
+    if (!dtStatusSucceed(CreateAgent(instanceQuery, start, polyPick, doorFilter, &agent)) || !dtStatusSucceed(CreateAgent(query, start, polyPick, doorFilter, &baseAgent)))
+        throw 2;
+    int pointCount;
+    float pointBuffer[MAX_POLY * 3];
+    dtPolyFlags pointFlags[MAX_POLY];
+    AgentPathStraight(instanceQuery, agent, end, DT_STRAIGHTPATH_ALL_CROSSINGS, &pointCount, pointBuffer, pointFlags);
+    AgentPathStraight(query, baseAgent, end, DT_STRAIGHTPATH_ALL_CROSSINGS, &pointCount, pointBuffer, pointFlags);
+    SetInstancePolyFlags(instance, gate, flags | DOOR | DISABLED);
+    dtNavAgent *blocked[2];
+    auto blockedCount = GetInstanceBlockedAgents(instance, blocked, 2);
+    if (blockedCount != 1 || blocked[0] != agent || GetBlockedAgents(navMesh, blocked, 2) != 0)
+        throw 3;
+    auto status = AgentRepairPath(instanceQuery, agent, DT_STRAIGHTPATH_ALL_CROSSINGS, &pointCount, pointBuffer, pointFlags);
+    if (dtStatusFailed(status) || dtVdist2D(&pointBuffer[(pointCount - 1) * 3], end) > 0.1f)
+        throw 4;
+    if (std::any_of(pointFlags, pointFlags + pointCount, [](dtPolyFlags flags)
+                    { return (flags & DISABLED) != 0; }))
+        throw 5;
+
+    FreeAgent(agent);
+    FreeAgent(baseAgent);
+    FreeNavMeshQuery(instanceQuery);
+    FreeNavMeshInstance(instance);
+}
+
 int main(int ac, char const *const *av)
 {
     if (!std::filesystem::exists("./zone078.nav"))
@@ -90,6 +1371,13 @@ int main(int ac, char const *const *av)
         return 1;
     }
     std::cout << "OK" << std::endl;
+    std::cout << "Build landmarks: ";
+    if (!dtStatusSucceed(BuildLandmarks(navMesh, 8, nullptr)))
+    {
+        std::cout << "KO" << std::endl;
+        return 1;
+    }
+    std::cout << "OK" << std::endl;
     std::cout << "Create nav mesh query";
     if (!CreateNavMeshQuery(navMesh, &query))
     {
@@ -115,9 +1403,34 @@ int main(int ac, char const *const *av)
     } while (0)
 
     TEST(test_FindRandomPointAroundCircle);
+    TEST(test_FindRandomRoamPath);
     TEST(test_FindClosestPoint);
     TEST(test_PathStraight__AREA);
     TEST(test_PathStraight__ALL);
+    TEST(test_PathStraight__LANDMARKS);
+    TEST(test_PathStraight__RAYCAST);
+    TEST(test_PathStraight__SHORTCUT);
+    TEST(test_PathStraight__BUDGET);
+    TEST(test_FilterPreset);
+    TEST(test_FindRandomPointAroundCircle__BUDGET);
+    TEST(test_FlowField);
+    TEST(test_SpatialBatch);
+    TEST(test_MoveAlongSurfaceBatch);
+    TEST(test_SnapToGroundBatch);
+    TEST(test_Agent);
+    TEST(test_IsReachable);
+    TEST(test_GetTravelCosts);
+    TEST(test_IsReachable__DOOR);
+    TEST(test_Agent__DOOR);
+    TEST(test_Agent__INSTANCE);
+    TEST(test_GameApi);
+    TEST(test_NavMeshInstance);
+    TEST(test_NavMeshInstance__DOOR);
+    TEST(test_LoadNavMeshEx__ARENA);
+    TEST(test_LoadNavMeshEx__POLY_GRID);
+    TEST(test_LoadNavMeshEx__SEARCH_GRAPH);
+    TEST(test_TileLookup);
+    TEST(test_Trace);
 
     std::cout << "=== MULTIHREADS ===\n";
 
@@ -150,9 +1463,25 @@ int main(int ac, char const *const *av)
     } while (0)
 
     TEST_THREADED(test_FindRandomPointAroundCircle);
+    TEST_THREADED(test_FindRandomRoamPath);
     TEST_THREADED(test_FindClosestPoint);
     TEST_THREADED(test_PathStraight__AREA);
     TEST_THREADED(test_PathStraight__ALL);
+    TEST_THREADED(test_PathStraight__LANDMARKS);
+    TEST_THREADED(test_PathStraight__RAYCAST);
+    TEST_THREADED(test_PathStraight__SHORTCUT);
+    TEST_THREADED(test_PathStraight__BUDGET);
+    TEST_THREADED(test_FilterPreset);
+    TEST_THREADED(test_FindRandomPointAroundCircle__BUDGET);
+    TEST_THREADED(test_FlowField);
+    TEST_THREADED(test_SpatialBatch);
+    TEST_THREADED(test_MoveAlongSurfaceBatch);
+    TEST_THREADED(test_SnapToGroundBatch);
+    TEST_THREADED(test_Agent);
+    TEST_THREADED(test_IsReachable);
+    TEST_THREADED(test_GetTravelCosts);
+    TEST_THREADED(test_GameApi);
+    TEST_THREADED(test_NavMeshInstance);
 
     std::cout << "Free nav mesh query: ";
     if (!FreeNavMeshQuery(query))
@@ -0,0 +1,372 @@
+#include "dol_detour.hpp"
+#include "DetourNode.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#	include <linux/perf_event.h>
+#	include <sys/ioctl.h>
+#	include <sys/syscall.h>
+#	include <unistd.h>
+#endif
+
+// Path query benchmark: runs the same random start/end pairs through every search mode
+// and reports latency, expanded nodes, path lengths and data TLB / L1 cache misses per query.
+// Roaming NPCs are timed as a random point then a path against FindRandomRoamPath, and target
+// selection as one PathStraight per candidate against GetTravelCosts.
+//   detour_bench [file.nav] [queries] [default|arena|thp|hugetlb|grid|graph] [file.trace]
+// With a trace file the queries are recorded for detour_replay.
+
+static dtPolyFlags filter[] = {(dtPolyFlags)(ALL ^ DISABLED), (dtPolyFlags)0};
+static float polyPick[] = {2.0f, 8.0f, 2.0f};
+
+struct Pair
+{
+	float start[3];
+	float end[3];
+};
+
+// maxDistance limits the straight distance between start and end (chase queries)
+static std::vector<Pair> RandomPairs(dtNavMesh const *mesh, int count, float maxDistance)
+{
+	std::vector<std::vector<float>> centers;
+	for (int i = 0; i < mesh->getMaxTiles(); ++i)
+	{
+		auto tile = mesh->getTile(i);
+		if (!tile->header)
+			continue;
+		for (int j = 0; j < tile->header->polyCount; ++j)
+		{
+			auto const &poly = tile->polys[j];
+			if (poly.getType() != DT_POLYTYPE_GROUND || !(poly.flags & filter[0]) || (poly.flags & filter[1]))
+				continue;
+			std::vector<float> center(3, 0.0f);
+			for (int k = 0; k < poly.vertCount; ++k)
+				dtVadd(center.data(), center.data(), &tile->verts[poly.verts[k] * 3]);
+			dtVscale(center.data(), center.data(), 1.0f / poly.vertCount);
+			centers.push_back(center);
+		}
+	}
+
+	// independent of the poly order, so reordered navmeshes get the same pairs
+	std::sort(centers.begin(), centers.end());
+	std::mt19937 rng(78);
+	std::uniform_int_distribution<size_t> pick(0, centers.size() - 1);
+	std::vector<Pair> pairs(count);
+	for (auto &pair : pairs)
+	{
+		dtVcopy(pair.start, centers[pick(rng)].data());
+		do
+			dtVcopy(pair.end, centers[pick(rng)].data());
+		while (dtVdist(pair.start, pair.end) > maxDistance);
+	}
+	return pairs;
+}
+
+// hardware event count of this thread, n/a when perf events are not available (container, paranoid level)
+class PerfCounter
+{
+public:
+	PerfCounter(unsigned int type, unsigned long long config)
+	{
+		m_fd = -1;
+#ifdef __linux__
+		perf_event_attr attr;
+		std::memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = type;
+		attr.config = config;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		m_fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+		(void)type;
+		(void)config;
+#endif
+	}
+	~PerfCounter()
+	{
+#ifdef __linux__
+		if (m_fd >= 0)
+			close(m_fd);
+#endif
+	}
+	bool isAvailable() const { return m_fd >= 0; }
+	void start()
+	{
+#ifdef __linux__
+		if (m_fd >= 0)
+		{
+			ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+#endif
+	}
+	long long stop()
+	{
+		long long count = 0;
+#ifdef __linux__
+		if (m_fd >= 0)
+		{
+			ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+			if (read(m_fd, &count, sizeof(count)) != sizeof(count))
+				count = 0;
+		}
+#endif
+		return count;
+	}
+
+	// per query value for the report
+	void format(char *buffer, size_t size, long long count, size_t queries) const
+	{
+		if (isAvailable())
+			std::snprintf(buffer, size, "%.1f", (double)count / queries);
+		else
+			std::snprintf(buffer, size, "n/a");
+	}
+
+private:
+	int m_fd;
+};
+
+#ifdef __linux__
+static PerfCounter tlbCounter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+static PerfCounter cacheCounter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+#else
+static PerfCounter tlbCounter(0, 0);
+static PerfCounter cacheCounter(0, 0);
+#endif
+
+static float PathLength(int pointCount, float const *points)
+{
+	float length = 0;
+	for (int i = 1; i < pointCount; ++i)
+		length += dtVdist(&points[(i - 1) * 3], &points[i * 3]);
+	return length;
+}
+
+// GetPolyAt on the path ends, the nearest poly lookup of every PathStraight
+static void RunNearest(char const *name, dtNavMeshQuery *query, std::vector<Pair> const &pairs)
+{
+	std::vector<double> latencies;
+	int found = 0;
+	tlbCounter.start();
+	cacheCounter.start();
+	for (auto const &pair : pairs)
+	{
+		float center[3], point[3];
+		dtVcopy(center, pair.end);
+		dtPolyRef ref;
+		auto begin = std::chrono::steady_clock::now();
+		auto status = GetPolyAt(query, center, polyPick, (unsigned short *)filter, &ref, point);
+		latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count());
+		if (dtStatusSucceed(status) && ref)
+			++found;
+	}
+	auto cacheMisses = cacheCounter.stop();
+	auto tlbMisses = tlbCounter.stop();
+	std::sort(latencies.begin(), latencies.end());
+	double total = 0;
+	for (auto latency : latencies)
+		total += latency;
+	char tlb[16], cache[16];
+	tlbCounter.format(tlb, sizeof(tlb), tlbMisses, pairs.size());
+	cacheCounter.format(cache, sizeof(cache), cacheMisses, pairs.size());
+	std::printf("%-24s %10.2f %10.2f %10.2f %12s %8d %12s %10s %10s %10s %10s\n", name, total / latencies.size(), latencies[latencies.size() / 2], latencies[latencies.size() * 99 / 100],
+				"", found, "", "", "", tlb, cache);
+}
+
+static void Run(char const *name, dtNavMeshQuery *query, std::vector<Pair> const &pairs, dtPathOptions options)
+{
+	dtPathStats stats;
+	GetPathStats(&stats, true);
+	std::vector<double> latencies;
+	long long nodes = 0;
+	long long points = 0;
+	double length = 0;
+	int found = 0;
+	tlbCounter.start();
+	cacheCounter.start();
+	for (auto const &pair : pairs)
+	{
+		float start[3], end[3];
+		dtVcopy(start, pair.start);
+		dtVcopy(end, pair.end);
+		int pointCount;
+		float pointBuffer[MAX_POLY * 3];
+		dtPolyFlags pointFlags[MAX_POLY];
+		auto begin = std::chrono::steady_clock::now();
+		auto status = PathStraightEx(query, start, end, polyPick, filter, DT_STRAIGHTPATH_ALL_CROSSINGS, options, &pointCount, pointBuffer, pointFlags);
+		latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count());
+		if (dtStatusFailed(status))
+			continue;
+		if (!(options & DT_PATH_RAYCAST) || pointCount != 2)
+			nodes += query->getNodePool()->getNodeCount();
+		if (!dtStatusDetail(status, DT_PARTIAL_RESULT))
+		{
+			++found;
+			points += pointCount;
+			length += PathLength(pointCount, pointBuffer);
+		}
+	}
+	auto cacheMisses = cacheCounter.stop();
+	auto tlbMisses = tlbCounter.stop();
+	std::sort(latencies.begin(), latencies.end());
+	double total = 0;
+	for (auto latency : latencies)
+		total += latency;
+	GetPathStats(&stats, true);
+	char tlb[16], cache[16];
+	tlbCounter.format(tlb, sizeof(tlb), tlbMisses, pairs.size());
+	cacheCounter.format(cache, sizeof(cache), cacheMisses, pairs.size());
+	std::printf("%-24s %10.1f %10.1f %10.1f %12.1f %8d %12.1f %10.2f %9.1f%% %10s %10s\n", name, total / latencies.size(), latencies[latencies.size() / 2], latencies[latencies.size() * 99 / 100],
+				(double)nodes / pairs.size(), found, found ? length / found : 0.0, found ? (double)points / found : 0.0, stats.queries ? 100.0 * stats.raycastHits / stats.queries : 0.0, tlb, cache);
+}
+
+// NPC roaming from the path starts: random point then PathStraight against FindRandomRoamPath
+static void RunRoam(dtNavMeshQuery *query, std::vector<Pair> const &pairs)
+{
+	float radius = 1000.0f / 32.0f;
+	double separate = 0;
+	double single = 0;
+	int separateFound = 0;
+	int singleFound = 0;
+	for (auto const &pair : pairs)
+	{
+		float start[3], point[3];
+		dtVcopy(start, pair.start);
+		int pointCount;
+		float pointBuffer[MAX_POLY * 3];
+		dtPolyFlags pointFlags[MAX_POLY];
+		auto begin = std::chrono::steady_clock::now();
+		if (dtStatusSucceed(FindRandomPointAroundCircle(query, start, radius, polyPick, filter, point)) && dtStatusSucceed(PathStraight(query, start, point, polyPick, filter, DT_STRAIGHTPATH_ALL_CROSSINGS, &pointCount, pointBuffer, pointFlags)))
+			++separateFound;
+		auto middle = std::chrono::steady_clock::now();
+		if (dtStatusSucceed(FindRandomRoamPath(query, start, radius, polyPick, filter, DT_STRAIGHTPATH_ALL_CROSSINGS, point, &pointCount, pointBuffer, pointFlags)))
+			++singleFound;
+		auto end = std::chrono::steady_clock::now();
+		separate += std::chrono::duration<double, std::micro>(middle - begin).count();
+		single += std::chrono::duration<double, std::micro>(end - middle).count();
+	}
+	std::printf("%-24s %10.1f %10s %10s %12s %8d\n", "roam random+path", separate / pairs.size(), "", "", "", separateFound);
+	std::printf("%-24s %10.1f %10s %10s %12s %8d\n", "roam FindRandomRoamPath", single / pairs.size(), "", "", "", singleFound);
+}
+
+// target selection: the travel cost to the path ends within aggro range of each start, one
+// PathStraight per candidate against a single GetTravelCosts
+static void RunTravelCosts(dtNavMeshQuery *query, std::vector<Pair> const &pairs)
+{
+	const int maxTargets = 8;
+	const float range = 2000.0f / 32.0f;
+	double separate = 0;
+	double single = 0;
+	int sources = 0;
+	int separateFound = 0;
+	int singleFound = 0;
+	for (auto const &pair : pairs)
+	{
+		float start[3];
+		dtVcopy(start, pair.start);
+		float targets[maxTargets * 3];
+		int count = 0;
+		for (auto const &other : pairs)
+			if (count < maxTargets && dtVdist2D(start, other.end) < range)
+				dtVcopy(&targets[count++ * 3], other.end);
+		if (count < 2)
+			continue;
+		++sources;
+		int pointCount;
+		float pointBuffer[MAX_POLY * 3];
+		dtPolyFlags pointFlags[MAX_POLY];
+		auto begin = std::chrono::steady_clock::now();
+		for (int i = 0; i < count; ++i)
+		{
+			auto status = PathStraight(query, start, &targets[i * 3], polyPick, filter, DT_STRAIGHTPATH_ALL_CROSSINGS, &pointCount, pointBuffer, pointFlags);
+			if (dtStatusSucceed(status) && !dtStatusDetail(status, DT_PARTIAL_RESULT))
+				++separateFound;
+		}
+		auto middle = std::chrono::steady_clock::now();
+		float costs[maxTargets];
+		int best;
+		if (dtStatusSucceed(GetTravelCosts(query, start, count, targets, 0, polyPick, filter, DT_STRAIGHTPATH_ALL_CROSSINGS, costs, &best, &pointCount, pointBuffer, pointFlags)))
+			for (int i = 0; i < count; ++i)
+				if (costs[i] != FLT_MAX)
+					++singleFound;
+		auto end = std::chrono::steady_clock::now();
+		separate += std::chrono::duration<double, std::micro>(middle - begin).count();
+		single += std::chrono::duration<double, std::micro>(end - middle).count();
+	}
+	if (!sources)
+		return;
+	std::printf("%-24s %10.1f %10s %10s %12s %8d\n", "targets PathStraight", separate / sources, "", "", "", separateFound);
+	std::printf("%-24s %10.1f %10s %10s %12s %8d\n", "targets GetTravelCosts", single / sources, "", "", "", singleFound);
+}
+
+int main(int ac, char const *const *av)
+{
+	auto file = ac > 1 ? av[1] : "zone078.nav";
+	auto count = ac > 2 ? std::atoi(av[2]) : 2000;
+	std::string mode = ac > 3 ? av[3] : "default";
+	auto trace = ac > 4 ? av[4] : nullptr;
+	auto loadOptions = mode == "arena" ? DT_LOAD_ARENA : mode == "thp" ? DT_LOAD_HUGE_PAGES : mode == "hugetlb" ? DT_LOAD_EXPLICIT_HUGE_PAGES : mode == "grid" ? DT_LOAD_POLY_GRID : mode == "graph" ? DT_LOAD_SEARCH_GRAPH : DT_LOAD_DEFAULT;
+
+	dtNavMesh *mesh;
+	dtNavMeshQuery *query;
+	auto loadBegin = std::chrono::steady_clock::now();
+	if (!LoadNavMeshEx(file, loadOptions, &mesh) || !CreateNavMeshQuery(mesh, &query))
+	{
+		std::fprintf(stderr, "cannot load %s\n", file);
+		return 1;
+	}
+	std::printf("load %s: %.1fms\n", mode.c_str(), std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadBegin).count());
+	int gridMemory;
+	if (loadOptions & DT_LOAD_POLY_GRID && dtStatusSucceed(BuildPolyGrid(mesh, &gridMemory)))
+		std::printf("poly grid: %d bytes\n", gridMemory);
+	int graphMemory;
+	if (loadOptions & DT_LOAD_SEARCH_GRAPH && dtStatusSucceed(BuildSearchGraph(mesh, &graphMemory)))
+		std::printf("search graph: %d bytes\n", graphMemory);
+	auto pairs = RandomPairs(mesh, count, FLT_MAX);
+	// chases: targets less than 500 game units away
+	auto shortPairs = RandomPairs(mesh, count, 500.0f / 32.0f);
+
+	if (trace && !StartTrace(trace))
+	{
+		std::fprintf(stderr, "cannot write %s\n", trace);
+		return 1;
+	}
+	std::printf("%-24s %10s %10s %10s %12s %8s %12s %10s %10s %10s %10s\n", "mode", "avg (us)", "p50 (us)", "p99 (us)", "avg nodes", "found", "avg length", "avg points", "raycast", "dTLB miss", "L1d miss");
+	RunNearest("GetPolyAt", query, pairs);
+	Run("PathStraight", query, pairs, DT_PATH_DEFAULT);
+	Run("keep collinear", query, pairs, DT_PATH_KEEP_COLLINEAR);
+	Run("shortcut", query, pairs, DT_PATH_SHORTCUT);
+	Run("short", query, shortPairs, DT_PATH_DEFAULT);
+	Run("short raycast", query, shortPairs, DT_PATH_RAYCAST);
+	RunRoam(query, pairs);
+	RunTravelCosts(query, pairs);
+	for (int landmarkCount : {4, 8, 16})
+	{
+		int memory;
+		auto begin = std::chrono::steady_clock::now();
+		if (dtStatusFailed(BuildLandmarks(mesh, landmarkCount, &memory)))
+			continue;
+		auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+		auto name = "landmarks K=" + std::to_string(landmarkCount);
+		Run(name.c_str(), query, pairs, DT_PATH_LANDMARKS);
+		std::printf("%24s build %.1fms, %d bytes\n", "", elapsed, memory);
+	}
+
+	if (trace)
+		StopTrace();
+	FreeNavMeshQuery(query);
+	FreeNavMesh(mesh);
+	return 0;
+}
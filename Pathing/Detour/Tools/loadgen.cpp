@@ -0,0 +1,465 @@
+#include "dol_detour.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __linux__
+#	include <unistd.h>
+#endif
+
+// Pathing load generator: simulates N mobs on a navmesh with the behaviour of StandardMobBrain and
+// PathCalculator, through the exported API, and reports whether the box keeps up with real time.
+//   detour_loadgen [file.nav] [agents,agents,...] [threads] [simulated seconds] [roam %] [door toggles/s]
+// Roamers pick a random point around them (FindRandomPointAroundCircle) and walk there, the others
+// chase a moving target, replot when it drifted more than 80 units and walk back to their spawn once
+// leashed. Doors are toggled with SetPolyFlags while the mobs path. The simulation runs as fast as
+// possible, a real time factor above 1 means that many mobs fit on this many threads.
+
+static auto const FACTOR = 1.0f / 32.0f;
+
+// simulation step, the PathCalculator follow check
+static const float TICK = 0.5f;
+// StandardMobBrain.ThinkInterval of an aggressive mob
+static const float THINK_INTERVAL = 1.5f;
+// GAMENPC_RANDOMWALK_CHANCE
+static const int RANDOMWALK_CHANCE = 20;
+// polys between a chaser and the target it pulls
+static const int PULL_DISTANCE = 8;
+// chance per think that a chaser pulls a new target
+static const int AGGRO_CHANCE = 10;
+static const float ROAMING_RANGE = 500 * FACTOR;
+// PathCalculator.MIN_PATHING_DISTANCE and MIN_TARGET_DIFF_REPLOT_DISTANCE
+static const float MIN_PATHING_DISTANCE = 80 * FACTOR;
+static const float REPLOT_DISTANCE = 80 * FACTOR;
+// GameNPC.CONST_WALKTOTOLERANCE
+static const float WALK_TOLERANCE = 25 * FACTOR;
+static const float LEASH_DISTANCE = 3000 * FACTOR;
+static const float MAX_CHASE_TIME = 30.0f;
+static const float MOB_SPEED = 200 * FACTOR;
+static const float PLAYER_SPEED = 191 * FACTOR;
+
+static dtPolyFlags filter[] = {(dtPolyFlags)(ALL ^ DISABLED), (dtPolyFlags)0};
+// LocalPathingMgr extents
+static float polyPickPath[] = {2.0f, 2.0f, 8.0f};
+static float polyPickRandom[] = {2.0f, 4.0f, 2.0f};
+
+enum Behaviour
+{
+	ROAM,
+	CHASE
+};
+
+enum State
+{
+	IDLE,
+	WALKING,
+	CHASING,
+	RETURNING
+};
+
+enum Query
+{
+	QUERY_PATH,
+	QUERY_RANDOM,
+	QUERY_DOOR,
+	QUERY_COUNT
+};
+
+struct Agent
+{
+	Behaviour behaviour;
+	State state;
+	int spawnPoly;
+	float spawn[3];
+	float pos[3];
+	std::vector<float> path;
+	size_t pathIndex;
+	float nextThink;
+	// chase target, a player running from poly center to poly center
+	float target[3];
+	int targetPoly;
+	float lastTarget[3];
+	float chaseEnd;
+};
+
+// centers of the walkable ground polys and their links, mobs spawn on the centers and chase
+// targets run from center to linked center, which keeps them on the mesh without any query
+class PolyGraph
+{
+public:
+	explicit PolyGraph(dtNavMesh const *mesh)
+	{
+		std::unordered_map<dtPolyRef, int> indices;
+		for (int i = 0; i < mesh->getMaxTiles(); ++i)
+		{
+			auto tile = mesh->getTile(i);
+			if (!tile->header)
+				continue;
+			for (int j = 0; j < tile->header->polyCount; ++j)
+			{
+				auto const &poly = tile->polys[j];
+				if (poly.getType() != DT_POLYTYPE_GROUND || !(poly.flags & filter[0]) || (poly.flags & DISABLED))
+					continue;
+				float center[3] = {0, 0, 0};
+				for (int k = 0; k < poly.vertCount; ++k)
+					dtVadd(center, center, &tile->verts[poly.verts[k] * 3]);
+				dtVscale(center, center, 1.0f / poly.vertCount);
+				indices[mesh->getPolyRefBase(tile) | (dtPolyRef)j] = (int)m_refs.size();
+				m_refs.push_back(mesh->getPolyRefBase(tile) | (dtPolyRef)j);
+				m_centers.insert(m_centers.end(), center, center + 3);
+			}
+		}
+		m_links.resize(m_refs.size());
+		for (size_t i = 0; i < m_refs.size(); ++i)
+		{
+			dtMeshTile const *tile;
+			dtPoly const *poly;
+			mesh->getTileAndPolyByRefUnsafe(m_refs[i], &tile, &poly);
+			for (auto link = poly->firstLink; link != DT_NULL_LINK; link = tile->links[link].next)
+			{
+				auto neighbour = indices.find(tile->links[link].ref);
+				if (neighbour != indices.end())
+					m_links[i].push_back(neighbour->second);
+			}
+		}
+	}
+
+	bool empty() const { return m_refs.empty(); }
+
+	int any(std::mt19937 &rng) const
+	{
+		return std::uniform_int_distribution<int>(0, (int)m_refs.size() - 1)(rng);
+	}
+
+	// a random linked poly, the poly itself when it has none
+	int next(int index, std::mt19937 &rng) const
+	{
+		auto const &links = m_links[index];
+		return links.empty() ? index : links[std::uniform_int_distribution<size_t>(0, links.size() - 1)(rng)];
+	}
+
+	float const *center(int index) const { return &m_centers[index * 3]; }
+
+private:
+	std::vector<dtPolyRef> m_refs;
+	std::vector<float> m_centers;
+	std::vector<std::vector<int>> m_links;
+};
+
+struct ThreadResult
+{
+	std::vector<float> latencies[QUERY_COUNT];
+	int failures = 0;
+	// paths to targets on another island, answered without a search
+	int unreachable = 0;
+	double seconds = 0;
+};
+
+class Simulation
+{
+public:
+	Simulation(dtNavMesh *mesh, dtNavMeshQuery *query, PolyGraph const &graph, std::vector<dtPolyRef> const &doors, unsigned int seed)
+		: m_mesh(mesh), m_query(query), m_graph(graph), m_doors(doors), m_rng(seed)
+	{
+	}
+
+	void addAgent(Behaviour behaviour)
+	{
+		Agent agent = {};
+		agent.behaviour = behaviour;
+		agent.state = IDLE;
+		agent.spawnPoly = m_graph.any(m_rng);
+		dtVcopy(agent.spawn, m_graph.center(agent.spawnPoly));
+		dtVcopy(agent.pos, agent.spawn);
+		// mobs do not all think on the same tick
+		agent.nextThink = std::uniform_real_distribution<float>(0, THINK_INTERVAL)(m_rng);
+		m_agents.push_back(agent);
+	}
+
+	void run(float seconds, float doorToggles, ThreadResult &result)
+	{
+		m_result = &result;
+		float doorBudget = 0;
+		auto begin = std::chrono::steady_clock::now();
+		for (m_time = 0; m_time < seconds; m_time += TICK)
+		{
+			for (doorBudget += doorToggles * TICK; doorBudget >= 1 && !m_doors.empty(); doorBudget -= 1)
+				toggleDoor();
+			for (auto &agent : m_agents)
+				update(agent);
+		}
+		result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+	}
+
+private:
+	bool pathTo(Agent &agent, float const *destination)
+	{
+		if (dtVdist(agent.pos, destination) < MIN_PATHING_DISTANCE)
+			return false;
+		int pointCount = 0;
+		float points[MAX_POLY * 3];
+		dtPolyFlags flags[MAX_POLY];
+		float start[3], end[3];
+		dtVcopy(start, agent.pos);
+		dtVcopy(end, destination);
+		auto begin = std::chrono::steady_clock::now();
+		auto status = PathStraight(m_query, start, end, polyPickPath, filter, DT_STRAIGHTPATH_ALL_CROSSINGS, &pointCount, points, flags);
+		record(QUERY_PATH, begin);
+		if (dtStatusFailed(status) || pointCount == 0)
+		{
+			++(dtStatusDetail(status, DT_UNREACHABLE) ? m_result->unreachable : m_result->failures);
+			return false;
+		}
+		agent.path.assign(points, points + pointCount * 3);
+		agent.pathIndex = 0;
+		return true;
+	}
+
+	void toggleDoor()
+	{
+		auto index = std::uniform_int_distribution<size_t>(0, m_doors.size() - 1)(m_rng);
+		auto begin = std::chrono::steady_clock::now();
+		unsigned short flags;
+		if (dtStatusSucceed(m_mesh->getPolyFlags(m_doors[index], &flags)))
+			SetPolyFlags(m_mesh, m_doors[index], flags ^ DISABLED);
+		record(QUERY_DOOR, begin);
+	}
+
+	void record(Query query, std::chrono::steady_clock::time_point begin)
+	{
+		m_result->latencies[query].push_back(std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - begin).count());
+	}
+
+	// walks the path for one tick, returns true when the end is reached
+	static bool walk(Agent &agent, float distance)
+	{
+		while (agent.pathIndex * 3 < agent.path.size())
+		{
+			auto waypoint = &agent.path[agent.pathIndex * 3];
+			auto left = dtVdist(agent.pos, waypoint);
+			if (left > distance)
+			{
+				dtVlerp(agent.pos, agent.pos, waypoint, distance / left);
+				return false;
+			}
+			dtVcopy(agent.pos, waypoint);
+			distance -= left;
+			++agent.pathIndex;
+		}
+		return true;
+	}
+
+	void moveTarget(Agent &agent)
+	{
+		auto goal = m_graph.center(agent.targetPoly);
+		auto left = dtVdist(agent.target, goal);
+		if (left <= PLAYER_SPEED * TICK)
+		{
+			dtVcopy(agent.target, goal);
+			agent.targetPoly = m_graph.next(agent.targetPoly, m_rng);
+		}
+		else
+			dtVlerp(agent.target, agent.target, goal, PLAYER_SPEED * TICK / left);
+	}
+
+	void returnHome(Agent &agent)
+	{
+		agent.state = pathTo(agent, agent.spawn) ? RETURNING : IDLE;
+		if (agent.state == IDLE)
+			dtVcopy(agent.pos, agent.spawn);
+	}
+
+	void update(Agent &agent)
+	{
+		switch (agent.state)
+		{
+		case WALKING:
+		case RETURNING:
+			if (walk(agent, MOB_SPEED * TICK))
+				agent.state = IDLE;
+			break;
+		case CHASING:
+			moveTarget(agent);
+			if (m_time >= agent.chaseEnd || dtVdist(agent.pos, agent.spawn) > LEASH_DISTANCE)
+			{
+				returnHome(agent);
+				break;
+			}
+			// PathCalculator.PathToInternal
+			if (dtVdist(agent.target, agent.lastTarget) > REPLOT_DISTANCE)
+			{
+				dtVcopy(agent.lastTarget, agent.target);
+				pathTo(agent, agent.target);
+			}
+			walk(agent, MOB_SPEED * TICK);
+			break;
+		case IDLE:
+			break;
+		}
+
+		if (m_time < agent.nextThink)
+			return;
+		agent.nextThink += THINK_INTERVAL;
+		if (agent.state != IDLE)
+			return;
+		std::uniform_int_distribution<int> chance(0, 99);
+		if (agent.behaviour == CHASE && chance(m_rng) < AGGRO_CHANCE)
+		{
+			agent.state = CHASING;
+			agent.chaseEnd = m_time + MAX_CHASE_TIME;
+			// chasers are only idle at their spawn
+			agent.targetPoly = agent.spawnPoly;
+			for (int i = 0; i < PULL_DISTANCE; ++i)
+				agent.targetPoly = m_graph.next(agent.targetPoly, m_rng);
+			dtVcopy(agent.target, m_graph.center(agent.targetPoly));
+			dtVcopy(agent.lastTarget, agent.target);
+			pathTo(agent, agent.target);
+		}
+		else if (agent.behaviour == ROAM && chance(m_rng) < RANDOMWALK_CHANCE)
+		{
+			// StandardMobBrain.GetRandomWalkTarget
+			float center[3], point[3];
+			dtVcopy(center, agent.pos);
+			auto begin = std::chrono::steady_clock::now();
+			auto status = FindRandomPointAroundCircle(m_query, center, ROAMING_RANGE, polyPickRandom, filter, point);
+			record(QUERY_RANDOM, begin);
+			if (dtStatusFailed(status))
+				++m_result->failures;
+			else if (pathTo(agent, point))
+				agent.state = WALKING;
+		}
+		else if (dtVdist(agent.pos, agent.spawn) > WALK_TOLERANCE)
+			returnHome(agent);
+	}
+
+	dtNavMesh *m_mesh;
+	dtNavMeshQuery *m_query;
+	PolyGraph const &m_graph;
+	std::vector<dtPolyRef> const &m_doors;
+	std::mt19937 m_rng;
+	std::vector<Agent> m_agents;
+	ThreadResult *m_result = nullptr;
+	float m_time = 0;
+};
+
+static double ResidentMegabytes()
+{
+#ifdef __linux__
+	long pages = 0, resident = 0;
+	auto statm = std::fopen("/proc/self/statm", "r");
+	if (!statm)
+		return 0;
+	if (std::fscanf(statm, "%ld %ld", &pages, &resident) != 2)
+		resident = 0;
+	std::fclose(statm);
+	return resident * (double)sysconf(_SC_PAGESIZE) / (1024 * 1024);
+#else
+	return 0;
+#endif
+}
+
+static float Percentile(std::vector<float> &values, double percentile)
+{
+	if (values.empty())
+		return 0;
+	auto nth = values.begin() + (size_t)(percentile * (values.size() - 1));
+	std::nth_element(values.begin(), nth, values.end());
+	return *nth;
+}
+
+int main(int ac, char const *const *av)
+{
+	auto file = ac > 1 ? av[1] : "zone078.nav";
+	std::vector<int> agentCounts;
+	std::stringstream counts(ac > 2 ? av[2] : "100,500,1000,2000,5000");
+	for (std::string count; std::getline(counts, count, ',');)
+		agentCounts.push_back(std::atoi(count.c_str()));
+	int threadCount = ac > 3 ? std::atoi(av[3]) : (int)std::max(1u, std::thread::hardware_concurrency());
+	float seconds = ac > 4 ? (float)std::atof(av[4]) : 60.0f;
+	int roamPercent = ac > 5 ? std::atoi(av[5]) : 70;
+	float doorToggles = ac > 6 ? (float)std::atof(av[6]) : 1.0f;
+	threadCount = std::max(1, threadCount);
+
+	dtNavMesh *mesh;
+	if (!LoadNavMesh(file, &mesh))
+	{
+		std::fprintf(stderr, "cannot load %s\n", file);
+		return 1;
+	}
+	PolyGraph graph(mesh);
+	if (graph.empty())
+	{
+		std::fprintf(stderr, "%s has no walkable polys\n", file);
+		return 1;
+	}
+	std::vector<dtPolyRef> doors;
+	for (int i = 0; i < mesh->getMaxTiles(); ++i)
+	{
+		auto tile = ((dtNavMesh const *)mesh)->getTile(i);
+		if (!tile->header)
+			continue;
+		for (int j = 0; j < tile->header->polyCount; ++j)
+			if (tile->polys[j].flags & DOOR)
+				doors.push_back(mesh->getPolyRefBase(tile) | (dtPolyRef)j);
+	}
+	std::vector<dtNavMeshQuery *> queries(threadCount);
+	for (auto &query : queries)
+		if (!CreateNavMeshQuery(mesh, &query))
+		{
+			std::fprintf(stderr, "cannot create a query\n");
+			return 1;
+		}
+
+	std::printf("%s: %d threads, %.0f simulated seconds, %d%% roamers, %d doors toggled %.1f/s\n", file, threadCount, seconds, roamPercent, (int)doors.size(), doors.empty() ? 0.0f : doorToggles);
+	std::printf("%8s %10s %10s %10s %10s %10s %10s %10s %10s %8s %8s %10s\n", "agents", "real time", "queries", "demand/s", "sustained", "p50 (us)", "p99 (us)", "p99.9 (us)", "door p99", "unreach", "failed", "RSS (MB)");
+	for (auto agentCount : agentCounts)
+	{
+		// each thread owns its mobs and its query, as a server thread does with its regions
+		std::vector<std::unique_ptr<Simulation>> simulations;
+		for (int t = 0; t < threadCount; ++t)
+			simulations.emplace_back(new Simulation(mesh, queries[t], graph, doors, 78 + t));
+		std::mt19937 rng(78);
+		for (int i = 0; i < agentCount; ++i)
+			simulations[i % threadCount]->addAgent(std::uniform_int_distribution<int>(0, 99)(rng) < roamPercent ? ROAM : CHASE);
+
+		std::vector<ThreadResult> results(threadCount);
+		std::vector<std::thread> threads;
+		for (int t = 0; t < threadCount; ++t)
+			threads.emplace_back([&, t]
+								 { simulations[t]->run(seconds, t == 0 ? doorToggles : 0.0f, results[t]); });
+		for (auto &thread : threads)
+			thread.join();
+
+		double wall = 0;
+		int failures = 0;
+		int unreachable = 0;
+		std::vector<float> latencies, doorLatencies;
+		for (auto &result : results)
+		{
+			wall = std::max(wall, result.seconds);
+			failures += result.failures;
+			unreachable += result.unreachable;
+			latencies.insert(latencies.end(), result.latencies[QUERY_PATH].begin(), result.latencies[QUERY_PATH].end());
+			latencies.insert(latencies.end(), result.latencies[QUERY_RANDOM].begin(), result.latencies[QUERY_RANDOM].end());
+			doorLatencies.insert(doorLatencies.end(), result.latencies[QUERY_DOOR].begin(), result.latencies[QUERY_DOOR].end());
+		}
+		auto queryCount = latencies.size() + doorLatencies.size();
+		std::printf("%8d %9.1fx %10d %10.0f %10.0f %10.1f %10.1f %10.1f %10.1f %8d %8d %10.1f\n", agentCount, wall > 0 ? seconds / wall : 0.0, (int)queryCount, queryCount / seconds, wall > 0 ? queryCount / wall : 0.0,
+					Percentile(latencies, 0.5), Percentile(latencies, 0.99), Percentile(latencies, 0.999), Percentile(doorLatencies, 0.99), unreachable, failures, ResidentMegabytes());
+	}
+
+	for (auto query : queries)
+		FreeNavMeshQuery(query);
+	FreeNavMesh(mesh);
+	return 0;
+}
@@ -0,0 +1,279 @@
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshBuilder.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <vector>
+
+// Offline navmesh optimizer: reorders the polys of every tile along a Morton curve so that
+// neighbouring polys are close in memory, reorders the vertices and detail meshes in the same
+// order, then rebuilds the BV tree with the builder code. The geometry is unchanged.
+//   navmesh-optimize input.nav output.nav
+
+struct NavMeshSetHeader
+{
+	std::int32_t magic;
+	std::int32_t version;
+	std::int32_t numTiles;
+	dtNavMeshParams params;
+};
+
+struct NavMeshTileHeader
+{
+	dtTileRef ref;
+	std::int32_t size;
+};
+
+// pointers into the tile data, same layout as dtNavMesh::addTile
+struct TileData
+{
+	dtMeshHeader *header;
+	float *verts;
+	dtPoly *polys;
+	dtPolyDetail *detailMeshes;
+	float *detailVerts;
+	unsigned char *detailTris;
+	dtBVNode *bvTree;
+};
+
+static TileData GetTileData(unsigned char *data)
+{
+	TileData tile;
+	tile.header = (dtMeshHeader *)data;
+	auto header = tile.header;
+	auto d = data + dtAlign4(sizeof(dtMeshHeader));
+	tile.verts = (float *)d;
+	d += dtAlign4(sizeof(float) * 3 * header->vertCount);
+	tile.polys = (dtPoly *)d;
+	d += dtAlign4(sizeof(dtPoly) * header->polyCount);
+	d += dtAlign4(sizeof(dtLink) * header->maxLinkCount);
+	tile.detailMeshes = (dtPolyDetail *)d;
+	d += dtAlign4(sizeof(dtPolyDetail) * header->detailMeshCount);
+	tile.detailVerts = (float *)d;
+	d += dtAlign4(sizeof(float) * 3 * header->detailVertCount);
+	tile.detailTris = d;
+	d += dtAlign4(sizeof(unsigned char) * 4 * header->detailTriCount);
+	tile.bvTree = (dtBVNode *)d;
+	return tile;
+}
+
+static std::uint32_t Part1By1(std::uint32_t x)
+{
+	x &= 0xffff;
+	x = (x | (x << 8)) & 0x00ff00ff;
+	x = (x | (x << 4)) & 0x0f0f0f0f;
+	x = (x | (x << 2)) & 0x33333333;
+	x = (x | (x << 1)) & 0x55555555;
+	return x;
+}
+
+static unsigned short Quantize(float value, float base, float factor)
+{
+	return (unsigned short)dtClamp((int)((value - base) * factor), 0, 0xffff);
+}
+
+// detail vertex j of poly i, the first poly->vertCount ones are the poly vertices
+static float const *DetailVertex(TileData const &tile, int i, int j)
+{
+	auto const &poly = tile.polys[i];
+	if (j < poly.vertCount)
+		return &tile.verts[poly.verts[j] * 3];
+	return &tile.detailVerts[(tile.detailMeshes[i].vertBase + j - poly.vertCount) * 3];
+}
+
+// quantized bounds of the ground polys, as computed by dtCreateNavMeshData from the detail mesh
+static void GetPolyBounds(TileData const &tile, int i, unsigned short *bounds)
+{
+	auto const &poly = tile.polys[i];
+	int count = poly.vertCount + (tile.header->detailMeshCount ? tile.detailMeshes[i].vertCount : 0);
+	float bmin[3], bmax[3];
+	dtVcopy(bmin, DetailVertex(tile, i, 0));
+	dtVcopy(bmax, bmin);
+	for (int j = 1; j < count; ++j)
+	{
+		dtVmin(bmin, DetailVertex(tile, i, j));
+		dtVmax(bmax, DetailVertex(tile, i, j));
+	}
+	auto header = tile.header;
+	for (int k = 0; k < 3; ++k)
+	{
+		bounds[k] = Quantize(bmin[k], header->bmin[k], header->bvQuantFactor);
+		bounds[3 + k] = Quantize(bmax[k], header->bmin[k], header->bvQuantFactor);
+	}
+}
+
+// mean distance between the indices of internally linked polys, lower is better
+static double LinkSpread(TileData const &tile)
+{
+	double total = 0;
+	long long count = 0;
+	for (int i = 0; i < tile.header->polyCount; ++i)
+	{
+		auto const &poly = tile.polys[i];
+		for (int j = 0; j < poly.vertCount; ++j)
+			if (poly.neis[j] && !(poly.neis[j] & DT_EXT_LINK))
+			{
+				total += std::abs(i - (poly.neis[j] - 1));
+				++count;
+			}
+	}
+	return count ? total / count : 0.0;
+}
+
+static void OptimizeTile(TileData const &tile)
+{
+	auto header = tile.header;
+	// off-mesh connection polys stay at the end, dtOffMeshConnection::poly refers to them
+	int groundCount = header->offMeshBase;
+	if (groundCount <= 1)
+		return;
+
+	// new order of the ground polys: Morton code of the centroid on the horizontal plane
+	std::vector<std::uint32_t> keys(groundCount);
+	for (int i = 0; i < groundCount; ++i)
+	{
+		auto const &poly = tile.polys[i];
+		float center[3] = {0, 0, 0};
+		for (int j = 0; j < poly.vertCount; ++j)
+			dtVadd(center, center, &tile.verts[poly.verts[j] * 3]);
+		dtVscale(center, center, 1.0f / poly.vertCount);
+		keys[i] = Part1By1(Quantize(center[0], header->bmin[0], header->bvQuantFactor)) | (Part1By1(Quantize(center[2], header->bmin[2], header->bvQuantFactor)) << 1);
+	}
+	std::vector<int> order(header->polyCount);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.begin() + groundCount, [&](int a, int b)
+					 { return keys[a] < keys[b]; });
+	std::vector<int> newIndex(header->polyCount);
+	for (int i = 0; i < header->polyCount; ++i)
+		newIndex[order[i]] = i;
+
+	// polys and detail meshes, detail vertices and triangles are packed in the new order
+	std::vector<dtPoly> polys(tile.polys, tile.polys + header->polyCount);
+	std::vector<dtPolyDetail> detailMeshes(tile.detailMeshes, tile.detailMeshes + header->detailMeshCount);
+	std::vector<float> detailVerts(tile.detailVerts, tile.detailVerts + header->detailVertCount * 3);
+	std::vector<unsigned char> detailTris(tile.detailTris, tile.detailTris + header->detailTriCount * 4);
+	unsigned int vertBase = 0;
+	unsigned int triBase = 0;
+	for (int i = 0; i < header->polyCount; ++i)
+	{
+		auto &poly = tile.polys[i];
+		poly = polys[order[i]];
+		for (int j = 0; j < poly.vertCount; ++j)
+			if (poly.neis[j] && !(poly.neis[j] & DT_EXT_LINK))
+				poly.neis[j] = (unsigned short)(newIndex[poly.neis[j] - 1] + 1);
+		if (i >= header->detailMeshCount)
+			continue;
+		auto &detail = tile.detailMeshes[i];
+		detail = detailMeshes[order[i]];
+		std::copy_n(&detailVerts[detail.vertBase * 3], detail.vertCount * 3, &tile.detailVerts[vertBase * 3]);
+		std::copy_n(&detailTris[detail.triBase * 4], detail.triCount * 4, &tile.detailTris[triBase * 4]);
+		detail.vertBase = vertBase;
+		detail.triBase = triBase;
+		vertBase += detail.vertCount;
+		triBase += detail.triCount;
+	}
+
+	// vertices in order of first use by the reordered polys
+	std::vector<int> newVertex(header->vertCount, -1);
+	std::vector<float> verts(tile.verts, tile.verts + header->vertCount * 3);
+	int vertCount = 0;
+	for (int i = 0; i < header->polyCount; ++i)
+	{
+		auto &poly = tile.polys[i];
+		for (int j = 0; j < poly.vertCount; ++j)
+		{
+			if (newVertex[poly.verts[j]] < 0)
+				newVertex[poly.verts[j]] = vertCount++;
+			poly.verts[j] = (unsigned short)newVertex[poly.verts[j]];
+		}
+	}
+	for (int v = 0; v < header->vertCount; ++v)
+		if (newVertex[v] < 0)
+			newVertex[v] = vertCount++;
+	for (int v = 0; v < header->vertCount; ++v)
+		dtVcopy(&tile.verts[newVertex[v] * 3], &verts[v * 3]);
+
+	if (header->bvNodeCount > 0)
+	{
+		std::vector<unsigned short> bounds(groundCount * 6);
+		for (int i = 0; i < groundCount; ++i)
+			GetPolyBounds(tile, i, &bounds[i * 6]);
+		header->bvNodeCount = dtCreateBVTree(bounds.data(), groundCount, tile.bvTree);
+	}
+}
+
+int main(int ac, char const *const *av)
+{
+	if (ac < 3)
+	{
+		std::fprintf(stderr, "usage: navmesh-optimize input.nav output.nav\n");
+		return 1;
+	}
+
+	auto in = std::fopen(av[1], "rb");
+	if (!in)
+	{
+		std::fprintf(stderr, "cannot open %s\n", av[1]);
+		return 1;
+	}
+	NavMeshSetHeader header;
+	if (std::fread(&header, sizeof(header), 1, in) != 1 || header.magic != 0x4d534554 || header.version != 1)
+	{
+		std::fprintf(stderr, "%s is not a navmesh set\n", av[1]);
+		std::fclose(in);
+		return 1;
+	}
+	std::vector<NavMeshTileHeader> tileHeaders;
+	std::vector<std::vector<unsigned char>> tiles;
+	for (int i = 0; i < header.numTiles; ++i)
+	{
+		NavMeshTileHeader tileHeader;
+		if (std::fread(&tileHeader, sizeof(tileHeader), 1, in) != 1 || tileHeader.ref == 0 || tileHeader.size <= 0)
+			break;
+		std::vector<unsigned char> data(tileHeader.size);
+		if (std::fread(data.data(), tileHeader.size, 1, in) != 1)
+			break;
+		tileHeaders.push_back(tileHeader);
+		tiles.push_back(std::move(data));
+	}
+	std::fclose(in);
+
+	double spreadBefore = 0;
+	double spreadAfter = 0;
+	int polyCount = 0;
+	for (auto &data : tiles)
+	{
+		auto tile = GetTileData(data.data());
+		if (tile.header->magic != DT_NAVMESH_MAGIC || tile.header->version != DT_NAVMESH_VERSION)
+		{
+			std::fprintf(stderr, "unsupported tile data\n");
+			return 1;
+		}
+		spreadBefore += LinkSpread(tile) * tile.header->polyCount;
+		OptimizeTile(tile);
+		spreadAfter += LinkSpread(tile) * tile.header->polyCount;
+		polyCount += tile.header->polyCount;
+	}
+
+	auto out = std::fopen(av[2], "wb");
+	if (!out)
+	{
+		std::fprintf(stderr, "cannot write %s\n", av[2]);
+		return 1;
+	}
+	header.numTiles = (std::int32_t)tiles.size();
+	std::fwrite(&header, sizeof(header), 1, out);
+	for (size_t i = 0; i < tiles.size(); ++i)
+	{
+		std::fwrite(&tileHeaders[i], sizeof(tileHeaders[i]), 1, out);
+		std::fwrite(tiles[i].data(), tiles[i].size(), 1, out);
+	}
+	std::fclose(out);
+
+	std::printf("%d tiles, %d polys, mean neighbour index distance %.1f -> %.1f\n", (int)tiles.size(), polyCount, polyCount ? spreadBefore / polyCount : 0.0, polyCount ? spreadAfter / polyCount : 0.0);
+	return 0;
+}
@@ -0,0 +1,372 @@
+#include "dol_detour.hpp"
+#include "dol_trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Replays a query trace recorded with StartTrace/StopTrace: loads the recorded navmeshes, runs every
+// call again with the recorded inputs, checks the outputs against the recording and compares latencies.
+//   detour_replay file.trace [threads] [nav directory]
+// With several threads the calls between two mesh changes (SetPolyFlags, BuildLandmarks) are spread
+// over the threads, the changes themselves run alone so every query sees the mesh it was recorded on.
+
+static const float EPSILON = 1e-3f;
+
+static char const *const CALL_NAMES[DT_TRACE_CALL_COUNT] = {
+	"Mesh", "PathStraight", "PathStraightEx", "FindRandomPoint", "FindClosestPoint",
+	"GetPolyAt", "SetPolyFlags", "QueryPolygons", "IsReachable", "BuildLandmarks"};
+
+struct Record
+{
+	dtTraceRecordHeader header;
+	unsigned char const *payload;
+};
+
+// reads the payload of a record in the order it was written
+class Reader
+{
+public:
+	explicit Reader(Record const &record) : m_data(record.payload), m_end(record.payload + record.header.size) {}
+
+	template <typename T>
+	T *get(int count = 1)
+	{
+		auto size = sizeof(T) * (count > 0 ? count : 0);
+		if (m_data + size > m_end)
+			throw 1;
+		auto result = (T *)m_data;
+		m_data += size;
+		return result;
+	}
+
+private:
+	unsigned char const *m_data;
+	unsigned char const *m_end;
+};
+
+static bool Same(float const *a, float const *b, int count)
+{
+	for (int i = 0; i < count; ++i)
+		if (std::abs(a[i] - b[i]) > EPSILON)
+			return false;
+	return true;
+}
+
+// runs one record, returns its latency in nanoseconds and whether the result matches the recording
+static std::uint32_t Replay(Record const &record, dtNavMesh *mesh, dtNavMeshQuery *query, bool &same)
+{
+	Reader in(record);
+	dtStatus status = 0;
+	same = true;
+	// the recorded payload is read only, inputs are copied as the exports take non-const pointers
+	float start[3], end[3], ext[3], result[3];
+	dtPolyFlags queryFilter[2];
+	auto begin = std::chrono::steady_clock::now();
+	switch (record.header.call)
+	{
+	case DT_TRACE_PATH_STRAIGHT:
+	case DT_TRACE_PATH_STRAIGHT_EX:
+	{
+		dtVcopy(start, in.get<float>(3));
+		dtVcopy(end, in.get<float>(3));
+		dtVcopy(ext, in.get<float>(3));
+		std::memcpy(queryFilter, in.get<dtPolyFlags>(2), sizeof(queryFilter));
+		auto pathOptions = (dtStraightPathOptions)*in.get<std::uint32_t>();
+		auto options = record.header.call == DT_TRACE_PATH_STRAIGHT_EX ? (dtPathOptions)*in.get<std::uint32_t>() : DT_PATH_DEFAULT;
+		int pointCount = 0;
+		float points[MAX_POLY * 3];
+		dtPolyFlags flags[MAX_POLY];
+		begin = std::chrono::steady_clock::now();
+		if (record.header.call == DT_TRACE_PATH_STRAIGHT_EX)
+			status = PathStraightEx(query, start, end, ext, queryFilter, pathOptions, options, &pointCount, points, flags);
+		else
+			status = PathStraight(query, start, end, ext, queryFilter, pathOptions, &pointCount, points, flags);
+		auto latency = std::chrono::steady_clock::now() - begin;
+		auto recordedCount = *in.get<int>();
+		same = recordedCount == pointCount && Same(in.get<float>(recordedCount * 3), points, pointCount * 3) && !std::memcmp(in.get<dtPolyFlags>(recordedCount), flags, sizeof(dtPolyFlags) * pointCount);
+		same = same && status == record.header.status;
+		return (std::uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count();
+	}
+	case DT_TRACE_FIND_RANDOM_POINT:
+	{
+		dtVcopy(start, in.get<float>(3));
+		auto radius = *in.get<float>();
+		dtVcopy(ext, in.get<float>(3));
+		std::memcpy(queryFilter, in.get<dtPolyFlags>(2), sizeof(queryFilter));
+		SeedRandom(*in.get<unsigned int>());
+		begin = std::chrono::steady_clock::now();
+		status = FindRandomPointAroundCircle(query, start, radius, ext, queryFilter, result);
+		// same seed, same point
+		same = dtStatusFailed(status) || Same(in.get<float>(3), result, 3);
+		break;
+	}
+	case DT_TRACE_FIND_CLOSEST_POINT:
+	{
+		dtVcopy(start, in.get<float>(3));
+		dtVcopy(ext, in.get<float>(3));
+		std::memcpy(queryFilter, in.get<dtPolyFlags>(2), sizeof(queryFilter));
+		begin = std::chrono::steady_clock::now();
+		status = FindClosestPoint(query, start, ext, queryFilter, result);
+		same = dtStatusFailed(status) || Same(in.get<float>(3), result, 3);
+		break;
+	}
+	case DT_TRACE_GET_POLY_AT:
+	{
+		dtVcopy(start, in.get<float>(3));
+		dtVcopy(ext, in.get<float>(3));
+		std::memcpy(queryFilter, in.get<dtPolyFlags>(2), sizeof(queryFilter));
+		dtPolyRef ref = 0;
+		begin = std::chrono::steady_clock::now();
+		status = GetPolyAt(query, start, ext, (unsigned short *)queryFilter, &ref, result);
+		// no point is written when no poly is found
+		same = *in.get<dtPolyRef>() == ref && (dtStatusFailed(status) || !ref || Same(in.get<float>(3), result, 3));
+		break;
+	}
+	case DT_TRACE_SET_POLY_FLAGS:
+	{
+		auto ref = *in.get<dtPolyRef>();
+		auto flags = *in.get<unsigned short>();
+		begin = std::chrono::steady_clock::now();
+		status = SetPolyFlags(mesh, ref, flags);
+		break;
+	}
+	case DT_TRACE_QUERY_POLYGONS:
+	{
+		dtVcopy(start, in.get<float>(3));
+		dtVcopy(ext, in.get<float>(3));
+		std::memcpy(queryFilter, in.get<dtPolyFlags>(2), sizeof(queryFilter));
+		auto maxPolys = *in.get<int>();
+		std::vector<dtPolyRef> polys(maxPolys > 0 ? maxPolys : 0);
+		int polyCount = 0;
+		begin = std::chrono::steady_clock::now();
+		status = QueryPolygons(query, start, ext, (unsigned short *)queryFilter, polys.data(), &polyCount, maxPolys);
+		auto latency = std::chrono::steady_clock::now() - begin;
+		auto recordedCount = *in.get<int>();
+		same = status == record.header.status && recordedCount == polyCount && !std::memcmp(in.get<dtPolyRef>(recordedCount), polys.data(), sizeof(dtPolyRef) * polyCount);
+		return (std::uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count();
+	}
+	case DT_TRACE_IS_REACHABLE:
+	{
+		dtVcopy(start, in.get<float>(3));
+		dtVcopy(end, in.get<float>(3));
+		dtVcopy(ext, in.get<float>(3));
+		std::memcpy(queryFilter, in.get<dtPolyFlags>(2), sizeof(queryFilter));
+		bool reachable = false;
+		begin = std::chrono::steady_clock::now();
+		status = IsReachable(query, start, end, ext, queryFilter, &reachable);
+		same = *in.get<std::uint8_t>() == (reachable ? 1 : 0);
+		break;
+	}
+	case DT_TRACE_BUILD_LANDMARKS:
+	{
+		auto landmarkCount = *in.get<int>();
+		begin = std::chrono::steady_clock::now();
+		status = BuildLandmarks(mesh, landmarkCount, nullptr);
+		break;
+	}
+	default:
+		throw 2;
+	}
+	auto latency = std::chrono::steady_clock::now() - begin;
+	same = same && status == record.header.status;
+	return (std::uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count();
+}
+
+// calls the following queries depend on, replayed alone
+static bool ChangesMesh(Record const &record)
+{
+	return record.header.call == DT_TRACE_SET_POLY_FLAGS || record.header.call == DT_TRACE_BUILD_LANDMARKS;
+}
+
+struct Stats
+{
+	std::vector<std::uint32_t> recorded;
+	std::vector<std::uint32_t> replayed;
+	int diverged = 0;
+};
+
+static void PrintLatencies(std::vector<std::uint32_t> &latencies)
+{
+	std::sort(latencies.begin(), latencies.end());
+	double total = 0;
+	for (auto latency : latencies)
+		total += latency;
+	std::printf(" %9.1f %9.1f %9.1f", total / latencies.size() / 1000.0, latencies[latencies.size() / 2] / 1000.0, latencies[latencies.size() * 99 / 100] / 1000.0);
+}
+
+int main(int ac, char const *const *av)
+{
+	if (ac < 2)
+	{
+		std::fprintf(stderr, "usage: detour_replay file.trace [threads] [nav directory]\n");
+		return 1;
+	}
+	int threadCount = ac > 2 ? std::max(1, std::atoi(av[2])) : 1;
+	std::string navDirectory = ac > 3 ? av[3] : "";
+
+	auto file = std::fopen(av[1], "rb");
+	if (!file)
+	{
+		std::fprintf(stderr, "cannot open %s\n", av[1]);
+		return 1;
+	}
+	std::vector<unsigned char> data;
+	unsigned char chunk[64 * 1024];
+	for (size_t read; (read = std::fread(chunk, 1, sizeof(chunk), file)) > 0;)
+		data.insert(data.end(), chunk, chunk + read);
+	std::fclose(file);
+
+	dtTraceFileHeader fileHeader;
+	if (data.size() < sizeof(fileHeader))
+	{
+		std::fprintf(stderr, "%s is not a trace\n", av[1]);
+		return 1;
+	}
+	std::memcpy(&fileHeader, data.data(), sizeof(fileHeader));
+	if (fileHeader.magic != DT_TRACE_MAGIC || fileHeader.version != DT_TRACE_VERSION || fileHeader.polyRefSize != sizeof(dtPolyRef))
+	{
+		std::fprintf(stderr, "%s is not a trace of this library version\n", av[1]);
+		return 1;
+	}
+
+	// records, mesh records are resolved right away
+	std::vector<Record> records;
+	std::map<std::uint16_t, dtNavMesh *> meshes;
+	for (size_t offset = sizeof(fileHeader); offset + sizeof(dtTraceRecordHeader) <= data.size();)
+	{
+		Record record;
+		std::memcpy(&record.header, &data[offset], sizeof(record.header));
+		record.payload = &data[offset + sizeof(record.header)];
+		offset += sizeof(record.header) + record.header.size;
+		if (offset > data.size() || record.header.call >= DT_TRACE_CALL_COUNT)
+		{
+			std::fprintf(stderr, "truncated trace, %d records read\n", (int)records.size());
+			break;
+		}
+		if (record.header.call != DT_TRACE_MESH)
+		{
+			records.push_back(record);
+			continue;
+		}
+		std::string path((char const *)record.payload, record.header.size);
+		dtNavMesh *mesh = nullptr;
+		if (!LoadNavMesh(path.c_str(), &mesh) && !navDirectory.empty())
+		{
+			auto slash = path.find_last_of("/\\");
+			path = navDirectory + "/" + (slash == std::string::npos ? path : path.substr(slash + 1));
+			LoadNavMesh(path.c_str(), &mesh);
+		}
+		if (!mesh)
+		{
+			std::fprintf(stderr, "cannot load %s\n", path.c_str());
+			return 1;
+		}
+		meshes[record.header.mesh] = mesh;
+	}
+
+	// the threads of the recording flushed their buffers in any order
+	std::stable_sort(records.begin(), records.end(), [](Record const &a, Record const &b)
+					 { return a.header.sequence < b.header.sequence; });
+
+	// one query per thread and mesh
+	std::vector<std::map<std::uint16_t, dtNavMeshQuery *>> queries(threadCount);
+	for (auto &threadQueries : queries)
+		for (auto const &mesh : meshes)
+			if (!CreateNavMeshQuery(mesh.second, &threadQueries[mesh.first]))
+			{
+				std::fprintf(stderr, "cannot create a query\n");
+				return 1;
+			}
+
+	std::vector<std::uint32_t> latencies(records.size());
+	std::vector<char> same(records.size());
+	auto run = [&](int thread, size_t first, size_t last, int step)
+	{
+		for (auto i = first + thread; i < last; i += step)
+		{
+			auto const &record = records[i];
+			auto mesh = meshes.find(record.header.mesh);
+			if (mesh == meshes.end())
+				continue;
+			bool result = false;
+			try
+			{
+				latencies[i] = Replay(record, mesh->second, queries[thread][record.header.mesh], result);
+			}
+			catch (int)
+			{
+				// payload shorter than the call needs
+				result = false;
+			}
+			same[i] = result;
+		}
+	};
+
+	auto begin = std::chrono::steady_clock::now();
+	for (size_t first = 0; first < records.size();)
+	{
+		if (ChangesMesh(records[first]))
+		{
+			run(0, first, first + 1, 1);
+			++first;
+			continue;
+		}
+		auto last = first;
+		while (last < records.size() && !ChangesMesh(records[last]))
+			++last;
+		if (threadCount == 1)
+			run(0, first, last, 1);
+		else
+		{
+			std::vector<std::thread> threads;
+			for (int t = 0; t < threadCount; ++t)
+				threads.emplace_back(run, t, first, last, threadCount);
+			for (auto &thread : threads)
+				thread.join();
+		}
+		first = last;
+	}
+	auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+	Stats stats[DT_TRACE_CALL_COUNT];
+	int diverged = 0;
+	for (size_t i = 0; i < records.size(); ++i)
+	{
+		auto &call = stats[records[i].header.call];
+		call.recorded.push_back(records[i].header.latency);
+		call.replayed.push_back(latencies[i]);
+		if (!same[i])
+		{
+			++call.diverged;
+			++diverged;
+		}
+	}
+
+	std::printf("%d records, %d meshes, %d threads, %.3f s, %.0f calls/s\n", (int)records.size(), (int)meshes.size(), threadCount, elapsed, elapsed > 0 ? records.size() / elapsed : 0.0);
+	std::printf("%-18s %8s %9s %9s %9s %9s %9s %9s %8s\n", "us", "count", "rec avg", "rec p50", "rec p99", "avg", "p50", "p99", "diverged");
+	for (int call = 1; call < DT_TRACE_CALL_COUNT; ++call)
+	{
+		auto &s = stats[call];
+		if (s.recorded.empty())
+			continue;
+		std::printf("%-18s %8d", CALL_NAMES[call], (int)s.recorded.size());
+		PrintLatencies(s.recorded);
+		PrintLatencies(s.replayed);
+		std::printf(" %8d\n", s.diverged);
+	}
+
+	for (auto &threadQueries : queries)
+		for (auto const &query : threadQueries)
+			FreeNavMeshQuery(query.second);
+	for (auto const &mesh : meshes)
+		FreeNavMesh(mesh.second);
+	return diverged ? 2 : 0;
+}